@@ -0,0 +1,67 @@
+//          batch.cpp
+//
+//  Provides parallel evaluation of batches of queries.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "batch.h"
+#include "query.h"
+
+#include <sstream>
+#include <algorithm>
+
+// Evaluate the queries from begin to end on the calling thread.
+static void EvaluateQueries(const JSONInterface& cursor, const std::vector<std::string>& queries,
+    std::vector<std::string>& results, size_t begin, size_t end)
+{
+    // Cursor of the thread, whose queries are not recorded
+    JSONInterface jsonInterface = cursor;
+    jsonInterface.RecordAccess(nullptr);
+
+    std::ostream* previous = &QueryOutput();
+    std::ostringstream output;
+    RedirectQueryOutput(&output);
+
+    for (size_t i = begin; i < end; i++)
+    {
+        output.str("");
+        try
+        {
+            ProcessQuery(queries[i], jsonInterface);
+        }
+        catch (const std::exception& e)
+        {
+            output << e.what() << std::endl;
+        }
+        results[i] = output.str();
+    }
+
+    RedirectQueryOutput(previous);
+}
+
+std::vector<std::string> BatchQueryExecutor::Run(const JSONInterface& cursor, const std::vector<std::string>& queries)
+{
+    std::vector<std::string> results(queries.size());
+
+    // A single query is not worth passing to another thread
+    if (queries.size() <= 1)
+    {
+        EvaluateQueries(cursor, queries, results, 0, queries.size());
+        return results;
+    }
+
+    size_t chunks = std::min(queries.size(), pool.Size() * ChunksPerThread);
+    for (size_t chunk = 0; chunk < chunks; chunk++)
+    {
+        size_t begin = queries.size() * chunk / chunks;
+        size_t end = queries.size() * (chunk + 1) / chunks;
+
+        pool.Submit([&cursor, &queries, &results, begin, end]()
+        {
+            EvaluateQueries(cursor, queries, results, begin, end);
+        });
+    }
+
+    pool.Wait();
+    return results;
+}
@@ -0,0 +1,358 @@
+//          byte_stream.cpp
+//
+//  Provides streams of files, pipes and the standard input, their decompression, and reading ahead.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "byte_stream.h"
+#include "json_parser.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#if defined(JSON_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(JSON_HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+// Compressed input is taken from the file in blocks of this size.
+static constexpr size_t CompressedBlock = 64 * 1024;
+
+[[noreturn]] static void Fail(const std::string& filename, const std::string& message)
+{
+    throw JSONLoadError("[ERROR] " + filename + " - " + message);
+}
+
+namespace
+{
+    // File or the standard input. Bytes looked at to tell the compression are given back first.
+    class FileStream : public bytestream::ByteStream
+    {
+        std::FILE* const file;
+        const bool owned;
+        const std::string filename;
+
+        std::string head;       // Bytes read by Peek(..) and not taken yet
+        size_t headPos = 0;
+
+    public:
+        FileStream(std::FILE* file, bool owned, const std::string& filename)
+            : file(file), owned(owned), filename(filename) { }
+
+        ~FileStream() override
+        {
+            if (owned) std::fclose(file);
+        }
+
+        // First bytes of the file, up to size of them, which are still read afterwards.
+        std::string_view Peek(size_t size)
+        {
+            head.resize(size);
+            head.resize(std::fread(&head[0], 1, size, file));
+            if (std::ferror(file)) Fail(filename, "Cannot read the file.");
+            return head;
+        }
+
+        size_t Read(char* buffer, size_t size) override
+        {
+            if (headPos < head.size())
+            {
+                size_t count = std::min(size, head.size() - headPos);
+                std::copy(head.data() + headPos, head.data() + headPos + count, buffer);
+                headPos += count;
+                return count;
+            }
+
+            size_t count = std::fread(buffer, 1, size, file);
+            if (count == 0 && std::ferror(file)) Fail(filename, "Cannot read the file.");
+            return count;
+        }
+    };
+
+#if defined(JSON_HAVE_ZLIB)
+    // Members of a gzip file, one after another as gzip itself reads them.
+    class GzipStream : public bytestream::ByteStream
+    {
+        std::unique_ptr<bytestream::ByteStream> source;
+        const std::string filename;
+
+        z_stream stream{};
+        std::vector<char> input;
+        bool inMember = true;   // The end of the current member was not reached
+        bool full = false;      // Output was full, so inflate(..) may have more of it without more input
+
+    public:
+        GzipStream(std::unique_ptr<bytestream::ByteStream> source, const std::string& filename)
+            : source(std::move(source)), filename(filename), input(CompressedBlock)
+        {
+            // Window bits of 15 + 16 take the gzip header and trailer
+            if (inflateInit2(&stream, 15 + 16) != Z_OK) Fail(filename, "Cannot start decompressing the file.");
+        }
+
+        ~GzipStream() override { inflateEnd(&stream); }
+
+        size_t Read(char* buffer, size_t size) override
+        {
+            stream.next_out = (Bytef*)buffer;
+            stream.avail_out = (uInt)std::min<size_t>(size, 1u << 30);
+            const uInt wanted = stream.avail_out;
+
+            while (stream.avail_out > 0)
+            {
+                if (stream.avail_in == 0 && !full)
+                {
+                    size_t count = source->Read(input.data(), input.size());
+                    if (count == 0)
+                    {
+                        if (inMember) Fail(filename, "Compressed data ends early.");
+                        break;
+                    }
+                    stream.next_in = (Bytef*)input.data();
+                    stream.avail_in = (uInt)count;
+                }
+
+                // A member is started by the first bytes taken after the end of the last one
+                const uInt available = stream.avail_in;
+                int status = inflate(&stream, Z_NO_FLUSH);
+                full = stream.avail_out == 0;
+                if (status == Z_STREAM_END)
+                {
+                    inMember = false;
+                    inflateReset(&stream);
+                }
+                else if (status != Z_OK && status != Z_BUF_ERROR)
+                {
+                    Fail(filename, std::string("Cannot decompress the file: ") + (stream.msg ? stream.msg : "invalid data") + ".");
+                }
+                else if (stream.avail_in != available) inMember = true;
+            }
+            return wanted - stream.avail_out;
+        }
+    };
+#endif
+
+#if defined(JSON_HAVE_ZSTD)
+    // Frames of a zstd file, one after another.
+    class ZstdStream : public bytestream::ByteStream
+    {
+        std::unique_ptr<bytestream::ByteStream> source;
+        const std::string filename;
+
+        ZSTD_DStream* stream = nullptr;
+        std::vector<char> input;
+        ZSTD_inBuffer in{ nullptr, 0, 0 };
+        bool inFrame = true;    // The end of the current frame was not reached
+        bool full = false;      // Output was full, so more of it may be buffered without more input
+
+    public:
+        ZstdStream(std::unique_ptr<bytestream::ByteStream> source, const std::string& filename)
+            : source(std::move(source)), filename(filename), input(CompressedBlock)
+        {
+            stream = ZSTD_createDStream();
+            if (!stream || ZSTD_isError(ZSTD_initDStream(stream)))
+            {
+                ZSTD_freeDStream(stream);
+                Fail(filename, "Cannot start decompressing the file.");
+            }
+            in.src = input.data();
+        }
+
+        ~ZstdStream() override { ZSTD_freeDStream(stream); }
+
+        size_t Read(char* buffer, size_t size) override
+        {
+            ZSTD_outBuffer out{ buffer, size, 0 };
+            while (out.pos < out.size)
+            {
+                if (in.pos == in.size && !full)
+                {
+                    size_t count = source->Read(input.data(), input.size());
+                    if (count == 0)
+                    {
+                        if (inFrame) Fail(filename, "Compressed data ends early.");
+                        break;
+                    }
+                    in.size = count;
+                    in.pos = 0;
+                }
+
+                // Zero once a frame is decoded and flushed whole, and a frame is started by any bytes after it
+                const size_t consumed = in.pos;
+                const size_t produced = out.pos;
+                size_t hint = ZSTD_decompressStream(stream, &out, &in);
+                if (ZSTD_isError(hint)) Fail(filename, std::string("Cannot decompress the file: ") + ZSTD_getErrorName(hint) + ".");
+                if (hint == 0) inFrame = false;
+                else if (in.pos != consumed || out.pos != produced) inFrame = true;
+                full = out.pos == out.size;
+            }
+            return out.pos;
+        }
+    };
+#endif
+}
+
+JSON_COMPRESSION bytestream::Detect(const char* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    if (size >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B) return JSON_COMPRESSION::JSON_COMPRESSION_GZIP;
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xB5 && bytes[2] == 0x2F && bytes[3] == 0xFD)
+    {
+        return JSON_COMPRESSION::JSON_COMPRESSION_ZSTD;
+    }
+    return JSON_COMPRESSION::JSON_COMPRESSION_NONE;
+}
+
+bool bytestream::IsRegularFile(const std::string& filename)
+{
+    std::error_code error;
+    return filename != StandardInput && std::filesystem::is_regular_file(filename, error);
+}
+
+bool bytestream::IsPlainFile(const std::string& filename)
+{
+    if (!IsRegularFile(filename)) return false;
+
+    std::ifstream file(filename, std::ios::binary);
+    char head[4];
+    file.read(head, sizeof(head));
+    return Detect(head, (size_t)file.gcount()) == JSON_COMPRESSION::JSON_COMPRESSION_NONE;
+}
+
+std::unique_ptr<bytestream::ByteStream> bytestream::Open(const std::string& filename)
+{
+    std::FILE* file = nullptr;
+    if (filename == StandardInput)
+    {
+        file = stdin;
+#if defined(_WIN32)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    }
+    else file = std::fopen(filename.c_str(), "rb");
+    if (!file) return nullptr;
+
+    auto raw = std::make_unique<FileStream>(file, file != stdin, filename);
+    std::string_view head = raw->Peek(4);
+
+    switch (Detect(head.data(), head.size()))
+    {
+    case JSON_COMPRESSION::JSON_COMPRESSION_GZIP:
+#if defined(JSON_HAVE_ZLIB)
+        return std::make_unique<GzipStream>(std::move(raw), filename);
+#else
+        Fail(filename, "File is compressed with gzip, which this build does not read.");
+#endif
+    case JSON_COMPRESSION::JSON_COMPRESSION_ZSTD:
+#if defined(JSON_HAVE_ZSTD)
+        return std::make_unique<ZstdStream>(std::move(raw), filename);
+#else
+        Fail(filename, "File is compressed with zstd, which this build does not read.");
+#endif
+    default:
+        return raw;
+    }
+}
+
+std::string bytestream::ReadAll(const std::string& filename)
+{
+    std::unique_ptr<ByteStream> stream = Open(filename);
+    if (!stream) Fail(filename, "Cannot open the file.");
+
+    std::string text;
+    size_t size = 0;
+    while (true)
+    {
+        text.resize(std::max<size_t>(2 * size, CompressedBlock));
+        size_t count = stream->Read(&text[size], text.size() - size);
+        if (count == 0) break;
+        size += count;
+    }
+    text.resize(size);
+    return text;
+}
+
+bytestream::BlockReader::BlockReader(std::unique_ptr<ByteStream> stream, size_t blockSize, size_t ahead)
+    : stream(std::move(stream)), blockSize(blockSize), ahead(ahead)
+{
+    thread = std::thread(&BlockReader::Fill, this);
+}
+
+bytestream::BlockReader::~BlockReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taken.notify_all();
+    thread.join();
+}
+
+void bytestream::BlockReader::Fill()
+{
+    try
+    {
+        while (true)
+        {
+            // Short reads, e.g. of pipes, are collected into whole blocks
+            std::string block(blockSize, '\0');
+            size_t size = 0;
+            while (size < blockSize)
+            {
+                size_t count = stream->Read(&block[size], blockSize - size);
+                if (count == 0) break;
+                size += count;
+            }
+            block.resize(size);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            if (size == 0)
+            {
+                finished = true;
+                filled.notify_all();
+                return;
+            }
+
+            taken.wait(lock, [this]() { return stopping || blocks.size() < ahead; });
+            if (stopping) return;
+
+            blocks.push_back(std::move(block));
+            filled.notify_all();
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::current_exception();
+        finished = true;
+        filled.notify_all();
+    }
+}
+
+bool bytestream::BlockReader::Next(std::string& block)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    filled.wait(lock, [this]() { return finished || !blocks.empty(); });
+
+    if (!blocks.empty())
+    {
+        block = std::move(blocks.front());
+        blocks.pop_front();
+        taken.notify_all();
+        return true;
+    }
+
+    if (error) std::rethrow_exception(error);
+    return false;
+}
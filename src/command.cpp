@@ -1,16 +1,29 @@
 
 #include <iostream>
+#include <cstdio>
+#include <chrono>
 #include "command.h"
 #include "json_parser.h"
 #include "utilstr.h"
 #include "query.h"
 #include "fsm.h"
+#include "documents.h"
+#include "path_index.h"
+#include "path_pattern.h"
+#include "batch.h"
+#include "snapshot.h"
+#include "json_patch.h"
+#include "json_writer.h"
+#include "byte_stream.h"
 
-void ProcessCommand(std::string command, 
-	JSONInterface& jsonInterface, 
-	CommandInterface& cmdInterface);
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <algorithm>
 
-void ProcessInput(std::string input, JSONInterface& jsonInterface, CommandInterface& cmdInterface)
+void ProcessCommand(std::string command, CommandInterface& cmdInterface);
+
+void ProcessInput(std::string input, DocumentRegistry& documents, CommandInterface& cmdInterface)
 {
 	if (input.empty())
 	{
@@ -18,45 +31,32 @@ void ProcessInput(std::string input, JSONInterface& jsonInterface, CommandInterf
 		return;
 	}
 
-	if (input.front() == ':')
-	{
-		input.erase(0, 1);
-		ProcessCommand(input, jsonInterface, cmdInterface);
-		return;
-	}
-
-	// Else, we are dealing with queries
-
-	utilstr::ReplaceAllChars(input, " \t\n", "");
+	// Watched documents are not updated while the input is processed
+	std::lock_guard<std::timed_mutex> lock(documents.GetMutex());
 
-	if (utilstr::Contains(input, '+')
-		|| utilstr::Contains(input, '-')
-		|| utilstr::Contains(input, '*')
-		|| utilstr::Contains(input, '/')
-		|| utilstr::Contains(input, '(')
-		|| isdigit(input[0]))
+	// Parts of a document parsed progressively may turn out to be invalid only when accessed.
+	try
 	{
-		Expr expr = Expr(input, jsonInterface);
-		std::cout << expr.Eval().ToString() << std::endl;
-	}
-	// If arithmetic is not used, simple data query can be used.
-	else
-	{
-		JSON::JSONNode* node = jsonInterface.tree_walk(input);
-		if (!node) return;
-
-		if (!JSON::isLiteral(node->GetType()))
+		if (input.front() == ':')
 		{
-			std::cout << "To view an object or a list, use :current." << std::endl;
+			input.erase(0, 1);
+			ProcessCommand(input, cmdInterface);
 			return;
 		}
 
-		std::cout << getLiteralValue(node) << std::endl;
-		return;
+		// Else, we are dealing with queries, which need a loaded document.
+		JSONInterface* jsonInterface = CurrentInterface(documents);
+		if (!jsonInterface) return;
+
+		ProcessQuery(input, *jsonInterface);
+	}
+	catch (const JSONLoadError& e)
+	{
+		std::cout << e.what() << std::endl;
 	}
 }
 
-void ProcessCommand(std::string input, JSONInterface& jsonInterface, CommandInterface& cmdInterface)
+void ProcessCommand(std::string input, CommandInterface& cmdInterface)
 {
 	if (input.empty())
 	{
@@ -82,8 +82,86 @@ void ProcessCommand(std::string input, JSONInterface& jsonInterface, CommandInte
 	cmd->Execute(interpreter);
 }
 
+JSONInterface* CurrentInterface(DocumentRegistry& documents)
+{
+	JSONDocument* document = documents.Current();
+	if (!document)
+	{
+		std::cout << "No document is open. Use :open to load one." << std::endl;
+		return nullptr;
+	}
+
+	// Fail fast rather than block the prompt
+	JSONInterface* jsonInterface = document->GetInterface();
+	if (!jsonInterface)
+	{
+		std::cout << "Document \"" << document->GetName() << "\" is " << document->Describe() << ".";
+		if (document->GetState() == DOCUMENT_STATE::DOCUMENT_STATE_LOADING)
+			std::cout << " Use :wait to wait for it.";
+		std::cout << std::endl;
+	}
+	return jsonInterface;
+}
+
+void WaitForDocument(JSONDocument& document)
+{
+	bool shown = false;
+	while (!document.Wait(std::chrono::milliseconds(250)))
+	{
+		std::cout << "\rDocument \"" << document.GetName() << "\" is " << document.Describe() << "    " << std::flush;
+		shown = true;
+	}
+	if (shown) std::cout << std::endl;
+}
+
+JSONLoadOptions ReadLoadOptions(const CommandLineInterpreter& interpreter)
+{
+	JSONLoadOptions options;
+	for (const Argument& arg : interpreter.GetArgs())
+	{
+		if (arg == ArgumentAlias("snapshot", "s")) options.useSnapshot = true;
+
+		if (arg == ArgumentAlias("index", "i"))
+		{
+			options.useIndex = true;
+			if (arg.HasValue() && utilstr::IsNumLiteral(arg.GetValue()))
+			{
+				options.indexThreshold = std::stoull(arg.GetValue());
+			}
+		}
+
+		if (arg == ArgumentAlias("progressive", "p"))
+		{
+			options.progressive = true;
+			if (arg.HasValue() && utilstr::IsNumLiteral(arg.GetValue()))
+			{
+				options.progressiveThreshold = std::stoull(arg.GetValue());
+			}
+		}
+
+		if (arg == ArgumentAlias("path-index", "x")) options.pathIndex = true;
+
+		if (arg == ArgumentAlias("shared", "m")) options.attachShared = true;
+
+		if (arg == ArgumentAlias("strict", "R")) options.policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT;
+
+		if (arg == ArgumentAlias("lenient", "L")) options.policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_LENIENT;
+
+		if (arg == ArgumentAlias("project", "P") && arg.HasValue())
+		{
+			std::string path;
+			size_t pos = 0;
+			while (utilstr::Split(arg.GetValue(), ',', path, pos)) options.projection.push_back(path);
+		}
+	}
+	return options;
+}
+
 void CommandCurrent::Execute(const CommandLineInterpreter& interpreter) const
 {
+	JSONInterface* json = CurrentInterface(documents);
+	if (!json) return;
+
 	bool showValues = false;
 	unsigned int maxDepth = 0;
 
@@ -111,7 +189,7 @@ void CommandCurrent::Execute(const CommandLineInterpreter& interpreter) const
 		}
 	}
 
-	json.ListMembers(showValues, maxDepth);
+	json->ListMembers(showValues, maxDepth);
 }
 
 void CommandSelect::Execute(const CommandLineInterpreter& interpreter) const
@@ -122,13 +200,19 @@ void CommandSelect::Execute(const CommandLineInterpreter& interpreter) const
 		return;
 	}
 
+	JSONInterface* json = CurrentInterface(documents);
+	if (!json) return;
+
 	Token token = interpreter.GetTokens().at(0);
 
-	json.Select(token.GetValue());
+	json->Select(token.GetValue());
 }
 
 void CommandBack::Execute(const CommandLineInterpreter& interpreter) const
 {
+	JSONInterface* json = CurrentInterface(documents);
+	if (!json) return;
+
 	unsigned int stepsBack = 1;
 
 	for (const Token& t : interpreter.GetTokens())
@@ -149,5 +233,543 @@ void CommandBack::Execute(const CommandLineInterpreter& interpreter) const
 		}
 	}
 
-	json.Back(stepsBack);
+	json->Back(stepsBack);
+}
+
+void CommandOpen::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (interpreter.GetTokens().size() < 2)
+	{
+		std::cout << "Enter the name and the path of the document." << std::endl;
+		return;
+	}
+
+	std::string name = interpreter.GetTokens().at(0).GetValue();
+	std::string path = interpreter.GetTokens().at(1).GetValue();
+
+	if (!documents.Open(name, path, ReadLoadOptions(interpreter)))
+	{
+		std::cout << "Document \"" << name << "\" is already open." << std::endl;
+		return;
+	}
+	std::cout << "Loading \"" << path << "\" as \"" << name << "\"." << std::endl;
+}
+
+void CommandUse::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (interpreter.GetTokens().size() < 1)
+	{
+		std::cout << "Enter a document to use." << std::endl;
+		return;
+	}
+
+	std::string name = interpreter.GetTokens().at(0).GetValue();
+	if (!documents.Use(name))
+	{
+		std::cout << "No document \"" << name << "\" is open." << std::endl;
+		return;
+	}
+
+	for (const Argument& arg : interpreter.GetArgs())
+	{
+		if (arg == ArgumentAlias("wait", "w"))
+		{
+			WaitForDocument(*documents.Current());
+			break;
+		}
+	}
+}
+
+void CommandClose::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (interpreter.GetTokens().size() < 1)
+	{
+		std::cout << "Enter a document to close." << std::endl;
+		return;
+	}
+
+	std::string name = interpreter.GetTokens().at(0).GetValue();
+	if (!documents.Close(name))
+	{
+		std::cout << "No document \"" << name << "\" is open." << std::endl;
+		return;
+	}
+	watches.Remove(name);
+}
+
+void CommandWait::Execute(const CommandLineInterpreter& interpreter) const
+{
+	JSONDocument* document = documents.Current();
+	if (interpreter.GetTokens().size() > 0)
+	{
+		document = documents.Find(interpreter.GetTokens().at(0).GetValue());
+	}
+
+	if (!document)
+	{
+		std::cout << "No such document is open." << std::endl;
+		return;
+	}
+
+	WaitForDocument(*document);
+}
+
+void CommandDocuments::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (documents.Documents().empty())
+	{
+		std::cout << "No document is open." << std::endl;
+		return;
+	}
+
+	ConsoleTable<3> table({ 2, 4, 4 }, 0);
+	JSONDocument* current = documents.Current();
+
+	for (const auto& [name, document] : documents.Documents())
+	{
+		std::string col1 = (document.get() == current ? "* " : "  ") + name;
+		table.PrintLine({ col1, document->GetPath(), document->Describe() });
+	}
+}
+
+void WatchList::Evaluate(JSONDocument& document, WatchExpression& watch)
+{
+	JSON* json = document.GetJSON();
+	JSONInterface jsonInterface = json->CreateInterface();
+
+	std::cout << "[watch] " << document.GetName() << ": " << watch.expression << " = ";
+
+	if (!jsonInterface.Rebind(*json, watch.base))
+	{
+		std::cout << "object " << JSON::PathToString(watch.base) << " no longer exists." << std::endl;
+		watch.inputs = { watch.base };
+		return;
+	}
+
+	std::vector<JSON::JSONNode*> accessed;
+	jsonInterface.RecordAccess(&accessed);
+	ProcessQuery(watch.expression, jsonInterface);
+
+	watch.inputs.clear();
+	for (JSON::JSONNode* node : accessed)
+	{
+		watch.inputs.push_back(JSON::PathOf(node));
+	}
+}
+
+void WatchList::Add(JSONDocument& document, const std::string& expression)
+{
+	WatchExpression watch;
+	watch.expression = expression;
+	watch.base = document.GetInterface()->GetPath();
+
+	std::vector<WatchExpression>& watches = expressions[document.GetName()];
+	watches.push_back(watch);
+	Evaluate(document, watches.back());
+}
+
+void WatchList::Update(JSONDocument& document, const JSONDocumentUpdate& update)
+{
+	std::cout << std::endl << "Document \"" << document.GetName() << "\" ";
+	if (!update.error.empty())
+	{
+		std::cout << "could not be updated: " << update.error << std::endl;
+		return;
+	}
+
+	char milliseconds[32];
+	std::snprintf(milliseconds, sizeof(milliseconds), "%.2f", update.seconds * 1000);
+
+	if (update.whole) std::cout << "was parsed again";
+	else std::cout << "changed in " << JSON::PathToString(update.path);
+	std::cout << " (" << milliseconds << " ms)." << std::endl;
+
+	auto watches = expressions.find(document.GetName());
+	if (watches == expressions.end()) return;
+
+	for (WatchExpression& watch : watches->second)
+	{
+		bool affected = update.whole;
+		for (const JSONPath& input : watch.inputs)
+		{
+			if (JSON::PathsOverlap(input, update.path)) affected = true;
+		}
+
+		if (affected) Evaluate(document, watch);
+	}
+}
+
+void WatchList::Watch(DocumentRegistry& documents, JSONDocument& document)
+{
+	if (document.IsWatched()) return;
+
+	documents.Watch(document.GetName(), [this](JSONDocument& document, const JSONDocumentUpdate& update)
+	{
+		Update(document, update);
+	});
+}
+
+void CommandWatch::Execute(const CommandLineInterpreter& interpreter) const
+{
+	JSONDocument* document = documents.Current();
+	if (!CurrentInterface(documents)) return;
+
+	if (document->GetPath() == bytestream::StandardInput)
+	{
+		std::cout << "[ERROR] The standard input cannot be watched." << std::endl;
+		return;
+	}
+	watches.Watch(documents, *document);
+
+	// Queries have no spaces, so the tokens are simply joined
+	std::string expression;
+	for (const Token& token : interpreter.GetTokens()) expression += token.GetValue();
+
+	if (expression.empty())
+	{
+		std::cout << "Watching \"" << document->GetPath() << "\"." << std::endl;
+		return;
+	}
+	watches.Add(*document, expression);
+}
+
+void CommandUnwatch::Execute(const CommandLineInterpreter& interpreter) const
+{
+	JSONDocument* document = documents.Current();
+	if (!document)
+	{
+		std::cout << "No document is open." << std::endl;
+		return;
+	}
+
+	documents.Unwatch(document->GetName());
+	watches.Remove(document->GetName());
+}
+
+void CommandPathIndex::Execute(const CommandLineInterpreter& interpreter) const
+{
+	JSONDocument* document = documents.Current();
+	if (!CurrentInterface(documents)) return;
+
+	JSON* json = document->GetJSON();
+	for (const Argument& arg : interpreter.GetArgs())
+	{
+		if (arg == ArgumentAlias("drop", "d"))
+		{
+			json->EnablePathIndex(false);
+			std::cout << "Path index dropped." << std::endl;
+			return;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	json->EnablePathIndex(true);
+	size_t size = json->GetPathIndex()->Size();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	char milliseconds[32];
+	std::snprintf(milliseconds, sizeof(milliseconds), "%.2f", elapsed.count());
+	std::cout << "Indexed " << size << " paths in " << milliseconds << " ms." << std::endl;
+}
+
+void CommandBatch::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (interpreter.GetTokens().size() < 1)
+	{
+		std::cout << "Enter a file with queries." << std::endl;
+		return;
+	}
+
+	JSONInterface* jsonInterface = CurrentInterface(documents);
+	if (!jsonInterface) return;
+
+	std::string path = interpreter.GetTokens().at(0).GetValue();
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		std::cout << "Cannot open \"" << path << "\"." << std::endl;
+		return;
+	}
+
+	std::vector<std::string> queries;
+	for (std::string line; std::getline(file, line); )
+	{
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (!line.empty()) queries.push_back(line);
+	}
+
+	size_t threads = 0;
+	for (const Argument& arg : interpreter.GetArgs())
+	{
+		if (arg == ArgumentAlias("threads", "t") && arg.HasValue() && utilstr::IsNumLiteral(arg.GetValue()))
+		{
+			threads = std::stoull(arg.GetValue());
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	BatchQueryExecutor executor(threads);
+	std::vector<std::string> results = executor.Run(*jsonInterface, queries);
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	for (const std::string& result : results) std::cout << result;
+
+	char milliseconds[32];
+	std::snprintf(milliseconds, sizeof(milliseconds), "%.2f", elapsed.count());
+	std::cout << "Evaluated " << queries.size() << " queries on " << executor.Threads() << " threads in "
+		<< milliseconds << " ms." << std::endl;
+}
+
+void CommandPublish::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (interpreter.GetTokens().size() < 1)
+	{
+		std::cout << "Enter a name to publish the document under." << std::endl;
+		return;
+	}
+
+	std::string name = snapshot::SegmentName(interpreter.GetTokens().at(0).GetValue());
+	for (const Argument& arg : interpreter.GetArgs())
+	{
+		if (arg == ArgumentAlias("drop", "d"))
+		{
+			if (snapshot::Unpublish(name)) std::cout << "\"" << name << "\" is no longer published." << std::endl;
+			else std::cout << "Nothing is published as \"" << name << "\"." << std::endl;
+			return;
+		}
+	}
+
+	JSONDocument* document = documents.Current();
+	if (!CurrentInterface(documents)) return;
+
+	auto start = std::chrono::steady_clock::now();
+	bool published = document->GetJSON()->Publish(name);
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	if (!published)
+	{
+		std::cout << "[ERROR] Cannot publish the document as \"" << name << "\"." << std::endl;
+		return;
+	}
+
+	char milliseconds[32];
+	std::snprintf(milliseconds, sizeof(milliseconds), "%.2f", elapsed.count());
+	std::cout << "Published \"" << document->GetName() << "\" as \"" << name << "\" in " << milliseconds << " ms." << std::endl;
+}
+
+// Apply an edit to the path of the current document, keeping the selected object if its path still exists.
+static void EditDocument(DocumentRegistry& documents, const std::string& query,
+	const std::function<bool(JSON& json, const JSONPath& path)>& edit)
+{
+	JSONInterface* jsonInterface = CurrentInterface(documents);
+	if (!jsonInterface) return;
+
+	JSONPath path;
+	if (!jsonInterface->ResolvePath(query, path)) return;
+
+	JSON& json = *documents.Current()->GetJSON();
+	JSONPath selected = jsonInterface->GetPath();
+
+	if (!edit(json, path))
+	{
+		std::cout << "[ERROR] Cannot edit " << JSON::PathToString(path) << ": no such member or element, or its parent is not an object or a list." << std::endl;
+		return;
+	}
+
+	jsonInterface->Rebind(json, selected);
+	std::cout << "Edited " << JSON::PathToString(path) << ", now at version " << json.GetVersion() << "." << std::endl;
+}
+
+// Value of :set and :insert, which may contain spaces outside of strings.
+static std::string ReadEditValue(const CommandLineInterpreter& interpreter)
+{
+	std::string value;
+	for (size_t i = 1; i < interpreter.GetTokens().size(); i++)
+	{
+		if (i > 1) value += " ";
+		value += interpreter.GetTokens().at(i).GetValue();
+	}
+
+	if (value.empty()) std::cout << "Enter a value." << std::endl;
+	return value;
+}
+
+void CommandSet::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (interpreter.GetTokens().size() < 1)
+	{
+		std::cout << "Enter a path to set." << std::endl;
+		return;
+	}
+
+	std::string value = ReadEditValue(interpreter);
+	if (value.empty()) return;
+
+	EditDocument(documents, interpreter.GetTokens().at(0).GetValue(), [&value](JSON& json, const JSONPath& path)
+	{
+		return json.Set(path, JSON::ParseValue(value));
+	});
+}
+
+void CommandInsert::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (interpreter.GetTokens().size() < 1)
+	{
+		std::cout << "Enter a path to insert at." << std::endl;
+		return;
+	}
+
+	std::string value = ReadEditValue(interpreter);
+	if (value.empty()) return;
+
+	EditDocument(documents, interpreter.GetTokens().at(0).GetValue(), [&value](JSON& json, const JSONPath& path)
+	{
+		return json.Insert(path, JSON::ParseValue(value));
+	});
+}
+
+void CommandDelete::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (interpreter.GetTokens().size() < 1)
+	{
+		std::cout << "Enter a path to delete." << std::endl;
+		return;
+	}
+
+	EditDocument(documents, interpreter.GetTokens().at(0).GetValue(), [](JSON& json, const JSONPath& path)
+	{
+		return json.Remove(path);
+	});
+}
+
+void CommandUndo::Execute(const CommandLineInterpreter& interpreter) const
+{
+	JSONInterface* jsonInterface = CurrentInterface(documents);
+	if (!jsonInterface) return;
+
+	JSON& json = *documents.Current()->GetJSON();
+	size_t version = json.GetVersion() > 0 ? json.GetVersion() - 1 : 0;
+
+	for (const Token& token : interpreter.GetTokens())
+	{
+		if (utilstr::IsNumLiteral(token.GetValue()))
+		{
+			size_t count = std::stoull(token.GetValue());
+			version = json.GetVersion() > count ? json.GetVersion() - count : 0;
+		}
+	}
+	for (const Argument& arg : interpreter.GetArgs())
+	{
+		if (arg == ArgumentAlias("to", "t") && arg.HasValue() && utilstr::IsNumLiteral(arg.GetValue()))
+		{
+			// Undone versions may be gone to again
+			version = std::min<size_t>(std::stoull(arg.GetValue()), json.GetLatestVersion());
+		}
+	}
+
+	size_t current = json.GetVersion();
+	JSONPath selected = jsonInterface->GetPath();
+	json.GoTo(version);
+	jsonInterface->Rebind(json, selected);
+
+	if (version > current) std::cout << "Redid " << version - current;
+	else std::cout << "Undid " << current - version;
+	std::cout << " edits, now at version " << version << " of " << json.GetLatestVersion() << "." << std::endl;
+}
+
+void CommandChanges::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (!CurrentInterface(documents)) return;
+	JSON& json = *documents.Current()->GetJSON();
+
+	size_t version = 0;
+	if (interpreter.GetTokens().size() > 0 && utilstr::IsNumLiteral(interpreter.GetTokens().at(0).GetValue()))
+	{
+		version = std::min<size_t>(std::stoull(interpreter.GetTokens().at(0).GetValue()), json.GetLatestVersion());
+	}
+
+	// Later versions are those of undone edits
+	std::vector<JSONPath> changes = json.ChangesSince(version);
+	std::cout << "Version " << json.GetVersion() << ", " << changes.size()
+		<< (version > json.GetVersion() ? " edits undone up to version " : " edits since version ") << version << "." << std::endl;
+	for (const JSONPath& path : changes)
+	{
+		std::cout << "  " << JSON::PathToString(path) << std::endl;
+	}
+}
+
+void CommandSave::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (!CurrentInterface(documents)) return;
+	JSONDocument* document = documents.Current();
+
+	std::string path = interpreter.GetTokens().size() > 0 ? interpreter.GetTokens().at(0).GetValue() : document->GetPath();
+
+	// Text is written uncompressed, so it does not go back to the standard input or a compressed file
+	bool compressed = bytestream::IsRegularFile(path) && !bytestream::IsPlainFile(path);
+	if (interpreter.GetTokens().empty() && (path == bytestream::StandardInput || compressed))
+	{
+		std::cout << "[ERROR] \"" << path << "\" was not read from a plain file, give the file to save to." << std::endl;
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	JSONWriteStats stats;
+	bool saved = jsonwriter::Save(*document->GetJSON(), path, &stats);
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	if (!saved)
+	{
+		std::cout << "[ERROR] Cannot write \"" << path << "\"." << std::endl;
+		return;
+	}
+
+	char milliseconds[32];
+	std::snprintf(milliseconds, sizeof(milliseconds), "%.2f", elapsed.count());
+	std::cout << "Saved \"" << path << "\" in " << milliseconds << " ms: " << stats.bytes << " bytes, "
+		<< stats.copiedBytes << " of them copied as they were read." << std::endl;
+}
+
+void CommandPatch::Execute(const CommandLineInterpreter& interpreter) const
+{
+	if (interpreter.GetTokens().size() < 1)
+	{
+		std::cout << "Enter the file of the patch." << std::endl;
+		return;
+	}
+
+	JSONInterface* jsonInterface = CurrentInterface(documents);
+	if (!jsonInterface) return;
+
+	std::string path = interpreter.GetTokens().at(0).GetValue();
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		std::cout << "Cannot open \"" << path << "\"." << std::endl;
+		return;
+	}
+
+	std::stringstream patch;
+	patch << file.rdbuf();
+
+	JSON& json = *documents.Current()->GetJSON();
+	JSONPath selected = jsonInterface->GetPath();
+	size_t version = json.GetVersion();
+
+	auto start = std::chrono::steady_clock::now();
+	std::string error;
+	bool applied = jsonpatch::Apply(json, patch.str(), error);
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	jsonInterface->Rebind(json, selected);
+	if (!applied)
+	{
+		std::cout << "[ERROR] " << error << " Nothing was applied." << std::endl;
+		return;
+	}
+
+	char milliseconds[32];
+	std::snprintf(milliseconds, sizeof(milliseconds), "%.2f", elapsed.count());
+	std::cout << "Applied " << json.GetVersion() - version << " edits in " << milliseconds
+		<< " ms, now at version " << json.GetVersion() << "." << std::endl;
 }
@@ -0,0 +1,268 @@
+//          documents.cpp
+//
+//  Provides background loading of JSON documents and their registry.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "documents.h"
+
+#include <cstdio>
+
+JSONDocument::JSONDocument(const std::string& name, const std::string& path, const JSONLoadOptions& options)
+    : name(name), path(path), options(options)
+{
+    thread = std::thread(&JSONDocument::Load, this, options);
+}
+
+JSONDocument::~JSONDocument()
+{
+    watcher.reset();
+
+    progress.cancelled.store(true);
+    if (thread.joinable()) thread.join();
+}
+
+void JSONDocument::Load(JSONLoadOptions options)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Errors are kept in the document instead of exiting the program.
+    options.progress = &progress;
+    options.exitOnError = false;
+
+    std::unique_ptr<JSON> result;
+    std::string loadError;
+    try
+    {
+        result = std::make_unique<JSON>(path, options);
+    }
+    catch (const std::exception& e)
+    {
+        loadError = e.what();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    loadSeconds = elapsed.count();
+
+    if (result)
+    {
+        json = std::move(result);
+        jsonInterface = std::make_unique<JSONInterface>(json->CreateInterface());
+        state = DOCUMENT_STATE::DOCUMENT_STATE_READY;
+    }
+    else
+    {
+        error = loadError;
+        state = DOCUMENT_STATE::DOCUMENT_STATE_FAILED;
+    }
+    loaded.notify_all();
+}
+
+DOCUMENT_STATE JSONDocument::GetState() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return state;
+}
+
+std::string JSONDocument::GetError() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
+
+double JSONDocument::GetLoadSeconds() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return loadSeconds;
+}
+
+bool JSONDocument::Wait(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return loaded.wait_for(lock, timeout, [this]()
+    {
+        return state != DOCUMENT_STATE::DOCUMENT_STATE_LOADING;
+    });
+}
+
+JSONInterface* JSONDocument::GetInterface()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return state == DOCUMENT_STATE::DOCUMENT_STATE_READY ? jsonInterface.get() : nullptr;
+}
+
+JSON* JSONDocument::GetJSON()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return state == DOCUMENT_STATE::DOCUMENT_STATE_READY ? json.get() : nullptr;
+}
+
+JSONDocumentUpdate JSONDocument::Reload()
+{
+    JSONDocumentUpdate update;
+    if (GetState() != DOCUMENT_STATE::DOCUMENT_STATE_READY) return update;
+
+    auto start = std::chrono::steady_clock::now();
+    JSONPath selected = jsonInterface->GetPath();
+
+    try
+    {
+        if (json->CanUpdate())
+        {
+            update.changed = json->Update(update.path);
+            update.whole = update.changed && update.path.empty();
+        }
+        else
+        {
+            // Sidecars and background parsing are used again by the new tree
+            JSONLoadOptions reloadOptions = options;
+            reloadOptions.exitOnError = false;
+
+            std::unique_ptr<JSON> reloaded = std::make_unique<JSON>(path, reloadOptions);
+            reloaded->EnablePathIndex(json->IsPathIndexEnabled());
+
+            std::lock_guard<std::mutex> lock(mutex);
+            json = std::move(reloaded);
+            update.changed = true;
+            update.whole = true;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        update.error = e.what();
+        return update;
+    }
+
+    if (update.changed) jsonInterface->Rebind(*json, selected);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    update.seconds = elapsed.count();
+    return update;
+}
+
+void JSONDocument::Watch(FileWatcher::Handler onChange)
+{
+    watcher = std::make_unique<FileWatcher>(path, onChange);
+}
+
+std::string JSONDocument::Describe() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    switch (state)
+    {
+    case DOCUMENT_STATE::DOCUMENT_STATE_LOADING:
+    {
+        int stage = progress.stage.load(std::memory_order_relaxed);
+        std::string description = "loading: " + JSONLoadProgress::ToString(stage);
+
+        if (stage == JSONLoadProgress::STAGE_TRIMMING || stage == JSONLoadProgress::STAGE_PARSING)
+        {
+            description += " " + std::to_string(progress.Percent()) + "%";
+        }
+        return description;
+    }
+    case DOCUMENT_STATE::DOCUMENT_STATE_READY:
+    {
+        char seconds[32];
+        std::snprintf(seconds, sizeof(seconds), "%.2f", loadSeconds);
+        return std::string("ready, loaded in ") + seconds + " s" + (watcher ? ", watched" : "");
+    }
+    default:
+        return "failed: " + error;
+    }
+}
+
+bool DocumentRegistry::Open(const std::string& name, const std::string& path, const JSONLoadOptions& options)
+{
+    if (documents.count(name)) return false;
+
+    documents.emplace(name, std::make_unique<JSONDocument>(name, path, options));
+    if (current.empty()) current = name;
+    return true;
+}
+
+bool DocumentRegistry::Close(const std::string& name)
+{
+    auto document = documents.find(name);
+    if (document == documents.end()) return false;
+
+    // Waits for the loading thread, which stops at the next progress report.
+    documents.erase(document);
+    reported.erase(name);
+
+    if (current == name) current.clear();
+    return true;
+}
+
+bool DocumentRegistry::Use(const std::string& name)
+{
+    if (!documents.count(name)) return false;
+
+    current = name;
+    return true;
+}
+
+JSONDocument* DocumentRegistry::Find(const std::string& name)
+{
+    auto document = documents.find(name);
+    return document == documents.end() ? nullptr : document->second.get();
+}
+
+JSONDocument* DocumentRegistry::Current()
+{
+    return current.empty() ? nullptr : Find(current);
+}
+
+std::vector<std::string> DocumentRegistry::PollFinished()
+{
+    std::vector<std::string> messages;
+
+    for (const auto& [name, document] : documents)
+    {
+        if (reported.count(name)) continue;
+
+        DOCUMENT_STATE state = document->GetState();
+        if (state == DOCUMENT_STATE::DOCUMENT_STATE_LOADING) continue;
+
+        std::string message = "Document \"" + name + "\" ";
+        if (state == DOCUMENT_STATE::DOCUMENT_STATE_READY) message += "is " + document->Describe() + ".";
+        else message += document->Describe();
+
+        messages.push_back(message);
+        reported.insert(name);
+    }
+    return messages;
+}
+
+bool DocumentRegistry::Watch(const std::string& name, DocumentUpdateHandler onUpdate)
+{
+    JSONDocument* document = Find(name);
+    if (!document) return false;
+
+    document->Watch([this, document, onUpdate](const FileWatcher& watcher)
+    {
+        // The registry is locked while it is in use, and the document may be closed meanwhile,
+        // which waits for this handler.
+        std::unique_lock<std::timed_mutex> lock(mutex, std::defer_lock);
+        while (!lock.try_lock_for(std::chrono::milliseconds(50)))
+        {
+            if (watcher.IsStopping()) return;
+        }
+
+        JSONDocumentUpdate update = document->Reload();
+        if (update.changed || !update.error.empty()) onUpdate(*document, update);
+    });
+    return true;
+}
+
+bool DocumentRegistry::Unwatch(const std::string& name)
+{
+    JSONDocument* document = Find(name);
+    if (!document) return false;
+
+    document->Unwatch();
+    return true;
+}
@@ -8,7 +8,8 @@
 //	1. --arg(=..) is a full (non-aliased) argument with potential value;
 //	2. -xy(=..) is an aliased list of arguments. The value is assigned to the last one.
 //	3. General arguments without -/-- are read as tokens and stored in order.
-//	   It is up to the caller on how to interpret these tokens.
+//	   It is up to the caller on how to interpret these tokens. A lone '-' is
+//	   a token as well, which usually stands for the standard input.
 // 
 // At the end, two lists are formed: the list of arguments, containing
 // the argument name (aliased or not) and its possible value, and the list
@@ -114,7 +115,7 @@ bool CommandLineInterpreter::Interpret()
 		}
 
 		// Consider the case of aliased arguments
-		else if (utilstr::BeginsWith(contents, "-", pos))
+		else if (utilstr::BeginsWith(contents, "-", pos) && pos + 1 < contents.size() && contents.at(pos + 1) != ' ')
 		{
 			// Increment position to account for "-".
 			pos += 1;
@@ -0,0 +1,38 @@
+/*****************************************************************//**
+ * \file   batch.h
+ * \brief  Parallel evaluation of batches of independent queries
+ *         against one loaded tree.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+#include "worker_pool.h"
+
+#include <string>
+#include <vector>
+
+// Evaluates queries and expressions on a pool of threads. Each thread has its own copy of the
+// cursor, and the messages and results of each query are collected separately. The tree must not
+// be updated while a batch runs.
+class BatchQueryExecutor
+{
+    WorkerPool pool;
+
+public:
+    // Queries are split into this many chunks per thread, to even out the load
+    static constexpr size_t ChunksPerThread = 8;
+
+    // Zero threads means one thread per hardware thread.
+    BatchQueryExecutor(size_t threadCount = 0) : pool(threadCount) { }
+
+    // Evaluate every query relative to the object selected by the cursor.
+    // Returns what each query prints, in the order of the queries. A single query is evaluated
+    // on the calling thread.
+    std::vector<std::string> Run(const JSONInterface& cursor, const std::vector<std::string>& queries);
+
+    size_t Threads() const { return pool.Size(); }
+};
@@ -0,0 +1,101 @@
+/*****************************************************************//**
+ * \file   byte_stream.h
+ * \brief  Files, pipes and the standard input read as streams of bytes,
+ *         decompressed on the way when they are gzip or zstd.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+// Compression of a stream, told by the bytes it starts with rather than by the name of its file.
+enum class JSON_COMPRESSION
+{
+    JSON_COMPRESSION_NONE = 0,
+    JSON_COMPRESSION_GZIP,      // Read if zlib was found at build time (JSON_HAVE_ZLIB)
+    JSON_COMPRESSION_ZSTD       // Read if zstd was found at build time (JSON_HAVE_ZSTD)
+};
+
+// Streams are read in blocks, from the start to the end, and never sought. So pipes, process
+// substitution and the standard input are read as files are. Compressed streams are decompressed
+// as they are read, without writing the decompressed text anywhere but to memory.
+namespace bytestream
+{
+    // File name standing for the standard input.
+    inline const std::string StandardInput = "-";
+
+    // Source of bytes read in order.
+    class ByteStream
+    {
+    public:
+        virtual ~ByteStream() = default;
+
+        // Read up to size bytes, returning how many were read. Zero is the end of the stream.
+        // Throws JSONLoadError if the stream cannot be read or decompressed.
+        virtual size_t Read(char* buffer, size_t size) = 0;
+    };
+
+    // Whether the file is a regular file on disk, which may be sized and stat'ed. False for the standard
+    // input, pipes and missing files.
+    bool IsRegularFile(const std::string& filename);
+
+    // Same, if the file is not compressed either, so that it may be mapped and read by offsets.
+    bool IsPlainFile(const std::string& filename);
+
+    // Compression of the stream starting with the bytes.
+    JSON_COMPRESSION Detect(const char* data, size_t size);
+
+    // Open the file, or the standard input for StandardInput, decompressing it if it is compressed.
+    // Returns nullptr if it cannot be opened. Throws JSONLoadError if it is compressed in a way this
+    // build does not read.
+    std::unique_ptr<ByteStream> Open(const std::string& filename);
+
+    // Read the whole stream of the file into a string. Throws JSONLoadError as Open(..) does, and if
+    // it cannot be opened.
+    std::string ReadAll(const std::string& filename);
+
+    // Blocks of a stream, read ahead on a thread of its own, so that reading and decompressing
+    // the next blocks goes on while the last one is used.
+    class BlockReader
+    {
+        std::unique_ptr<ByteStream> stream;
+        const size_t blockSize;
+        const size_t ahead;     // Blocks read and not taken yet, at most
+
+        std::mutex mutex;
+        std::condition_variable filled;     // Signalled when a block is read or the stream ends
+        std::condition_variable taken;      // Signalled when a block is taken or reading stops
+
+        std::deque<std::string> blocks;
+        bool finished = false;
+        bool stopping = false;
+        std::exception_ptr error;           // Of the reading thread, rethrown by Next(..)
+
+        std::thread thread;
+
+        // Body of the reading thread.
+        void Fill();
+
+    public:
+        BlockReader(std::unique_ptr<ByteStream> stream, size_t blockSize = 1 << 20, size_t ahead = 4);
+
+        // Stops reading, without reading the rest of the stream.
+        ~BlockReader();
+
+        BlockReader& operator=(const BlockReader& rhs) = delete;
+        BlockReader(const BlockReader& other) = delete;
+
+        // Wait for the next block. Returns false at the end of the stream, and rethrows the error
+        // that stopped reading, if any.
+        bool Next(std::string& block);
+    };
+}
@@ -10,12 +10,59 @@
 #include <iostream>
 #include <array>
 #include <vector>
+#include <map>
+
+#include "json_parser.h"
 
 class JSONInterface;
+class JSONDocument;
+class DocumentRegistry;
 class CommandInterface;
 class CommandLineInterpreter;
+struct JSONLoadOptions;
+
+void ProcessInput(std::string, DocumentRegistry&, CommandInterface&);
+
+// Interface of the current document. If there is none, or it is not loaded yet,
+// the reason is written and nullptr is returned.
+JSONInterface* CurrentInterface(DocumentRegistry& documents);
+
+// Wait for the document to load, showing the progress.
+void WaitForDocument(JSONDocument& document);
+
+// Read --snapshot, --index(=THRESHOLD), --progressive(=THRESHOLD), --strict, --lenient and --project=PATHS arguments.
+JSONLoadOptions ReadLoadOptions(const CommandLineInterpreter& interpreter);
+
+struct JSONDocumentUpdate;
+
+// Query evaluated again whenever the nodes it read change in the watched document.
+struct WatchExpression
+{
+    std::string expression;
+    JSONPath base;                  // Object selected when the expression was added
+    std::vector<JSONPath> inputs;   // Nodes read by the last evaluation
+};
 
-void ProcessInput(std::string, JSONInterface&, CommandInterface&);
+// Watch expressions of the documents, by document name.
+class WatchList
+{
+    std::map<std::string, std::vector<WatchExpression>> expressions;
+
+    // Evaluate and print the expression, recording its inputs.
+    void Evaluate(JSONDocument& document, WatchExpression& watch);
+
+public:
+    // Add an expression relative to the selected object, and evaluate it.
+    void Add(JSONDocument& document, const std::string& expression);
+
+    void Remove(const std::string& documentName) { expressions.erase(documentName); }
+
+    // Report the update, and evaluate again the expressions whose inputs are affected by it.
+    void Update(JSONDocument& document, const JSONDocumentUpdate& update);
+
+    // Start watching the document, if it is not watched yet.
+    void Watch(DocumentRegistry& documents, JSONDocument& document);
+};
 
 template <int N>
 class ConsoleTable
@@ -210,9 +257,9 @@ public:
 
 class CommandCurrent : public Command
 {
-    JSONInterface& json;
+    DocumentRegistry& documents;
 public:
-    CommandCurrent(JSONInterface& json) : json(json),
+    CommandCurrent(DocumentRegistry& documents) : documents(documents),
         Command("current", "c", 
         ":current (--recursive=MAX_DEPTH) (--show-values)", 
         "Displays info about current object.") { }
@@ -222,9 +269,9 @@ public:
 
 class CommandSelect : public Command
 {
-    JSONInterface& json;
+    DocumentRegistry& documents;
 public:
-    CommandSelect(JSONInterface& json) : json(json),
+    CommandSelect(DocumentRegistry& documents) : documents(documents),
         Command("select", "s", ":select <EXPR>",
         "Select object member. Must also be an object.") { }
 
@@ -233,11 +280,213 @@ public:
 
 class CommandBack : public Command
 {
-    JSONInterface& json;
+    DocumentRegistry& documents;
 
 public:
-    CommandBack(JSONInterface& json) : json(json),
+    CommandBack(DocumentRegistry& documents) : documents(documents),
         Command("back", "b", ":back (<NUM_STEPS>) (--root)", "Move up the hierarchy.") { }
 
     void Execute(const CommandLineInterpreter& interpreter) const override;
 };
+
+class CommandOpen : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandOpen(DocumentRegistry& documents) : documents(documents),
+        Command("open", "o", ":open <NAME> <PATH> (--snapshot) (--index(=THRESHOLD)) (--progressive(=THRESHOLD)) (--path-index) (--shared) (--strict|--lenient) (--project=PATH,..)",
+        "Load a document in the background.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandUse : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandUse(DocumentRegistry& documents) : documents(documents),
+        Command("use", "u", ":use <NAME> (--wait)", 
+        "Make the document current, waiting for it to load if needed.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandClose : public Command
+{
+    DocumentRegistry& documents;
+    WatchList& watches;
+
+public:
+    CommandClose(DocumentRegistry& documents, WatchList& watches) : documents(documents), watches(watches),
+        Command("close", "cl", ":close <NAME>", "Close the document, cancelling its loading.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandWait : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandWait(DocumentRegistry& documents) : documents(documents),
+        Command("wait", "w", ":wait (<NAME>)", "Wait for the document to load.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandDocuments : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandDocuments(DocumentRegistry& documents) : documents(documents),
+        Command("documents", "d", ":documents", "List open documents and their loading progress.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandWatch : public Command
+{
+    DocumentRegistry& documents;
+    WatchList& watches;
+
+public:
+    CommandWatch(DocumentRegistry& documents, WatchList& watches) : documents(documents), watches(watches),
+        Command("watch", "wt", ":watch (<EXPR>)",
+        "Apply changes of the file as it is modified, and show the expression whenever it changes.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandUnwatch : public Command
+{
+    DocumentRegistry& documents;
+    WatchList& watches;
+
+public:
+    CommandUnwatch(DocumentRegistry& documents, WatchList& watches) : documents(documents), watches(watches),
+        Command("unwatch", "uw", ":unwatch", "Stop watching the file and drop its expressions.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandPathIndex : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandPathIndex(DocumentRegistry& documents) : documents(documents),
+        Command("pathindex", "pi", ":pathindex (--drop)",
+        "Index all paths of the document, so that queries do not walk the tree, or drop the index.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandBatch : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandBatch(DocumentRegistry& documents) : documents(documents),
+        Command("batch", "ba", ":batch <FILE> (--threads=N)",
+        "Evaluate the queries of the file, one per line, in parallel, and print the results in order.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandPublish : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandPublish(DocumentRegistry& documents) : documents(documents),
+        Command("publish", "pb", ":publish <NAME> (--drop)",
+        "Publish the current document in shared memory, for other processes to open with --shared. --drop removes it.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandSet : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandSet(DocumentRegistry& documents) : documents(documents),
+        Command("set", "se", ":set <PATH> <VALUE>",
+        "Set the member or element at the path to a JSON value, adding a member or appending an element if needed.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandInsert : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandInsert(DocumentRegistry& documents) : documents(documents),
+        Command("insert", "in", ":insert <PATH> <VALUE>",
+        "Insert a JSON value into a list before the element at the path, or add a new member.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandDelete : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandDelete(DocumentRegistry& documents) : documents(documents),
+        Command("delete", "del", ":delete <PATH>", "Remove the member or element at the path.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandUndo : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandUndo(DocumentRegistry& documents) : documents(documents),
+        Command("undo", "un", ":undo (<NUM_EDITS>) (--to=VERSION)",
+        "Undo the last edits, or go to the version, before or after the current one until another edit is made.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandChanges : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandChanges(DocumentRegistry& documents) : documents(documents),
+        Command("changes", "ch", ":changes (<VERSION>)",
+        "Show the current version, and the paths edited between it and the version, or since the file was loaded.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandSave : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandSave(DocumentRegistry& documents) : documents(documents),
+        Command("save", "sv", ":save (<FILE>)",
+        "Write the current document to the file, or back to its own file. Values that were not edited are copied as they were read.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
+
+class CommandPatch : public Command
+{
+    DocumentRegistry& documents;
+
+public:
+    CommandPatch(DocumentRegistry& documents) : documents(documents),
+        Command("patch", "pa", ":patch <FILE>",
+        "Apply a JSON Patch (RFC 6902) from the file to the current document, either all of its operations or none.") { }
+
+    void Execute(const CommandLineInterpreter& interpreter) const override;
+};
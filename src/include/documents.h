@@ -0,0 +1,157 @@
+/*****************************************************************//**
+ * \file   documents.h
+ * \brief  Registry of the JSON documents open in one session,
+ *         each of them loaded on a background thread.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+#include "watch.h"
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+
+enum class DOCUMENT_STATE
+{
+    DOCUMENT_STATE_LOADING = 0,
+    DOCUMENT_STATE_READY = 1,
+    DOCUMENT_STATE_FAILED = 2,
+};
+
+// Result of applying the changes of a file to its document.
+struct JSONDocumentUpdate
+{
+    bool changed = false;
+    bool whole = false;     // The whole tree was replaced
+    JSONPath path;          // Otherwise, path of the replaced container
+    std::string error;      // The file could not be read, and the document is kept as it was
+    double seconds = 0;
+};
+
+// JSON file loaded on its own thread. Once it is ready, the document has its own
+// interface, so each document keeps the object selected in it.
+class JSONDocument
+{
+    const std::string name;
+    const std::string path;
+    const JSONLoadOptions options;
+
+    JSONLoadProgress progress;
+
+    // Guards the state and everything set when the loading ends
+    mutable std::mutex mutex;
+    std::condition_variable loaded;
+
+    DOCUMENT_STATE state = DOCUMENT_STATE::DOCUMENT_STATE_LOADING;
+    std::string error;
+    double loadSeconds = 0;
+
+    std::unique_ptr<JSON> json;
+    std::unique_ptr<JSONInterface> jsonInterface;
+
+    std::unique_ptr<FileWatcher> watcher;
+
+    std::thread thread;     // Started last, when the rest is initialized
+
+    // Body of the loading thread.
+    void Load(JSONLoadOptions options);
+
+public:
+    // Start loading the file in the background.
+    JSONDocument(const std::string& name, const std::string& path, const JSONLoadOptions& options);
+
+    // Cancels the loading if it is still in progress, and waits for the thread to finish.
+    ~JSONDocument();
+
+    JSONDocument& operator=(const JSONDocument& rhs) = delete;
+    JSONDocument(const JSONDocument& other) = delete;
+
+    const std::string& GetName() const { return name; }
+    const std::string& GetPath() const { return path; }
+
+    DOCUMENT_STATE GetState() const;
+
+    // Syntax error or other reason of the failure.
+    std::string GetError() const;
+
+    double GetLoadSeconds() const;
+
+    const JSONLoadProgress& GetProgress() const { return progress; }
+
+    // Wait until the document is either ready or failed. Returns false on timeout.
+    bool Wait(std::chrono::milliseconds timeout);
+
+    // Interface to the document, or nullptr if it is not ready.
+    JSONInterface* GetInterface();
+
+    // Tree of the document, or nullptr if it is not ready.
+    JSON* GetJSON();
+
+    // Apply the changes of the file to a ready document. Only the changed part is parsed again,
+    // unless the tree was not parsed as a whole. The selected object is kept if it still exists.
+    JSONDocumentUpdate Reload();
+
+    // Call the handler on another thread whenever the file is modified.
+    void Watch(FileWatcher::Handler onChange);
+    void Unwatch() { watcher.reset(); }
+    bool IsWatched() const { return watcher != nullptr; }
+
+    // Brief description of the state, e.g. "loading: parsing 42%".
+    std::string Describe() const;
+};
+
+// Called when a watched document was updated, with the registry locked.
+using DocumentUpdateHandler = std::function<void(JSONDocument& document, const JSONDocumentUpdate& update)>;
+
+// Documents of a session, by their names. The registry is meant to be used from one thread,
+// while the documents are loaded concurrently in the background. Watched documents are updated
+// by other threads, which lock the registry to do it.
+class DocumentRegistry
+{
+    std::map<std::string, std::unique_ptr<JSONDocument>> documents;
+    std::string current;
+
+    std::timed_mutex mutex;
+
+    std::set<std::string> reported;     // Documents whose loading was already reported
+
+public:
+    // Start loading a document under the name. Returns false if the name is taken.
+    // The first document becomes the current one.
+    bool Open(const std::string& name, const std::string& path, const JSONLoadOptions& options = JSONLoadOptions());
+
+    // Close the document, cancelling its loading. Returns false if there is no such document.
+    bool Close(const std::string& name);
+
+    // Make the document current. Returns false if there is no such document.
+    bool Use(const std::string& name);
+
+    JSONDocument* Find(const std::string& name);
+
+    // nullptr if no document is open.
+    JSONDocument* Current();
+
+    const std::map<std::string, std::unique_ptr<JSONDocument>>& Documents() const { return documents; }
+
+    // Messages about documents that finished loading since the last call.
+    std::vector<std::string> PollFinished();
+
+    // Reload the document whenever its file is modified. Returns false if there is no such document.
+    bool Watch(const std::string& name, DocumentUpdateHandler onUpdate);
+    bool Unwatch(const std::string& name);
+
+    // Must be held while the documents are used, if any of them is watched.
+    std::timed_mutex& GetMutex() { return mutex; }
+};
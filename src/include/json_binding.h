@@ -0,0 +1,352 @@
+/*****************************************************************//**
+ * \file   json_binding.h
+ * \brief  Reading of documents straight into C++ structs, vectors
+ *         and maps, without building a tree.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+#include "snapshot.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <optional>
+#include <tuple>
+#include <array>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+// Members of a struct are bound to the keys of an object by listing them once, next to the struct
+// and in the same namespace:
+//
+//     struct Server { std::string host; int port = 80; std::vector<std::string> tags; };
+//     JSON_BINDING(Server, JSON_FIELD(host), JSON_FIELD(port), JSON_FIELD_NAMED("labels", tags))
+//
+//     std::vector<Server> servers;
+//     jsonbinding::ReadFile("servers.json", servers);
+//
+// Fields may be of bound structs, bool, integer and floating-point types, std::string, std::vector,
+// std::map and std::unordered_map with string keys, and std::optional, which takes null as well.
+#define JSON_BINDING(Type, ...) \
+    inline const auto& JSONFieldsOf(const Type*) \
+    { \
+        using Self = Type; \
+        static const auto fields = std::make_tuple(__VA_ARGS__); \
+        return fields; \
+    }
+
+#define JSON_FIELD(member) jsonbinding::Field<Self, decltype(Self::member)>{ #member, &Self::member }
+#define JSON_FIELD_NAMED(key, member) jsonbinding::Field<Self, decltype(Self::member)>{ key, &Self::member }
+
+// The reader goes over the text once, and each value is read by the code for the type it goes to,
+// compiled for that type. Keys without a field and their values are skipped, looking for the closing
+// quote or bracket only. Fields not in the object keep their values, and a repeated key overwrites
+// the earlier one. Values of another type than their field are an error, e.g. a string for an int,
+// a number with a fraction for an integer, or a number out of its range. Errors throw JSONLoadError,
+// with the line and the path of the value, e.g. "[ERROR] servers.json:3 - Expected a number, found
+// a string at \"[1].port\"."
+namespace jsonbinding
+{
+    template <class Struct, class Member>
+    struct Field
+    {
+        std::string_view key;
+        Member Struct::* member;
+    };
+
+    // Error of a value, which the containers around it add their step to on the way up.
+    struct BindError
+    {
+        std::string message;
+        size_t pos;
+        std::string path;
+    };
+
+    // Cursor over the text of the document. Containers are read as their members or elements come.
+    class Reader
+    {
+        std::string_view text;
+        size_t pos = 0;
+        size_t depth = 0;
+        bool fresh = false;     // A container was just entered, so no ',' comes before its first member
+        std::string scratch;    // Keys with escape sequences, decoded
+
+        void SkipSpaces()
+        {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t')) pos++;
+        }
+
+        // Position after the string whose opening quote is at pos. Escape sequences are not decoded.
+        size_t SkipString(size_t at) const;
+
+        // Number at the position, checked against the grammar of RFC 8259.
+        std::string_view ScanNumber();
+
+        void Enter(char opening);
+
+    public:
+        explicit Reader(std::string_view text) : text(text) { }
+
+        // Next character that is not whitespace, without taking it, or '\0' at the end.
+        char Peek()
+        {
+            SkipSpaces();
+            return pos < text.size() ? text[pos] : '\0';
+        }
+
+        size_t Pos() const { return pos; }
+
+        [[noreturn]] void Fail(const std::string& message) const { throw BindError{ message, pos, "" }; }
+
+        // Fail, telling what the next value is instead, e.g. "Expected a string, found a number."
+        [[noreturn]] void Mismatch(const char* expected);
+
+        // Take null, if it is the next value.
+        bool ReadNull();
+
+        bool ReadBool();
+        std::string_view ReadInteger();     // Text of a number without a fraction or an exponent
+        double ReadDouble();
+        void ReadString(std::string& value);
+
+        // Take the '{' of an object, then its keys by NextMember(..), which returns false at the '}'.
+        // Keys are valid until the next one.
+        void BeginObject();
+        bool NextMember(std::string_view& key);
+
+        // Same for the elements of a list.
+        void BeginList();
+        bool NextElement();
+
+        void SkipValue();
+
+        // Fail unless only whitespace is left.
+        void End();
+    };
+
+    // Value of the text of an integer, or false if it does not fit.
+    bool ParseInteger(std::string_view text, int64_t& value);
+    bool ParseInteger(std::string_view text, uint64_t& value);
+
+    // Reads a value into an object of the type.
+    template <class T, class Enable = void>
+    struct Binder
+    {
+        static_assert(sizeof(T) == 0, "The type cannot be bound, see JSON_BINDING.");
+    };
+
+    template <class T>
+    void ReadValue(Reader& reader, T& value) { Binder<T>::Read(reader, value); }
+
+    template <>
+    struct Binder<bool>
+    {
+        static void Read(Reader& reader, bool& value) { value = reader.ReadBool(); }
+    };
+
+    // Integers other than bool, which fail if the number does not fit.
+    template <class T>
+    struct Binder<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+    {
+        static void Read(Reader& reader, T& value)
+        {
+            using Wide = std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>;
+            Wide wide;
+            if (!ParseInteger(reader.ReadInteger(), wide) || wide < (Wide)std::numeric_limits<T>::min()
+                || wide > (Wide)std::numeric_limits<T>::max())
+            {
+                reader.Fail("Number is out of range of the field.");
+            }
+            value = (T)wide;
+        }
+    };
+
+    template <class T>
+    struct Binder<T, std::enable_if_t<std::is_floating_point_v<T>>>
+    {
+        static void Read(Reader& reader, T& value) { value = (T)reader.ReadDouble(); }
+    };
+
+    template <>
+    struct Binder<std::string>
+    {
+        static void Read(Reader& reader, std::string& value) { reader.ReadString(value); }
+    };
+
+    template <class T>
+    struct Binder<std::optional<T>>
+    {
+        static void Read(Reader& reader, std::optional<T>& value)
+        {
+            if (reader.ReadNull())
+            {
+                value.reset();
+                return;
+            }
+            if (!value) value.emplace();
+            Binder<T>::Read(reader, *value);
+        }
+    };
+
+    // The path of an error is built from the inside out, as the containers it is in are left.
+    inline void AddIndex(BindError& error, size_t index)
+    {
+        error.path = "[" + std::to_string(index) + "]" + error.path;
+    }
+
+    inline void AddKey(BindError& error, std::string_view key)
+    {
+        error.path = "." + std::string(key) + error.path;
+    }
+
+    template <class T, class Allocator>
+    struct Binder<std::vector<T, Allocator>>
+    {
+        static void Read(Reader& reader, std::vector<T, Allocator>& value)
+        {
+            value.clear();
+            reader.BeginList();
+            while (reader.NextElement())
+            {
+                try
+                {
+                    // Elements of std::vector<bool> are not bools themselves
+                    if constexpr (std::is_same_v<T, bool>) value.push_back(reader.ReadBool());
+                    else
+                    {
+                        value.emplace_back();
+                        Binder<T>::Read(reader, value.back());
+                    }
+                }
+                catch (BindError& error)
+                {
+                    AddIndex(error, value.size() - (std::is_same_v<T, bool> ? 0 : 1));
+                    throw;
+                }
+            }
+        }
+    };
+
+    // Objects read into maps from their keys to values.
+    template <class Map>
+    void ReadMap(Reader& reader, Map& value)
+    {
+        value.clear();
+        reader.BeginObject();
+        std::string_view key;
+        while (reader.NextMember(key))
+        {
+            // The key is kept by the map, as the view may be overwritten by the keys inside the value
+            auto member = value.try_emplace(std::string(key)).first;
+            try
+            {
+                Binder<typename Map::mapped_type>::Read(reader, member->second);
+            }
+            catch (BindError& error)
+            {
+                AddKey(error, member->first);
+                throw;
+            }
+        }
+    }
+
+    template <class T, class Compare, class Allocator>
+    struct Binder<std::map<std::string, T, Compare, Allocator>>
+    {
+        static void Read(Reader& reader, std::map<std::string, T, Compare, Allocator>& value) { ReadMap(reader, value); }
+    };
+
+    template <class T, class Hash, class Equal, class Allocator>
+    struct Binder<std::unordered_map<std::string, T, Hash, Equal, Allocator>>
+    {
+        static void Read(Reader& reader, std::unordered_map<std::string, T, Hash, Equal, Allocator>& value) { ReadMap(reader, value); }
+    };
+
+    template <class Fields, size_t... I>
+    std::array<std::string_view, sizeof...(I)> KeysOf(const Fields& fields, std::index_sequence<I...>)
+    {
+        return { std::get<I>(fields).key... };
+    }
+
+    template <class T, class Fields, size_t... I>
+    void ReadField(Reader& reader, T& value, const Fields& fields, size_t index, std::index_sequence<I...>)
+    {
+        ((I == index ? ReadValue(reader, value.*(std::get<I>(fields).member)) : void()), ...);
+    }
+
+    // Structs bound by JSON_BINDING
+    template <class T>
+    struct Binder<T, std::void_t<decltype(JSONFieldsOf((const T*)nullptr))>>
+    {
+        static void Read(Reader& reader, T& value)
+        {
+            const auto& fields = JSONFieldsOf((const T*)nullptr);
+            using Indices = std::make_index_sequence<std::tuple_size_v<std::decay_t<decltype(fields)>>>;
+            static const auto keys = KeysOf(fields, Indices());
+
+            // Keys usually come in the order of the fields, so the one after the last match is tried first
+            size_t expected = 0;
+            reader.BeginObject();
+            std::string_view key;
+            while (reader.NextMember(key))
+            {
+                size_t index = expected < keys.size() && keys[expected] == key ? expected
+                    : std::find(keys.begin(), keys.end(), key) - keys.begin();
+                if (index == keys.size())
+                {
+                    reader.SkipValue();
+                    continue;
+                }
+
+                try
+                {
+                    ReadField(reader, value, fields, index, Indices());
+                }
+                catch (BindError& error)
+                {
+                    AddKey(error, keys[index]);
+                    throw;
+                }
+                expected = index + 1;
+            }
+        }
+    };
+
+    // Throw the error as JSONLoadError, with the line of its position in the text.
+    [[noreturn]] void Throw(const BindError& error, std::string_view text, const std::string& name);
+
+    // Read the document into value. The name of the document is used in messages.
+    template <class T>
+    void Read(std::string_view text, T& value, const std::string& name = "value")
+    {
+        Reader reader(text);
+        try
+        {
+            ReadValue(reader, value);
+            reader.End();
+        }
+        catch (const BindError& error)
+        {
+            Throw(error, text, name);
+        }
+    }
+
+    // Same for a file, which is memory-mapped rather than read.
+    template <class T>
+    void ReadFile(const std::string& filename, T& value)
+    {
+        MappedFile file(filename);
+        if (!file.IsOpen()) throw JSONLoadError("[ERROR] " + filename + " - JSON file does not exist or is empty.");
+        Read(std::string_view(file.Data(), file.Size()), value, filename);
+    }
+}
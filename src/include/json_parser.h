@@ -6,10 +6,22 @@
  * \date   October 2024
  *********************************************************************/
 
+#pragma once
+
 #include <string>
 #include <unordered_map>
 #include <iostream>
 #include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+#include <functional>
+#include <string_view>
+
+#include "parse_policy.h"
 
 #define SYNTAX_MSG_TYPE_ERROR 0
 #define SYNTAX_MSG_TYPE_WARNING 1
@@ -18,14 +30,74 @@
 // Forward declaration to use in JSONSource
 class JSONString;
 
+// Progress of loading a JSON file, which may be read by other threads while it is loaded.
+struct JSONLoadProgress
+{
+    enum Stage { STAGE_READING, STAGE_TRIMMING, STAGE_PARSING, STAGE_SAVING, STAGE_DONE };
+
+    std::atomic<int> stage = STAGE_READING;
+    std::atomic<uint64_t> done = 0;         // Characters processed at the current stage
+    std::atomic<uint64_t> total = 0;        // Characters to process at the current stage
+
+    std::atomic<bool> cancelled = false;    // Set by other threads to stop the loading
+
+    static std::string ToString(int stage)
+    {
+        switch (stage) {
+        case STAGE_READING:
+            return "reading";
+        case STAGE_TRIMMING:
+            return "trimming";
+        case STAGE_PARSING:
+            return "parsing";
+        case STAGE_SAVING:
+            return "saving";
+        default:
+            return "done";
+        }
+    }
+
+    // Completion of the current stage in percent.
+    int Percent() const
+    {
+        uint64_t all = total.load(std::memory_order_relaxed);
+        if (all == 0) return 0;
+        return (int)(done.load(std::memory_order_relaxed) * 100 / all);
+    }
+};
+
+// Thrown instead of exiting on a syntax error, when the file is loaded
+// with JSONLoadOptions::exitOnError unset, and when the loading is cancelled.
+class JSONLoadError : public std::runtime_error
+{
+public:
+    JSONLoadError(const std::string& message) : std::runtime_error(message) { }
+};
+
 // JSONSource - class providing underlying data for JSONString's and used
 // for error reporting, where each JSONString knows its offset from the source start.
 // The class provides functionality to find a line and column of given character offset.
 class JSONSource
 {
     const std::string filename;
+    const size_t fileOffset = 0;    // Offset of sourceStr in the file, if only a part of it was read
+
+    JSONLoadProgress* const progress = nullptr;    // No ownership, may be nullptr
+    const bool exitOnError = true;
+    const JSON_PARSE_POLICY policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT;
+
+    // Trimmed position of the first control character in a string, if the policy rejects them
+    size_t invalidPos = std::string::npos;
+
+    // Trimmed position of the first byte that is not valid UTF-8, unless the policy keeps them
+    size_t invalidUtf8Pos = std::string::npos;
 
     const std::string sourceStr;	// String as in initial JSON file
+
+    // Runs of characters kept by trimming, as pairs of (trimmed position, source position).
+    // Used to map trimmed positions back to the source without scanning it.
+    std::vector<std::pair<size_t, size_t>> offsetMap;
+
     const std::string trimmedStr;	// String without whilespaces (outside strings), newlines and tabs.
                                     // This is the string we will work with from now on.
 
@@ -33,6 +105,24 @@ class JSONSource
     friend class JSONString;
     const char* data() { return trimmedStr.data(); }
 
+    // Text of a file as read and trimmed, before it is moved into the members.
+    struct LoadedText
+    {
+        std::string source;
+        std::vector<std::pair<size_t, size_t>> offsetMap;
+        std::string trimmed;
+        size_t invalidPos = std::string::npos;
+        size_t invalidUtf8Pos = std::string::npos;
+    };
+
+    // Plain files are read at once. Others, such as the standard input, pipes and compressed files,
+    // are read in blocks on a thread of its own, and each block is trimmed while the next are read.
+    static LoadedText ReadText(const std::string& filename, JSON_PARSE_POLICY policy, size_t trimThreads,
+        JSONLoadProgress* progress);
+
+    JSONSource(std::string filename, JSONLoadProgress* progress, bool exitOnError, JSON_PARSE_POLICY policy,
+        LoadedText&& text);
+
 public:
     // Struct to represent position of a character
     struct Pos
@@ -51,15 +141,61 @@ public:
         }
     };
 
-    JSONSource(std::string filename);				// Read and trim source fi
+    // Read and trim source file. "-" is the standard input, and files compressed with gzip or zstd
+    // are decompressed as they are read, if the build has the library for it (see byte_stream.h).
+    JSONSource(std::string filename);
+
+    // Same, reporting the progress of reading, trimming and parsing. Unless exitOnError is set,
+    // syntax errors throw JSONLoadError, so that the file can be loaded in the background.
+    // Large files are trimmed on trimThreads threads, zero meaning one per hardware thread.
+    JSONSource(std::string filename, JSONLoadProgress* progress, bool exitOnError,
+        JSON_PARSE_POLICY policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT, size_t trimThreads = 0);
+
+    // Trim a part of a file that was already read, e.g. a value found through the offset index.
+    // Contents must start and end outside of a string literal.
+    JSONSource(std::string filename, std::string contents, size_t fileOffset, bool exitOnError = true,
+        JSON_PARSE_POLICY policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT);
+
     Pos GetSymbolSourcePosition(size_t trimmedPos);	// Iterate the file to find position
 
+    // Offset in the file of the character at the given trimmed position.
+    // Trimmed positions past the end map to the end of the source.
+    size_t GetFileOffset(size_t trimmedPos);
+
+    // Trimmed position of the character at the given offset in the file, which must be kept by trimming.
+    size_t GetTrimmedPos(size_t fileOffset);
+
     // Return an initial JSONString, with offset of zero and whole size.
     // This is supposed to be the only way to get JSONString not from another instance.
     JSONString GetString();
 
     // Getter for file name, used in debugging.
     std::string GetFilename() { return filename; }
+
+    // Trimmed string, for comparing versions of a file.
+    const std::string& GetTrimmed() const { return trimmedStr; }
+
+    // String as read, which starts at GetFileOffset(0) in the file.
+    const std::string& GetText() const { return sourceStr; }
+
+    bool ExitsOnError() const { return exitOnError; }
+
+    JSON_PARSE_POLICY GetPolicy() const { return policy; }
+
+    // Trimmed position of the first character the policy rejects in trimming, or std::string::npos.
+    size_t GetInvalidPos() const { return invalidPos; }
+
+    // Trimmed position of the first byte that is not valid UTF-8, or std::string::npos.
+    size_t GetInvalidUtf8Pos() const { return invalidUtf8Pos; }
+
+    // Called by the parser as it goes through the trimmed string. Throws JSONLoadError if
+    // the loading was cancelled.
+    void ReportProgress(size_t trimmedPos)
+    {
+        if (!progress) return;
+        progress->done.store(trimmedPos, std::memory_order_relaxed);
+        if (progress->cancelled.load(std::memory_order_relaxed)) throw JSONLoadError("Loading cancelled.");
+    }
 };
 
 
@@ -141,6 +277,9 @@ public:
     // By creation, instance of JSONString cannot contain nullptr JSONSource pointer.
     JSONSource* GetSource() const { return source; }
 
+    // Position of the first character in the trimmed source string.
+    size_t GetOffset() const { return data - source->data(); }
+
 
     // Some common string functionality
 
@@ -162,10 +301,20 @@ public:
         return std::string(data, size);
     }
 
+    // Characters of the string, valid as long as the source is.
+    std::string_view View() const
+    {
+        return std::string_view(data, size);
+    }
+
     // String-specific message handling
     void PrintSyntaxMsg(std::string errorText, int msgType = 0, size_t _Off = 0) const;
 
-    // Scan string at the beginning, bounded by '"'.
+    // Scan string at the beginning, bounded by '"', under the policy of the source.
+    std::string ScanString(size_t& _Pos);
+
+    // Same, under the rules of the policy.
+    template <class Policy>
     std::string ScanString(size_t& _Pos);
 
     // Scan {..} or [..]
@@ -174,15 +323,91 @@ public:
     JSONString ScanLiteral(size_t& _Pos);
 };
 
+// Decoding of the literals that the parser left to be decoded on first access (see JSON::JSONLiteral).
+// The text is the literal as it is in the trimmed source, which the parser checked to be valid.
+void decode_literal(std::string_view text, std::string& value);
+void decode_literal(std::string_view text, int& value);
+void decode_literal(std::string_view text, double& value);
+void decode_literal(std::string_view text, bool& value);
+
 class JSONInterface;
 class Expr;
+class JSONNodeLoader;
+class JSONPathIndex;
+class JSONProjection;
+
+// Options that control how a JSON file is loaded.
+struct JSONLoadOptions
+{
+    // Reuse the binary snapshot stored next to the file if it is still valid
+    // for it, and write a new one after a successful parse (see snapshot.h).
+    bool useSnapshot = false;
+
+    // Same for the structural offset index (see offset_index.h). Containers of at
+    // least indexThreshold bytes are indexed.
+    bool useIndex = false;
+    uint64_t indexThreshold = 64 * 1024;
+
+    // Return as soon as the members of the root object are known, and parse objects and lists
+    // of at least progressiveThreshold bytes in the background (see progressive.h).
+    // Does not apply if a snapshot is to be written, as it needs the whole tree.
+    bool progressive = false;
+    uint64_t progressiveThreshold = 64 * 1024;
+
+    // Look up queried paths in an index of the whole tree (see path_index.h), built on the first query.
+    bool pathIndex = false;
+
+    // The file name is the name of a shared-memory segment published by another process
+    // (see snapshot.h), which is attached to read-only instead of reading a file.
+    bool attachShared = false;
+
+    // Progress to report, if the file is loaded in the background. No ownership.
+    JSONLoadProgress* progress = nullptr;
+
+    // Exit on a syntax error, as the CLI always did. If unset, JSONLoadError is thrown instead.
+    bool exitOnError = true;
+
+    // Rules of the syntax (see parse_policy.h). Files read through a snapshot or an index
+    // were checked when they were written.
+    JSON_PARSE_POLICY policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT;
+
+    // Threads removing the whitespace of the file before it is parsed, zero meaning one per hardware
+    // thread. Files are split into chunks of at least 64 KiB, so small files are trimmed on one thread.
+    size_t trimThreads = 0;
+
+    // Paths to build the tree along, e.g. "meta.version" and "records[*].id", with everything
+    // else skipped (see projection.h). Empty to build the whole tree. Snapshots, indices and
+    // progressive parsing are not used for a projected tree, as they cover the whole file.
+    std::vector<std::string> projection;
+};
+
+// Step from a container to its child, by a member identifier or a list index.
+struct JSONPathStep
+{
+    bool isIndex = false;
+    std::string identifier;
+    size_t index = 0;
+
+    bool operator==(const JSONPathStep& other) const
+    {
+        return isIndex == other.isIndex && (isIndex ? index == other.index : identifier == other.identifier);
+    }
+};
+
+// Location of a node, as steps from the root object.
+using JSONPath = std::vector<JSONPathStep>;
 
 // Class to represent JSON syntax tree.
+//
+// Once loaded, the tree may be read from any number of threads, each with its own interface:
+// containers loaded lazily are expanded once under std::call_once and their loaders' locks,
+// and the path index is built under a lock. Update(..) and the loading itself are the only
+// writers, and must not run concurrently with the readers.
 class JSON
 {
 public:
     // Create JSON from file
-    JSON(const std::string& filename);
+    JSON(const std::string& filename, const JSONLoadOptions& options = JSONLoadOptions());
 
     // Forbid copying (potentially to be implemented later)
     JSON& operator=(const JSON& rhs) = delete;
@@ -224,6 +449,11 @@ public:
 
     static bool isLiteral(JSON_NODE_TYPE type) { return (int)type > 1; }
 
+    static bool isContainer(JSON_NODE_TYPE type)
+    {
+        return type == JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT || type == JSON_NODE_TYPE::JSON_NODE_TYPE_LIST;
+    }
+
     static bool isNumericLiteral(JSON_NODE_TYPE type) 
     {
         return type == JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT
@@ -240,6 +470,14 @@ public:
         // It is expected that type of the node cannot be changed during runtime.
         const JSON_NODE_TYPE type = JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_NULL;
 
+        // Set when the contents of a container are edited, so they no longer match its span
+        bool dirty = false;
+
+        // Bytes of the value in the file it was read from, [spanBegin, spanEnd), if spanEnd is not zero.
+        // A member put in place of another one keeps its spanBegin only, as its position in the object.
+        uint64_t spanBegin = 0;
+        uint64_t spanEnd = 0;
+
     public:
         JSONNode(JSON_NODE_TYPE nodeType, JSONNode* parent) : type(nodeType), parent(parent) { }
 
@@ -252,69 +490,324 @@ public:
 
         JSONNode* GetParent() { return parent; }
 
+        // Used when the node is put into another container.
+        void SetParent(JSONNode* node) { parent = node; }
+
+        bool HasSpan() const { return spanEnd != 0; }
+        uint64_t GetSpanBegin() const { return spanBegin; }
+        uint64_t GetSpanEnd() const { return spanEnd; }
+
+        void SetSpan(uint64_t begin, uint64_t end)
+        {
+            spanBegin = begin;
+            spanEnd = end;
+        }
+
+        // Whether the node was edited since it was read, so its span cannot be copied as it is.
+        bool IsDirty() const { return dirty; }
+
+        // Mark the node and the containers above it as edited.
+        void MarkDirty()
+        {
+            for (JSONNode* node = this; node && !node->dirty; node = node->parent) node->dirty = true;
+        }
+
         friend class JSONInterface;
     };
 
    
 
+    class JSONTreeIterator;
+
+    // Common base of objects and lists.
+    // Containers read from a snapshot or through an index are created empty, and their
+    // contents are provided by the loader on first access. Before that, single children
+    // can be looked up through the loader without expanding the whole container.
+    // All access to the contents goes through Expand(), which is safe to call from several threads.
+    class JSONContainer : public JSONNode
+    {
+        std::once_flag expanded;
+        std::atomic<bool> complete = false;
+
+    protected:
+        JSONNodeLoader* loader = nullptr;   // No ownership, the loader belongs to JSON
+        uint64_t loaderRef = 0;             // Location of the contents, meaningful to the loader only
+
+        // Delete the contents that are present, without expanding the container. Used by the destructors,
+        // which would otherwise go down the tree by recursion, one level of the stack per level of the tree.
+        void DeleteContents();
+
+    public:
+        JSONContainer(JSON_NODE_TYPE nodeType, JSONNode* parent) : JSONNode(nodeType, parent) { }
+
+        // Defer the contents of this container to the loader.
+        void SetLoader(JSONNodeLoader* nodeLoader, uint64_t ref)
+        {
+            loader = nodeLoader;
+            loaderRef = ref;
+        }
+
+        bool IsExpanded() const { return !loader || complete.load(std::memory_order_acquire); }
+
+        // Make sure the contents are present.
+        void Expand();
+    };
+
+
+
+    // Keys of an object in the order they were added, shared by every object with the same keys,
+    // such as the elements of a list of records. Shared shapes form a tree, where each shape
+    // adds one key to its parent, and lives as long as the program. Objects with too many members,
+    // or under shapes with too many different next keys, have a shape of their own instead.
+    class JSONShape
+    {
+        const JSONShape* parent = nullptr;
+        std::string key;                // Last key, of shared shapes
+        uint32_t size = 0;
+        uint32_t id = 0;                // Zero for shapes owned by a single object
+
+        // Shared shapes with one more key. A null shape marks a key that is already taken.
+        mutable std::shared_mutex transitionsMutex;
+        mutable std::unordered_map<std::string, std::unique_ptr<JSONShape>> transitions;
+
+        // Slots of the keys and keys of the slots, built on first lookup for shared shapes
+        mutable std::once_flag indexed;
+        mutable std::unordered_map<std::string, uint32_t> index;
+        mutable std::vector<const std::string*> keys;
+
+        JSONShape(const JSONShape* parent, const std::string& key);
+
+        // Empty shared shape
+        explicit JSONShape(bool) : id(1) { }
+
+        void BuildIndex() const;
+
+    public:
+        static constexpr uint32_t MaxSize = 64;
+        static constexpr size_t MaxTransitions = 256;
+
+        // Own shape with the keys of the other one.
+        JSONShape(const JSONShape& other);
+
+        // Shared shape without keys.
+        static const JSONShape* Empty();
+
+        uint32_t Size() const { return size; }
+        uint32_t Id() const { return id; }
+        bool IsShared() const { return id != 0; }
+
+        // Shared shape with the key added, or nullptr if there is none: taken is set if the key
+        // is already there, otherwise the object needs an own shape.
+        const JSONShape* Add(const std::string& key, bool& taken) const;
+
+        // Slot of the key, or -1 if there is none.
+        int64_t SlotOf(const std::string& key) const;
+
+        const std::string& KeyAt(uint32_t slot) const;
+
+        // Add a key to an own shape. Returns false if it is already there.
+        bool Append(const std::string& key);
+
+        // Same, at the slot, moving the later ones up.
+        bool Insert(uint32_t slot, const std::string& key);
+
+        // Remove the key of the slot from an own shape, moving the later ones down.
+        void Remove(uint32_t slot);
+    };
+
+    // Inline cache of a member lookup repeated over many objects, e.g. by a step of a query:
+    // remembers the slot of the key in the last shared shape seen. Safe to share between threads.
+    struct JSONMemberCache
+    {
+        std::atomic<uint64_t> entry = 0;    // Id of the shape in the high half, slot in the low one
+
+        JSONMemberCache() = default;
+        JSONMemberCache(const JSONMemberCache& other) : entry(other.entry.load(std::memory_order_relaxed)) { }
+    };
+
+
+
     // JSON object - contains a list of identifiers and links further down the tree.
-    class JSONObject : public JSONNode
+    // Members are kept in slots, in the order of the keys of the shape.
+    class JSONObject : public JSONContainer
     {
+        const JSONShape* shape = JSONShape::Empty();
+        std::unique_ptr<JSONShape> ownShape;    // Shape is this one, if it is not shared
+        std::vector<JSONNode*> slots;
+
+        // Switch to an own shape with the same keys.
+        void MakeOwnShape();
+
+        friend class JSONContainer;
+        friend class JSONTreeIterator;
+
     public:
-        std::unordered_map<std::string, JSONNode*> members;
+        // Members in order, as pairs of the key and the node.
+        class MemberIterator
+        {
+            const JSONObject* object;
+            uint32_t slot;
+
+        public:
+            MemberIterator(const JSONObject* object, uint32_t slot) : object(object), slot(slot) { }
+
+            std::pair<const std::string&, JSONNode*> operator*() const
+            {
+                return { object->shape->KeyAt(slot), object->slots[slot] };
+            }
 
-        JSONObject(JSONNode* parent) : JSONNode(JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT, parent) 
+            MemberIterator& operator++()
+            {
+                slot++;
+                return *this;
+            }
+
+            bool operator!=(const MemberIterator& other) const { return slot != other.slot; }
+        };
+
+        struct MemberRange
+        {
+            const JSONObject* object;
+
+            MemberIterator begin() const { return { object, 0 }; }
+            MemberIterator end() const { return { object, (uint32_t)object->slots.size() }; }
+        };
+
+        JSONObject(JSONNode* parent) : JSONContainer(JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT, parent) 
         {
         }
 
         void ListMembers(bool showValue = false, unsigned int depth = 0,
             unsigned int maxDepth = UINT32_MAX);
 
-        JSONNode* Find(std::string identifier)
+        // Member with the identifier, or nullptr if there is none.
+        JSONNode* Find(const std::string& identifier);
+
+        bool Contains(const std::string& identifier)
         {
-            // Cannot find this member
-            if (members.find(identifier) == members.end())
-            {
-                std::string errorMsg = "[ERROR] Cannot find member \"";
-                errorMsg += identifier;
-                errorMsg += "\" of the object.";
-                std::cout << errorMsg << std::endl;
-                return nullptr;
-            }
+            Expand();
+            return FindLoaded(identifier) != nullptr;
+        }
+
+        // Look up among the members that are already present, without expanding the object.
+        // Used by the parser and loaders.
+        JSONNode* FindLoaded(const std::string& identifier) const
+        {
+            int64_t slot = shape->SlotOf(identifier);
+            return slot < 0 ? nullptr : slots[slot];
+        }
 
-            // Node is an object, and given identifier exists
-            return members.at(identifier);
+        // Same, skipping the lookup if the object has the shape last seen by the cache.
+        JSONNode* FindLoaded(const std::string& identifier, JSONMemberCache& cache) const;
+
+        // Add a member. Returns false if the identifier is already taken.
+        // Used by the parser and loaders, which own the object at that point.
+        bool Insert(const std::string& identifier, JSONNode* node);
+
+        // Same, at the slot, moving the later members up. Used to bring back a member where it was.
+        bool Insert(const std::string& identifier, JSONNode* node, uint32_t slot);
+
+        // Value of the member added last. Used by the parser, which adds members before resolving them.
+        JSONNode*& LastMember() { return slots.back(); }
+
+        // Put another node in place of an existing member, and return the old one, which is not deleted.
+        JSONNode* Replace(const std::string& identifier, JSONNode* node)
+        {
+            int64_t slot = shape->SlotOf(identifier);
+            if (slot < 0) throw std::out_of_range(identifier);
+
+            JSONNode* old = slots[slot];
+            slots[slot] = node;
+            return old;
+        }
+
+        // Take an existing member out of the object, and return it. It is not deleted.
+        JSONNode* Erase(const std::string& identifier);
+
+        MemberRange Members()
+        {
+            Expand();
+            return { this };
         }
 
+        size_t Size()
+        {
+            Expand();
+            return slots.size();
+        }
+
+        const JSONShape* GetShape() const { return shape; }
+
         ~JSONObject() override
         {
-            for (std::pair member : members)
-            {
-                if (member.second) delete member.second;
-                member.second = nullptr;
-            }
+            DeleteContents();
         }
     };
 
 
     //	List - special structure in the tree, works in parallel to JSONObject.
-    class JSONList : public JSONNode
+    class JSONList : public JSONContainer
     {
-    public:
         std::vector<JSONNode*> elements;
 
-        JSONList(JSONNode* parent) : JSONNode(JSON_NODE_TYPE::JSON_NODE_TYPE_LIST, parent) 
+        friend class JSONContainer;
+        friend class JSONTreeIterator;
+
+    public:
+        JSONList(JSONNode* parent) : JSONContainer(JSON_NODE_TYPE::JSON_NODE_TYPE_LIST, parent) 
         {
         }
 
-        JSONNode* Find(size_t index)
+        // Element at the index, or nullptr if it is out of bounds.
+        JSONNode* Find(size_t index);
+
+        // Element at the index, if it is already present. Does not expand the list.
+        JSONNode* FindLoaded(size_t index) const
         {
-            if (index >= elements.size())
-            {
-                std::cout << "[ERROR] Tried to access an out-of-bound index." << std::endl;
-                return nullptr;
-            }
-            return elements.at(index);
+            return index < elements.size() ? elements[index] : nullptr;
+        }
+
+        // Add an element to the end of the list.
+        // Used by the parser and loaders, which own the list at that point.
+        void Append(JSONNode* node) { elements.push_back(node); }
+
+        // Put an element at the index of a list that has count elements in total,
+        // leaving the missing ones empty. Used by loaders that read elements out of order.
+        void SetElement(size_t index, JSONNode* node, size_t count)
+        {
+            if (elements.size() < count) elements.resize(count, nullptr);
+            elements[index] = node;
+        }
+
+        // Put another node in place of an existing element, and return the old one, which is not deleted.
+        JSONNode* Replace(size_t index, JSONNode* node)
+        {
+            JSONNode* old = elements.at(index);
+            elements[index] = node;
+            return old;
+        }
+
+        // Put an element before the one at the index, or at the end if the index is the size.
+        void Insert(size_t index, JSONNode* node) { elements.insert(elements.begin() + index, node); }
+
+        // Take an existing element out of the list, and return it. It is not deleted.
+        JSONNode* Erase(size_t index)
+        {
+            JSONNode* old = elements.at(index);
+            elements.erase(elements.begin() + index);
+            return old;
+        }
+
+        const std::vector<JSONNode*>& Elements()
+        {
+            Expand();
+            return elements;
+        }
+
+        size_t Size()
+        {
+            Expand();
+            return elements.size();
         }
 
         void ListMembers(bool showValues = false,
@@ -322,15 +815,86 @@ public:
 
         ~JSONList() override
         {
-            for (JSONNode* e : elements)
-            {
-                if (e) delete e;
-                e = nullptr;
-            }
+            DeleteContents();
         }
     };
 
 
+    // Order in which JSONTreeIterator visits containers
+    enum class JSON_TREE_ORDER
+    {
+        JSON_TREE_ORDER_PRE = 0,        // Before their children
+        JSON_TREE_ORDER_POST = 1,       // After their children
+        JSON_TREE_ORDER_BOTH = 2,       // Before and after their children, see IsExit()
+    };
+
+    // Depth-first walk over a node and everything under it. The containers it is in are kept on
+    // a stack of its own rather than that of the program, so trees of any depth can be walked:
+    //
+    //     for (JSON::JSONTreeIterator it(root); !it.AtEnd(); ++it)
+    //     {
+    //         if (it.Key() && *it.Key() == "blob") it.SkipChildren();
+    //     }
+    //
+    // Literals are visited once, in every order. Containers are expanded as they are entered,
+    // and the tree must not be edited during the walk.
+    class JSONTreeIterator
+    {
+        struct Frame
+        {
+            JSONContainer* container;
+            const std::vector<JSONNode*>* children;
+            size_t index;       // Index of the container in its parent
+            size_t next;        // Index of the child to visit next
+        };
+
+        std::vector<Frame> stack;   // Containers entered, innermost last
+        JSONNode* node = nullptr;
+        size_t index = 0;
+        bool exit = false;
+        bool skip = false;
+
+        const bool entries;
+        const bool exits;
+        const unsigned int maxDepth;
+        const bool expands;
+
+        JSONTreeIterator(JSONNode* root, JSON_TREE_ORDER order, unsigned int maxDepth, bool expands);
+
+        // Move to the next literal, or the next container before or after its children, visited or not.
+        void Step();
+
+        friend class JSONContainer;
+
+    public:
+        // Walk over root and everything under it. Containers at depths up to maxDepth, where root
+        // is at 0, are entered; deeper ones are visited without their children.
+        JSONTreeIterator(JSONNode* root, JSON_TREE_ORDER order = JSON_TREE_ORDER::JSON_TREE_ORDER_PRE,
+            unsigned int maxDepth = UINT32_MAX) : JSONTreeIterator(root, order, maxDepth, true) { }
+
+        bool AtEnd() const { return node == nullptr; }
+
+        JSONNode* operator*() const { return node; }
+
+        // Depth of the current node, where the root is at 0.
+        unsigned int Depth() const { return (unsigned int)stack.size(); }
+
+        // Identifier of the current node, if it is a member of an object, or nullptr.
+        const std::string* Key() const;
+
+        // Index of the current node in its list, or of its slot in its object.
+        size_t Index() const { return index; }
+
+        // Whether the current node is a container visited after its children.
+        bool IsExit() const { return exit; }
+
+        // Leave out the children of the container visited before them.
+        void SkipChildren() { skip = true; }
+
+        JSONTreeIterator& operator++();
+    };
+
+
     // Special node type to handle nullable values
     class JSONNull : public JSONNode
     {
@@ -342,19 +906,38 @@ public:
 
 
     // JSON literal - leaf of the tree.
+    // Most literals of a file are never read, so the parser leaves strings and numbers
+    // to be decoded on first access, from their text in the source.
     template <typename T>
     class JSONLiteral : public JSONNode
     {
     private:
-        T value;
+        mutable T value;
+
+        // Text of a value not decoded yet. It is not used once the value is decoded.
+        const char* text = nullptr;
+        uint32_t textSize = 0;
+        mutable std::once_flag decoded;
 
     public:
         JSONLiteral(T literalValue, JSON_NODE_TYPE literalType, JSONNode* parent) :
-            value(literalValue), JSONNode(literalType, parent) 
+            JSONNode(literalType, parent), value(literalValue)
+        {
+        }
+
+        // Value decoded from the text on first access. The text must stay valid until
+        // then, see DecodeLiterals(..).
+        JSONLiteral(JSON_NODE_TYPE literalType, std::string_view literalText, JSONNode* parent) :
+            JSONNode(literalType, parent), value(), text(literalText.data()), textSize((uint32_t)literalText.size())
         {
         }
 
-        T GetValue() { return value; }
+        // Safe to call from several threads, like the rest of reading the tree.
+        const T& GetValue() const
+        {
+            if (text) std::call_once(decoded, [this]() { decode_literal(std::string_view(text, textSize), value); });
+            return value;
+        }
         JSON_NODE_TYPE GetType() { return type; }
 
         ~JSONLiteral()
@@ -367,37 +950,226 @@ private:
     JSONObject* globalSpace = nullptr;
     JSONSource* jsonSource = nullptr;
 
-public:
+    // Provides contents of lazily expanded containers, if the tree was not parsed.
+    std::unique_ptr<JSONNodeLoader> loader;
+
+    // Build the tree, from the file or its sidecars.
+    void Load(const std::string& filename, const JSONLoadOptions& options);
 
-    ~JSON()
+    // Paths the tree was built along, which it is built along again on changes of the file
+    std::shared_ptr<const JSONProjection> projection;
+
+    // Index of the paths, built on demand if enabled, and dropped when the tree changes.
+    // The mutex is only taken to build it, and readers find it published afterwards.
+    std::atomic<bool> pathIndexEnabled = false;
+    std::unique_ptr<JSONPathIndex> pathIndex;
+    std::atomic<JSONPathIndex*> publishedPathIndex = nullptr;
+    std::mutex pathIndexMutex;
+
+    enum class JSON_EDIT
     {
-        if (globalSpace) delete globalSpace;
-        globalSpace = nullptr;
-    }
+        JSON_EDIT_ADD = 0,      // A member or element was added
+        JSON_EDIT_REPLACE = 1,
+        JSON_EDIT_REMOVE = 2,
+    };
+
+    // Edit of the tree, recorded so that it can be undone and made again
+    struct Edit
+    {
+        JSON_EDIT kind;
+        JSONPath path;
+        JSONNode* detached = nullptr;   // Node out of the tree, owned by the history: the one the edit took
+                                        // out, or the one it put in while the edit is undone
+        uint32_t slot = 0;              // Slot of the member, for edits of objects
+    };
+
+    // Edits in the order they were made. The first version of them are applied, and the rest are
+    // undone, kept to be made again until another edit is made.
+    std::vector<Edit> history;
+    size_t version = 0;
+
+    // Container of the member or element at the path, if it is of the right kind, expanded.
+    JSONContainer* FindEditParent(const JSONPath& path);
+
+    // Record the edit of the container, and drop what depends on the old tree.
+    void Record(const Edit& edit, JSONContainer* parent);
+
+    // Take the children changed by an edit at the step out of a built path index before it,
+    // and add them back after it, see JSONPathIndex::RemoveChildren(..).
+    void UnindexChildren(JSONContainer* parent, const JSONPathStep& step);
+    void IndexChildren(JSONContainer* parent, const JSONPathStep& step);
+
+    // Make the edit, or undo it, exchanging the node at its path with the one it keeps.
+    void Apply(Edit& edit, bool undo);
+
+public:
+
+    ~JSON();
 
     friend class JSONInterface;
     JSONInterface CreateInterface();
+
+    JSONObject* GetRoot() { return globalSpace; }
+
+    // Decode the literals of the node and its children, before the text they refer to goes away.
+    static void DecodeLiterals(JSONNode* node);
+
+    // Path of the node from the root, found by looking the node up in each of its parents.
+    static JSONPath PathOf(JSONNode* node);
+
+    // Path as it would be queried, e.g. "a.b[3].c", or "~" for the root.
+    static std::string PathToString(const JSONPath& path);
+
+    // True if one of the paths leads into the other, i.e. a change of one node affects the other.
+    static bool PathsOverlap(const JSONPath& a, const JSONPath& b);
+
+    // Node at the path. If the path does not exist, the last node on the way is returned.
+    // resolved is the number of steps taken in any case.
+    JSONNode* FindPath(const JSONPath& path, size_t& resolved);
+
+    // Whether Update(..) can be used: the tree was parsed as a whole, not read through a loader,
+    // and is not edited.
+    bool CanUpdate() const { return jsonSource && !loader && history.empty(); }
+
+    // Read the file again and reparse the smallest container enclosing all the changes,
+    // keeping the rest of the tree. Returns false if the file did not change, otherwise changed
+    // is the path of the replaced container. Syntax errors throw JSONLoadError, and the tree is left as it was.
+    bool Update(JSONPath& changed);
+
+    // Enable or disable the path index. Disabling also frees it.
+    void EnablePathIndex(bool enable);
+    bool IsPathIndexEnabled() const { return pathIndexEnabled.load(std::memory_order_relaxed); }
+
+    // Path index, built first if it is not yet. nullptr if the index is disabled.
+    JSONPathIndex* GetPathIndex();
+
+    // Contents of the file that the spans of the nodes refer to, or empty if they are not kept,
+    // e.g. for a tree read from a snapshot, whose nodes have no spans.
+    std::string_view GetSourceBytes() const;
+
+    // Publish the whole tree in a shared-memory segment under the name, for other processes
+    // to attach to with JSONLoadOptions::attachShared. Returns false if it cannot be created.
+    bool Publish(const std::string& name);
+
+    // Edits change one member or element each. The nodes they take out of the tree are kept in the
+    // history, so that the tree can be reverted to any earlier version, and an edit costs no more
+    // than finding its path. Edits and reverts must not run concurrently with the readers.
+
+    // Parse a value on its own, e.g. "{\"a\": [1, 2]}" or "3.5", into a node without a parent.
+    // Syntax errors throw JSONLoadError.
+    static JSONNode* ParseValue(const std::string& text);
+
+    // Put the node at the path, in place of the member or element there, or as a new member.
+    // An index equal to the size of the list appends the node. The tree takes the node in any case,
+    // and false is returned if the parent of the path is not a container of the right kind.
+    bool Set(const JSONPath& path, JSONNode* node);
+
+    // Same, except that the elements from the index on are shifted, and members are never replaced.
+    bool Insert(const JSONPath& path, JSONNode* node);
+
+    // Take out the member or element at the path, shifting the elements after it.
+    bool Remove(const JSONPath& path);
+
+    // Number of edits applied to the tree as loaded. Each edit makes a new version.
+    size_t GetVersion() const { return version; }
+
+    // Latest version, which is above the current one while edits are undone.
+    size_t GetLatestVersion() const { return history.size(); }
+
+    // Undo or make again the edits between the current version and the given one, up to the latest.
+    // Undone edits are kept, so that any version can be gone to again, until another edit is made.
+    void GoTo(size_t version);
+
+    // Undo the edits made after the version, and forget them, e.g. those of a failed patch.
+    void Revert(size_t version);
+
+    // Paths changed between the version and the current one, in the order of the edits.
+    std::vector<JSONPath> ChangesSince(size_t version) const;
+};
+
+// Interface for the sources of lazily expanded containers.
+// Expand(..) is called at most once per container, and must fill it with Insert(..),
+// Append(..) or SetElement(..) depending on the container type.
+class JSONNodeLoader
+{
+public:
+    virtual void Expand(JSON::JSONContainer* container, uint64_t ref) = 0;
+
+    // Find a single child of a container that is not expanded yet, and add it to the container.
+    // Returns nullptr if there is no such child. Loaders that cannot do it
+    // faster than the whole expansion keep these default implementations.
+    virtual JSON::JSONNode* FindMember(JSON::JSONObject* object, uint64_t, const std::string& identifier)
+    {
+        object->Expand();
+        return object->FindLoaded(identifier);
+    }
+
+    virtual JSON::JSONNode* FindElement(JSON::JSONList* list, uint64_t, size_t index)
+    {
+        list->Expand();
+        return list->FindLoaded(index);
+    }
+
+    // Stop any work on the tree done in the background. Called before the tree is deleted.
+    virtual void Cancel() { }
+
+    // Contents of the file that the spans of the nodes refer to, if the loader keeps them.
+    virtual std::string_view GetSourceBytes() const { return {}; }
+
+    virtual ~JSONNodeLoader() { }
 };
 
+// Parser entry points, also used by loaders which parse separate parts of a file.
+
+// Resolve an object, a list or a literal.
+JSON::JSONNode* resolve_json(JSONString body, JSON::JSONNode* parent);
+
+// Set the span of the node to the body, in offsets of the file.
+void set_span(JSON::JSONNode* node, JSONString body);
+
+// Creates the node of a value from its body, resolve_json(..) by default.
+using ValueResolver = std::function<JSON::JSONNode*(JSONString body, JSON::JSONNode* parent)>;
+
+// Resolve comma-separated "id": value pairs, and insert them into the object.
+void resolve_members(JSONString body, JSON::JSONObject* object, const ValueResolver& resolve = resolve_json);
+
+// Resolve comma-separated values, whose parent is given, and append them to elements.
+void resolve_elements(JSONString body, JSON::JSONNode* parent, std::vector<JSON::JSONNode*>& elements,
+    const ValueResolver& resolve = resolve_json);
+
 std::string getLiteralValue(JSON::JSONNode* node);
 
+// Stream for the messages and results of the queries evaluated on the calling thread,
+// std::cout unless redirected. Queries evaluated in parallel are redirected to streams of their own.
+std::ostream& QueryOutput();
+void RedirectQueryOutput(std::ostream* output);
+
 struct Either;
 class CommandInterface;
 
-// Class used to traverse JSON syntax tree
+// Class used to traverse JSON syntax tree. The interface is a cursor, cheap to copy:
+// every thread evaluating queries uses a copy of its own.
 class JSONInterface
 {
      JSON::JSONObject* currentObject;
-     std::string currentObjectName = "~";
 
-     friend void ProcessInput(std::string, JSONInterface&, CommandInterface&);
+     // Tree of the object, to look paths up in its index
+     JSON* json = nullptr;
+
+     // If set, queries add the nodes they read here
+     std::vector<JSON::JSONNode*>* accessed = nullptr;
+
+     friend void ProcessQuery(std::string, JSONInterface&);
      friend bool ProcessFunctions(std::string src, JSONInterface& jsonInterface, Either& output);
      friend class Expr;
+     friend bool MatchPattern(const std::string& query, JSONInterface& jsonInterface,
+         const std::function<void(size_t part, JSON::JSONNode* node)>& visit);
      JSON::JSONNode* tree_walk(std::string request);
+     JSON::JSONNode* tree_walk(std::string request, JSON::JSONNode*& current);
 
 public:
 
-    JSONInterface(JSON::JSONObject* object) : currentObject(object) 
+    JSONInterface(JSON::JSONObject* object, JSON* json = nullptr) : currentObject(object), json(json)
     {
     }
 
@@ -411,6 +1183,26 @@ public:
 
     void Back(unsigned int steps);
 
+    // Path of the selected object.
+    JSONPath GetPath() const { return JSON::PathOf(currentObject); }
+
+    // Select the object at the path, e.g. after the tree was updated. If the path no longer exists,
+    // the deepest object on the way is selected, and false is returned.
+    bool Rebind(JSON& json, const JSONPath& path);
+
+    // Value of a query used as a list index, e.g. "a.n" in "b[a.n]". Prints the reason and
+    // returns false if it is not an integer.
+    bool EvaluateIndex(const std::string& query, size_t& index);
+
+    // Path from the root of the member or element the query refers to, which does not have to exist.
+    // Only indices given by nested queries are looked up. Prints the reason and returns false if the
+    // query is not a path.
+    bool ResolvePath(std::string query, JSONPath& path);
+
+    // Record the nodes read by queries: the node found or, if it was not found, the last node reached.
+    // Used to find out whether the result of a query depends on a changed part of the tree.
+    void RecordAccess(std::vector<JSON::JSONNode*>* nodes) { accessed = nodes; }
+
     // WARNING: trying to get a literal of another type will
     // give unpredictable result.
     // Always check the type beforehand.
@@ -0,0 +1,30 @@
+/*****************************************************************//**
+ * \file   json_patch.h
+ * \brief  JSON Patch (RFC 6902) documents applied to a loaded tree
+ *         as edits, all or none of them.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+
+#include <string>
+
+// A patch is a list of operations such as {"op": "add", "path": "/a/b/0", "value": 1}, with
+// the operations add, remove, replace, move, copy and test. Paths are JSON Pointers (RFC 6901),
+// where "-" stands for the end of a list. Operations are applied as edits of the tree (see JSON::Set),
+// so a patch costs as much as finding its paths, and can be undone like any other edit.
+namespace jsonpatch
+{
+    // Path of the node the pointer refers to. Only the parent has to exist: the last step is an
+    // index if the parent is a list, and "-" is its size. Returns false with the reason otherwise.
+    bool ResolvePointer(JSON& json, const std::string& pointer, JSONPath& path, std::string& error);
+
+    // Apply the operations of the patch in order. If one of them fails, including a failed test,
+    // the tree is reverted to the version before the patch, and false is returned with the reason.
+    // Syntax errors of the patch throw JSONLoadError, before anything is applied.
+    bool Apply(JSON& json, const std::string& patch, std::string& error);
+}
@@ -0,0 +1,51 @@
+/*****************************************************************//**
+ * \file   json_string.h
+ * \brief  Scanning of string literals: escape sequences, UTF-8,
+ *         and the search for the characters that end a run of text.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// Result of decoding a "\uXXXX" escape sequence
+enum class JSON_UNICODE_ESCAPE
+{
+    JSON_UNICODE_ESCAPE_VALID = 0,
+    JSON_UNICODE_ESCAPE_INVALID = 1,    // Not four hexadecimal digits, nothing is read
+    JSON_UNICODE_ESCAPE_UNPAIRED = 2,   // Surrogate without its pair, read as U+FFFD
+};
+
+// Where SSE2 is available, the searches go over 16 bytes at a time.
+namespace jsonstring
+{
+    // Position of the first '"' or '\\' at or after pos, or the size of the text.
+    size_t FindQuoteOrEscape(std::string_view text, size_t pos);
+
+    // Whether [pos, end) has an odd number of quotes that are not escaped, where the character at pos is
+    // not escaped itself. A '\\' just before end escapes the character at end.
+    bool OddQuotes(std::string_view text, size_t pos, size_t end);
+
+    // Length of the UTF-8 sequence at pos, or 0 if it is not valid: overlong, a surrogate,
+    // past U+10FFFF, or cut short.
+    size_t SequenceLength(std::string_view text, size_t pos);
+
+    // Position of the first byte that does not start a valid UTF-8 sequence, or std::string::npos.
+    size_t FindInvalidUtf8(std::string_view text);
+
+    // Same among the sequences starting in [pos, end), where pos must start a sequence.
+    // The last of them may go past end.
+    size_t FindInvalidUtf8(std::string_view text, size_t pos, size_t end);
+
+    // Append the code point to out in UTF-8.
+    void AppendUtf8(std::string& out, uint32_t codePoint);
+
+    // Decode the escape sequence whose 'u' is at pos, along with the low surrogate that follows a high one,
+    // and append it to out. Unless it is invalid, pos is moved to its last hexadecimal digit.
+    JSON_UNICODE_ESCAPE DecodeUnicodeEscape(std::string_view text, size_t& pos, std::string& out);
+}
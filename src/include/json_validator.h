@@ -0,0 +1,54 @@
+/*****************************************************************//**
+ * \file   json_validator.h
+ * \brief  Checking that a file would load, in one pass over its bytes,
+ *         without building a tree.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "parse_policy.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct JSONValidationMessage
+{
+    size_t line = 0;
+    size_t col = 0;             // In bytes, starting from 1
+    bool warning = false;
+    std::string text;
+};
+
+struct JSONValidationReport
+{
+    std::vector<JSONValidationMessage> messages;    // In the order of the file, up to the limit
+    size_t errors = 0;          // All of them, including the ones past the limit
+    size_t warnings = 0;
+    size_t bytes = 0;
+    size_t values = 0;          // Objects, lists and literals
+    size_t maxDepth = 0;
+    bool readable = true;       // Unset if the file cannot be read
+
+    bool IsValid() const { return readable && errors == 0; }
+};
+
+// The validator checks the same rules as the parser under the same policy: the root must be
+// an object, identifiers must be unique and not empty, and so on. It goes over the text once,
+// keeping only the containers it is in, and after an error it skips to the next ',' or closing
+// bracket of the same container, so that the rest of the file is checked as well.
+namespace jsonvalidator
+{
+    static constexpr size_t MaxMessages = 100;
+
+    JSONValidationReport Validate(std::string_view text,
+        JSON_PARSE_POLICY policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT, size_t maxMessages = MaxMessages);
+
+    // Same for a file, which is memory-mapped rather than read. The standard input ("-"), pipes and
+    // compressed files are read whole, decompressing them.
+    JSONValidationReport ValidateFile(const std::string& filename,
+        JSON_PARSE_POLICY policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT, size_t maxMessages = MaxMessages);
+}
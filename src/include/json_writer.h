@@ -0,0 +1,43 @@
+/*****************************************************************//**
+ * \file   json_writer.h
+ * \brief  Writing a tree back out as JSON, copying the values that
+ *         were not edited from the file as they were read.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+
+#include <string>
+#include <string_view>
+#include <ostream>
+
+struct JSONWriteStats
+{
+    size_t bytes = 0;
+    size_t copiedBytes = 0;         // Copied from the source as they were read
+    size_t copiedNodes = 0;         // Values copied as a whole
+    size_t encodedNodes = 0;        // Values written from the tree
+};
+
+// Nodes keep their span in the file they were read from, and containers are marked dirty by edits
+// (see JSON::Set). Values that have a span and are not dirty are copied from the file byte for byte,
+// so writing a large document after a small edit costs little more than copying the file. Edited
+// containers are written from the tree, keeping the whitespace of the file around the members and
+// elements that remain, so that the output differs from the file only where the tree does.
+// Values created by edits are written compactly.
+namespace jsonwriter
+{
+    // Write the node, whose spans refer to the source. With an empty source, everything is written from the tree.
+    void Write(JSON::JSONNode* node, std::string_view source, std::ostream& out, JSONWriteStats* stats = nullptr);
+
+    // Write the whole tree, along with the whitespace of the file around the root object.
+    void Write(JSON& json, std::ostream& out, JSONWriteStats* stats = nullptr);
+
+    // Write the whole tree to the file, which is replaced atomically. It may be the file the tree
+    // was read from. Returns false if the file cannot be written.
+    bool Save(JSON& json, const std::string& filename, JSONWriteStats* stats = nullptr);
+}
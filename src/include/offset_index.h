@@ -0,0 +1,76 @@
+/*****************************************************************//**
+ * \file   offset_index.h
+ * \brief  Structural offset index of a JSON file, stored next to it
+ *         and used to read only the needed parts of a large file.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+#include "snapshot.h"
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// Offset index of a JSON file is a sidecar "<filename>.idx". For every object or list
+// of at least the threshold size, it records the span of the container in the file and
+// the spans of its children. It is much smaller than a snapshot, and lets the tree be
+// built only along the visited paths, each value being read from the file on its own.
+namespace offsetindex
+{
+    constexpr char Magic[8] = { 'J', 'S', 'O', 'N', 'I', 'N', 'D', 'X' };
+    constexpr uint32_t Version = 1;
+
+    // Containers smaller than that many bytes in the file are not indexed, unless specified otherwise.
+    constexpr uint64_t DefaultThreshold = 64 * 1024;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        snapshot::SourceKey key;    // Index is only used for the file it was written for
+        uint64_t threshold;
+        uint64_t entryCount;
+        uint64_t entriesOffset;     // entryCount x Entry
+        uint64_t imageSize;
+    };
+
+    // Indexed container. Entries are sorted by their beginning, so the root
+    // object, which is always indexed, is the first one.
+    struct Entry
+    {
+        uint64_t begin;             // Span of the container in the file, [begin, end)
+        uint64_t end;
+        int32_t type;               // JSON::JSON_NODE_TYPE, OBJECT or LIST
+        uint32_t reserved;
+        uint64_t childCount;
+        uint64_t childrenOffset;    // childCount x Child, in the order of the file
+        uint64_t keyOrderOffset;    // OBJECT: childCount x uint64_t, numbers of children sorted by key
+    };
+
+    // Child of an indexed container. For object members, memberBegin is the position of
+    // the key, and keyOffset refers to the key in the index: uint64_t length and the bytes.
+    // For list elements, memberBegin is the same as begin.
+    struct Child
+    {
+        uint64_t keyOffset;
+        uint64_t memberBegin;
+        uint64_t begin;             // Span of the value in the file, [begin, end)
+        uint64_t end;
+    };
+
+    // Path of the index for the given JSON file.
+    std::string SidecarPath(const std::string& filename);
+
+    // Build the index from the trimmed source and write it, replacing an older one atomically.
+    bool Write(JSONSource& source, const std::string& filename, uint64_t threshold = DefaultThreshold);
+
+    // If there is a valid index for the file, return the root object, which is built
+    // on demand by the returned loader. Otherwise returns nullptr.
+    JSON::JSONObject* Open(const std::string& filename, std::unique_ptr<JSONNodeLoader>& loader);
+}
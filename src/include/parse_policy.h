@@ -0,0 +1,123 @@
+/*****************************************************************//**
+ * \file   parse_policy.h
+ * \brief  Rules the parser follows for a document, fixed at compile
+ *         time for each of the loops that go over every character.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+// Policy of a document, chosen when it is loaded (see JSONLoadOptions::policy).
+enum class JSON_PARSE_POLICY
+{
+    JSON_PARSE_POLICY_DEFAULT = 0,      // Rules the parser always had
+    JSON_PARSE_POLICY_STRICT = 1,       // RFC 8259, for validating files
+    JSON_PARSE_POLICY_LENIENT = 2,      // Accepts what it can, for exploring files
+};
+
+// What to do with an escape sequence the parser does not know, such as "\q"
+enum class JSON_UNKNOWN_ESCAPE
+{
+    JSON_UNKNOWN_ESCAPE_WARN = 0,       // Warn, and drop it
+    JSON_UNKNOWN_ESCAPE_ERROR = 1,
+    JSON_UNKNOWN_ESCAPE_KEEP = 2,       // Keep the escaped character
+};
+
+// What to do with bytes that are not valid UTF-8
+enum class JSON_INVALID_UTF8
+{
+    JSON_INVALID_UTF8_WARN = 0,         // Warn about the first of them, and keep them
+    JSON_INVALID_UTF8_ERROR = 1,
+    JSON_INVALID_UTF8_KEEP = 2,         // Keep them, without checking the text
+};
+
+// Containers may be nested this deep, counting the root object, under every policy. Deeper ones are an
+// error, as the parser and the writers go down the tree by recursion.
+constexpr size_t MaxNestingDepth = 1024;
+
+// The trimming loop and the string scanner are templates on these, so each policy gets loops
+// without the checks of the others. Per-value rules are looked up once per value.
+struct DefaultPolicy
+{
+    static constexpr JSON_PARSE_POLICY policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT;
+
+    // Tabs and newlines are dropped inside strings as well, and '\r' is kept everywhere
+    static constexpr bool trimsStrings = true;
+
+    // Raw control characters in strings are an error
+    static constexpr bool rejectsControlCharacters = false;
+
+    // Escape sequences of RFC 8259, including "\uXXXX", are read under every policy. This is for the
+    // others, and for surrogates without their pair, which are read as U+FFFD.
+    static constexpr JSON_UNKNOWN_ESCAPE unknownEscapes = JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_WARN;
+
+    static constexpr JSON_INVALID_UTF8 invalidUtf8 = JSON_INVALID_UTF8::JSON_INVALID_UTF8_WARN;
+
+    // A repeated key replaces the earlier member, instead of being an error
+    static constexpr bool keepsLastDuplicate = false;
+
+    // Numbers follow the grammar of RFC 8259: no '+' sign, no leading zeros
+    static constexpr bool strictNumbers = false;
+
+    // Whitespace inside a literal, such as "nu ll", is an error rather than dropped by trimming
+    static constexpr bool rejectsSplitLiterals = false;
+};
+
+struct StrictPolicy
+{
+    static constexpr JSON_PARSE_POLICY policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT;
+    static constexpr bool trimsStrings = false;
+    static constexpr bool rejectsControlCharacters = true;
+    static constexpr JSON_UNKNOWN_ESCAPE unknownEscapes = JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_ERROR;
+    static constexpr JSON_INVALID_UTF8 invalidUtf8 = JSON_INVALID_UTF8::JSON_INVALID_UTF8_ERROR;
+    static constexpr bool keepsLastDuplicate = false;
+    static constexpr bool strictNumbers = true;
+    static constexpr bool rejectsSplitLiterals = true;
+};
+
+struct LenientPolicy
+{
+    static constexpr JSON_PARSE_POLICY policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_LENIENT;
+    static constexpr bool trimsStrings = true;
+    static constexpr bool rejectsControlCharacters = false;
+    static constexpr JSON_UNKNOWN_ESCAPE unknownEscapes = JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_KEEP;
+    static constexpr JSON_INVALID_UTF8 invalidUtf8 = JSON_INVALID_UTF8::JSON_INVALID_UTF8_KEEP;
+    static constexpr bool keepsLastDuplicate = true;
+    static constexpr bool strictNumbers = false;
+    static constexpr bool rejectsSplitLiterals = false;
+};
+
+// Call f with the policy type of the value, e.g. WithPolicy(policy, [](auto tag) { Run<decltype(tag)>(); }).
+template <class F>
+decltype(auto) WithPolicy(JSON_PARSE_POLICY policy, F&& f)
+{
+    switch (policy)
+    {
+    case JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT:
+        return f(StrictPolicy());
+    case JSON_PARSE_POLICY::JSON_PARSE_POLICY_LENIENT:
+        return f(LenientPolicy());
+    default:
+        return f(DefaultPolicy());
+    }
+}
+
+// Rules of a policy chosen at run time, for checks done once per value rather than per character.
+inline bool KeepsLastDuplicate(JSON_PARSE_POLICY policy)
+{
+    return WithPolicy(policy, [](auto tag) { return decltype(tag)::keepsLastDuplicate; });
+}
+
+inline bool HasStrictNumbers(JSON_PARSE_POLICY policy)
+{
+    return WithPolicy(policy, [](auto tag) { return decltype(tag)::strictNumbers; });
+}
+
+inline JSON_INVALID_UTF8 InvalidUtf8(JSON_PARSE_POLICY policy)
+{
+    return WithPolicy(policy, [](auto tag) { return decltype(tag)::invalidUtf8; });
+}
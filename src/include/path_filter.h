@@ -0,0 +1,109 @@
+/*****************************************************************//**
+ * \file   path_filter.h
+ * \brief  Predicates of filter steps, e.g. [?(@.price > 10)],
+ *         evaluated over batches of nodes.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+enum class FILTER_VALUE
+{
+    FILTER_VALUE_MISSING = 0,   // The node has no such field
+    FILTER_VALUE_NULL = 1,
+    FILTER_VALUE_BOOL = 2,
+    FILTER_VALUE_NUMBER = 3,
+    FILTER_VALUE_STRING = 4,
+    FILTER_VALUE_CONTAINER = 5,
+};
+
+// Value of a field, or a constant of the predicate. Strings are not copied.
+struct FilterValue
+{
+    FILTER_VALUE type = FILTER_VALUE::FILTER_VALUE_MISSING;
+    double number = 0;                      // Also 0 or 1 for booleans
+    const std::string* string = nullptr;
+};
+
+// Predicate such as "@.status == \"active\" && (@.price > 10 || !@.sold)", where "@" is the child
+// of the filtered list or object. Comparisons of missing fields, and ordering of values of different
+// types, are false. A field on its own is true if the child has it.
+//
+// The predicate is compiled into a program over columns: every field it reads is extracted
+// for a whole batch of children first, and then every operation runs over the whole batch.
+class JSONFilter
+{
+public:
+    static constexpr size_t BatchSize = 1024;
+
+    JSONFilter() = default;
+
+    // Constants refer to the strings of the filter
+    JSONFilter& operator=(const JSONFilter& rhs) = delete;
+    JSONFilter(const JSONFilter& other) = delete;
+
+    // Returns false, printing the reason, if the predicate is invalid.
+    bool Parse(const std::string& predicate);
+
+    // Position of the ')' closing the '(' at the position, skipping string literals,
+    // or std::string::npos if there is none.
+    static size_t FindEnd(const std::string& source, size_t open);
+
+    // Set matches[i] to 1 for each of the nodes that satisfies the predicate, otherwise to 0.
+    // At most BatchSize nodes are evaluated at once.
+    void Evaluate(JSON::JSONNode* const* nodes, size_t count, std::vector<uint8_t>& matches) const;
+
+    // Value of the field of the node. Member lookups go through the caches, one per step, if given.
+    static FilterValue Extract(JSON::JSONNode* node, const JSONPath& field, JSON::JSONMemberCache* caches = nullptr);
+
+private:
+    enum class FILTER_OP
+    {
+        FILTER_OP_EXISTS = 0,
+        FILTER_OP_EQUAL = 1,
+        FILTER_OP_NOT_EQUAL = 2,
+        FILTER_OP_LESS = 3,
+        FILTER_OP_LESS_EQUAL = 4,
+        FILTER_OP_GREATER = 5,
+        FILTER_OP_GREATER_EQUAL = 6,
+        FILTER_OP_AND = 7,
+        FILTER_OP_OR = 8,
+        FILTER_OP_NOT = 9,
+    };
+
+    struct Operand
+    {
+        bool isField = false;
+        size_t field = 0;       // Index of the column
+        FilterValue constant;
+    };
+
+    // Operations of the program pop their arguments from a stack of masks, and push the result
+    struct Instruction
+    {
+        FILTER_OP op;
+        Operand lhs;
+        Operand rhs;
+    };
+
+    std::vector<JSONPath> fields;
+    mutable std::vector<std::vector<JSON::JSONMemberCache>> caches;    // Of the steps of each field
+    std::deque<std::string> strings;    // Constants, which keep their addresses
+    std::vector<Instruction> program;
+
+    // Recursive descent over the predicate, emitting the program in postfix order.
+    bool ParseOr(const std::string& source, size_t& pos);
+    bool ParseAnd(const std::string& source, size_t& pos);
+    bool ParseUnary(const std::string& source, size_t& pos);
+    bool ParseComparison(const std::string& source, size_t& pos);
+    bool ParseOperand(const std::string& source, size_t& pos, Operand& operand);
+};
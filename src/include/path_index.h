@@ -0,0 +1,92 @@
+/*****************************************************************//**
+ * \file   path_index.h
+ * \brief  Document-wide index of the nodes by the hashes of their
+ *         paths, for lookups that do not walk the tree.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+#include "utilstr.h"
+
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+// Hashes of a path: the index is looked up by the first one, and a node found is only taken
+// if the second one, of an unrelated function, is equal as well.
+struct JSONPathHash
+{
+    uint64_t hash = utilstr::HashOffsetBasis;
+    uint64_t check = utilstr::CheckOffsetBasis;
+
+    void Continue(const char* data, size_t size)
+    {
+        hash = utilstr::Hash(data, size, hash);
+        check = utilstr::CheckHash(data, size, check);
+    }
+};
+
+// Nodes are indexed by the hash of their canonical path from the root, which is the path
+// as it would be queried, with a dot before every identifier: ".a.b[3].c". The hash of
+// a path continues the hash of its prefix, so paths relative to a selected object are
+// hashed from the hash of that object. Members whose identifiers contain '.' or '[' cannot
+// be queried by the same path, so they and their descendants are left to the usual lookup.
+class JSONPathIndex
+{
+    struct Entry
+    {
+        JSON::JSONNode* node;   // nullptr if several nodes have the hash
+        uint64_t check;
+    };
+    std::unordered_map<uint64_t, Entry> nodes;
+    std::unordered_map<const JSON::JSONNode*, JSONPathHash> containerHashes;
+
+    // Index the node and its descendants, or take them out of the index.
+    void Add(JSON::JSONNode* node, const JSONPathHash& path);
+    void Remove(JSON::JSONNode* node, const JSONPathHash& path);
+
+    // Apply one of the above to the children of the container from the step on, see RemoveChildren(..).
+    template <class Visit>
+    void ForChildren(JSON::JSONContainer* container, const JSONPathStep& step, const Visit& visit);
+
+public:
+    // Index every node of the tree, expanding all of its containers.
+    JSONPathIndex(JSON::JSONObject* root);
+
+    static JSONPathHash HashMember(JSONPathHash parent, const char* identifier, size_t size)
+    {
+        parent.Continue(".", 1);
+        parent.Continue(identifier, size);
+        return parent;
+    }
+
+    static JSONPathHash HashElement(JSONPathHash parent, size_t index)
+    {
+        std::string step = "[" + std::to_string(index) + "]";
+        parent.Continue(step.data(), step.size());
+        return parent;
+    }
+
+    // Continue the hash with a query of identifiers and numeric indices, e.g. "a.b[3].c".
+    // Returns false for other queries, e.g. with indices given by nested queries.
+    static bool HashQuery(const std::string& query, JSONPathHash& path);
+
+    // Hash of the path of an object or a list.
+    bool HashOf(const JSON::JSONNode* container, JSONPathHash& path) const;
+
+    // Node with the path hash. Returns false if there is no such node, several of them,
+    // or if the second hash of the node is not that of the path.
+    bool Find(const JSONPathHash& path, JSON::JSONNode*& node) const;
+
+    // Edits of a container keep the index up to date by taking its children out before the edit, and
+    // adding them after it: the member of the step, or the elements from the index of the step on,
+    // whose indices are shifted by the edit. The rest of the index is kept.
+    void RemoveChildren(JSON::JSONContainer* container, const JSONPathStep& step);
+    void AddChildren(JSON::JSONContainer* container, const JSONPathStep& step);
+
+    size_t Size() const { return nodes.size(); }
+};
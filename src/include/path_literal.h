@@ -0,0 +1,223 @@
+/*****************************************************************//**
+ * \file   path_literal.h
+ * \brief  Paths fixed in the code, checked and split into steps
+ *         at compile time, for accessors that only follow pointers.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <utility>
+#include <cstdint>
+
+// Path of identifiers and indices written in the code, e.g. "server.ports[2]":
+//
+//     if (auto* port = JSON_PATH("server.ports[2]").As<JSON::JSONLiteral<int>>(json)) ...
+//     std::string host;
+//     if (JSON_PATH("server.host").Get(json, host)) ...
+//
+// The path is checked while compiling, and an invalid one does not compile. Each use of the macro
+// has its own type, which keeps the steps, their keys and their member caches: an object with the
+// shape seen last at its step is a slot lookup, without hashing the key.
+#define JSON_PATH(text) \
+    ([]() \
+    { \
+        struct Text { static constexpr std::string_view Get() { return text; } }; \
+        return JSONPathLiteral<Text>(); \
+    }())
+
+namespace pathliteral
+{
+    struct Step
+    {
+        bool isIndex = false;
+        std::string_view identifier;
+        size_t index = 0;
+    };
+
+    // Identifiers are separated by '.', and indices are written as in queries, without leading zeros.
+    // The empty path is the node it starts from.
+    constexpr bool IsValid(std::string_view text)
+    {
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            if (text[pos] == '[')
+            {
+                size_t close = text.find(']', pos);
+                if (close == std::string_view::npos || close == pos + 1) return false;
+                if (text[pos + 1] == '0' && close > pos + 2) return false;
+                for (size_t i = pos + 1; i < close; i++)
+                {
+                    if (text[i] < '0' || text[i] > '9') return false;
+                }
+                pos = close + 1;
+                continue;
+            }
+
+            if (text[pos] == '.')
+            {
+                if (pos == 0) return false;
+                pos++;
+            }
+
+            size_t end = text.find_first_of(".[]", pos);
+            if (end == std::string_view::npos) end = text.size();
+            if (end == pos || (end < text.size() && text[end] == ']')) return false;
+            pos = end;
+        }
+        return true;
+    }
+
+    constexpr size_t CountSteps(std::string_view text)
+    {
+        // An identifier at the start, one after each '.', and the indices
+        size_t count = !text.empty() && text[0] != '[' ? 1 : 0;
+        for (char c : text)
+        {
+            if (c == '.' || c == '[') count++;
+        }
+        return count;
+    }
+
+    // Steps of a valid path.
+    template <size_t N>
+    constexpr std::array<Step, N> Split(std::string_view text)
+    {
+        std::array<Step, N> steps{};
+        size_t pos = 0;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (text[pos] == '[')
+            {
+                steps[i].isIndex = true;
+                for (pos++; text[pos] != ']'; pos++) steps[i].index = steps[i].index * 10 + (size_t)(text[pos] - '0');
+                pos++;
+                continue;
+            }
+
+            if (text[pos] == '.') pos++;
+            size_t end = text.find_first_of(".[", pos);
+            if (end == std::string_view::npos) end = text.size();
+            steps[i].identifier = text.substr(pos, end - pos);
+            pos = end;
+        }
+        return steps;
+    }
+
+    // Type of the nodes of a class, which the node found is checked against.
+    template <class Node>
+    struct NodeTypeOf
+    {
+        static_assert(sizeof(Node) == 0, "Nodes are JSONObject, JSONList, JSONNull or JSONLiteral of int, double, bool or std::string.");
+    };
+
+    template <> struct NodeTypeOf<JSON::JSONObject> { static constexpr auto value = JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT; };
+    template <> struct NodeTypeOf<JSON::JSONList> { static constexpr auto value = JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST; };
+    template <> struct NodeTypeOf<JSON::JSONNull> { static constexpr auto value = JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_NULL; };
+    template <> struct NodeTypeOf<JSON::JSONLiteral<int>> { static constexpr auto value = JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT; };
+    template <> struct NodeTypeOf<JSON::JSONLiteral<double>> { static constexpr auto value = JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_DOUBLE; };
+    template <> struct NodeTypeOf<JSON::JSONLiteral<bool>> { static constexpr auto value = JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_BOOL; };
+    template <> struct NodeTypeOf<JSON::JSONLiteral<std::string>> { static constexpr auto value = JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING; };
+}
+
+// Path given by JSON_PATH(..), whose Text provides it as a constant.
+template <class Text>
+class JSONPathLiteral
+{
+    static constexpr bool valid = pathliteral::IsValid(Text::Get());
+    static_assert(valid, "Paths are identifiers separated by '.' and indices such as [3].");
+
+    // An invalid path is taken as empty, so that the assertion is the only error
+    static constexpr std::string_view text = valid ? Text::Get() : std::string_view();
+
+    static constexpr size_t size = pathliteral::CountSteps(text);
+    static constexpr std::array<pathliteral::Step, size> steps = pathliteral::Split<size>(text);
+
+    // Keys of member steps, and the slots they were last found at
+    struct Lookup
+    {
+        std::string identifier;
+        JSON::JSONMemberCache cache;
+    };
+
+    template <size_t... I>
+    static std::array<Lookup, size>& Lookups(std::index_sequence<I...>)
+    {
+        static std::array<Lookup, size> lookups = { Lookup{ std::string(steps[I].identifier), JSON::JSONMemberCache() }... };
+        return lookups;
+    }
+
+    // Take the step from node, or set it to nullptr.
+    template <size_t I>
+    static bool Hop(JSON::JSONNode*& node, std::array<Lookup, size>& lookups)
+    {
+        if constexpr (steps[I].isIndex)
+        {
+            if (node->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST) node = nullptr;
+            else node = ((JSON::JSONList*)node)->Find(steps[I].index);
+        }
+        else
+        {
+            if (node->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT) node = nullptr;
+            else
+            {
+                JSON::JSONObject* object = (JSON::JSONObject*)node;
+                node = object->IsExpanded() ? object->FindLoaded(lookups[I].identifier, lookups[I].cache)
+                    : object->Find(lookups[I].identifier);
+            }
+        }
+        return node != nullptr;
+    }
+
+    template <size_t... I>
+    static JSON::JSONNode* Walk(JSON::JSONNode* node, std::index_sequence<I...> indices)
+    {
+        // The empty path takes no steps
+        [[maybe_unused]] auto& lookups = Lookups(indices);
+        (void)(Hop<I>(node, lookups) && ...);
+        return node;
+    }
+
+public:
+    static constexpr size_t Size() { return size; }
+
+    // Node at the path from the node, or nullptr if there is none.
+    JSON::JSONNode* Find(JSON::JSONNode* from) const
+    {
+        return from ? Walk(from, std::make_index_sequence<size>()) : nullptr;
+    }
+
+    // Node at the path from the root of the document. The walk is not left to the path index, whose
+    // lookup costs more than a few steps through the member caches.
+    JSON::JSONNode* Find(JSON& json) const
+    {
+        return Find(json.GetRoot());
+    }
+
+    // Node at the path, if it is of the class, e.g. JSON::JSONLiteral<int>. Otherwise nullptr.
+    template <class Node, class From>
+    Node* As(From&& from) const
+    {
+        JSON::JSONNode* node = Find(from);
+        return node && node->GetType() == pathliteral::NodeTypeOf<Node>::value ? (Node*)node : nullptr;
+    }
+
+    // Value of the literal at the path, if it is of the type. Returns false otherwise.
+    template <class T, class From>
+    bool Get(From&& from, T& value) const
+    {
+        const JSON::JSONLiteral<T>* literal = As<JSON::JSONLiteral<T>>(from);
+        if (!literal) return false;
+
+        value = literal->GetValue();
+        return true;
+    }
+};
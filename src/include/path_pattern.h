@@ -0,0 +1,97 @@
+/*****************************************************************//**
+ * \file   path_pattern.h
+ * \brief  Queries with wildcard and recursive descent steps,
+ *         which match sets of nodes.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+#include "worker_pool.h"
+#include "path_filter.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+
+enum class PATTERN_STEP
+{
+    PATTERN_STEP_MEMBER = 0,            // .name
+    PATTERN_STEP_INDEX = 1,             // [3]
+    PATTERN_STEP_ANY = 2,               // .* or [*], every member or element
+    PATTERN_STEP_DESCENDANT = 3,        // ..name, members with the name at any depth
+    PATTERN_STEP_ANY_DESCENDANT = 4,    // ..*, every node at any depth
+    PATTERN_STEP_FILTER = 5,            // [?(@.price > 10)], members or elements satisfying the predicate
+};
+
+struct JSONPatternStep
+{
+    PATTERN_STEP type = PATTERN_STEP::PATTERN_STEP_MEMBER;
+    std::string identifier;
+    size_t index = 0;
+    std::shared_ptr<const JSONFilter> filter;
+    mutable JSON::JSONMemberCache cache;    // Of member steps, which are repeated over many objects
+};
+
+// Query such as "catalog..price" or "a.b[*].c". Matches are visited in parts: every part
+// is visited on one thread in the order of the tree, and the parts follow each other in
+// the same order, so results gathered per part can be merged, or joined in order.
+class JSONPathPattern
+{
+public:
+    // Called with the part of the match, which is less than MaxParts.
+    using Visitor = std::function<void(size_t part, JSON::JSONNode* node)>;
+
+    // Value of an index given by a nested query, e.g. "[a.b]". Returns false if there is none.
+    using IndexResolver = std::function<bool(const std::string& query, size_t& index)>;
+
+    static constexpr size_t MaxParts = 64;
+
+    // Containers with at least this many children are split between threads
+    static constexpr size_t ParallelChildren = 256;
+
+    // Whether the query has wildcard or recursive descent steps, i.e. may match several nodes.
+    static bool IsPattern(const std::string& query);
+
+    // Whether the '*' at the position is a wildcard rather than a multiplication.
+    static bool IsWildcard(const std::string& source, size_t pos);
+
+    // Returns false, printing the reason, if the query is invalid.
+    bool Parse(const std::string& query, const IndexResolver& resolveIndex);
+
+    const std::vector<JSONPatternStep>& Steps() const { return steps; }
+
+    // Visit every node matched from the node. Large containers are traversed on the threads
+    // of the pool, if there is one, and the call returns once all of them are done.
+    // Returns the number of parts used.
+    size_t ForEach(JSON::JSONNode* from, const Visitor& visit, WorkerPool* pool = nullptr) const;
+
+private:
+    std::vector<JSONPatternStep> steps;
+
+    // State of one ForEach(..) call, shared with its tasks
+    struct Traversal;
+
+    // Match the steps from the step on. Only the calling thread may split containers between
+    // threads, and it visits its matches in the current part of the traversal.
+    void Visit(JSON::JSONNode* node, size_t step, size_t part, Traversal& traversal, bool split) const;
+
+    // Match the children of a container against the step. Keys are given for members.
+    void VisitChildren(JSON::JSONNode* const* children, const std::string* const* keys, size_t count,
+        size_t step, size_t part, Traversal& traversal, bool split) const;
+
+    // Match a member, whose key is given, or an element against the step.
+    void VisitChild(JSON::JSONNode* child, const std::string* key, size_t step, size_t part,
+        Traversal& traversal, bool split) const;
+};
+
+// Pool shared by the queries of the session.
+WorkerPool& QueryPool();
+
+// Visit the nodes matched by the query relative to the object selected in the interface, on the
+// query pool. Nested index queries are resolved by the interface. Returns false if the query is invalid.
+bool MatchPattern(const std::string& query, JSONInterface& jsonInterface, const JSONPathPattern::Visitor& visit);
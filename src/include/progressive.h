@@ -0,0 +1,30 @@
+/*****************************************************************//**
+ * \file   progressive.h
+ * \brief  Progressive parsing, which makes the top of the tree
+ *         available while its large parts are parsed in the background.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+
+#include <memory>
+#include <cstdint>
+
+// Progressive parsing resolves the members of the root object at once, except for the objects
+// and lists of at least the threshold size. These are only scanned for their bounds, and
+// are parsed by background threads in the order of the file, in the same way level by level.
+// A query that reaches such a container before it is parsed either waits for the thread
+// parsing it, or parses it right away, so it does not wait for the rest of the file.
+namespace progressive
+{
+    // Containers smaller than that many bytes are parsed along with their parent, unless specified otherwise.
+    constexpr uint64_t DefaultThreshold = 64 * 1024;
+
+    // Return the root object of the trimmed source, whose large containers are parsed by the
+    // returned loader. Syntax errors found later are reported on the access to the container.
+    JSON::JSONObject* Parse(JSONSource& source, uint64_t threshold, std::unique_ptr<JSONNodeLoader>& loader);
+}
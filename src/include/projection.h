@@ -0,0 +1,50 @@
+/*****************************************************************//**
+ * \file   projection.h
+ * \brief  Loading of the nodes on given paths only, such as
+ *         "meta.version" and "records[*].id", out of large files.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+
+// Paths of a projection, merged into a tree of steps from the root object.
+class JSONProjection
+{
+public:
+    struct Step
+    {
+        bool whole = false;         // A path ends here, so the whole value is kept
+        std::vector<std::pair<std::string, std::unique_ptr<Step>>> members;
+        std::vector<std::pair<size_t, std::unique_ptr<Step>>> indices;
+        std::unique_ptr<Step> any;  // .* or [*]
+    };
+
+    // Add a path in the syntax of queries, e.g. "a.b[3].c" or "records[*].id". Only member,
+    // index and wildcard steps can be projected. Returns false, printing the reason, if the path is invalid.
+    bool Add(const std::string& path);
+
+    const Step& Root() const { return root; }
+
+private:
+    Step root;
+};
+
+// Projected parsing builds the nodes on the paths of the projection, and everything under the
+// paths' ends. Other members are left out, and other elements of lists are null, so that the
+// indices stay the same; elements past the last projected index are left out as well.
+// Values that are left out are only scanned for their end, which builds no nodes and decodes
+// nothing, so within them only parentheses and closing quotes are checked.
+namespace projection
+{
+    // Return the root object of the trimmed source, built under the projection.
+    JSON::JSONObject* Parse(JSONSource& source, const JSONProjection& projection);
+}
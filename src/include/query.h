@@ -105,6 +105,12 @@ Either Div(Either a, Either b);
 
 class JSONInterface;
 bool Tokenize(std::string source, std::string& token, size_t& pos);
+
+// Whether the input is to be evaluated as an arithmetic expression rather than a single query.
+bool IsExpression(const std::string& input);
+
+// Evaluate a query or an expression relative to the selected object, and print the result to QueryOutput().
+void ProcessQuery(std::string input, JSONInterface& jsonInterface);
 bool ProcessFunctions(std::string src, JSONInterface& jsonInterface, Either& output);
 
 // a.b[a.b[1]].c
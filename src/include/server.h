@@ -0,0 +1,130 @@
+/*****************************************************************//**
+ * \file   server.h
+ * \brief  Query server keeping documents loaded and answering
+ *         queries of other processes over a Unix domain socket.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "documents.h"
+#include "batch.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Totals since the server started listening. Latency of a request is counted
+// from reading it to queueing its response.
+struct QueryServerStats
+{
+    size_t connections = 0;         // Accepted so far
+    size_t openConnections = 0;
+    size_t requests = 0;
+    size_t errors = 0;              // Responses starting with "[ERROR]"
+    size_t bytesReceived = 0;
+    size_t bytesSent = 0;
+    double seconds = 0;
+    double totalLatencyMicroseconds = 0;
+    double maxLatencyMicroseconds = 0;
+
+    // Several lines, e.g. "requests: 1000 (12 errors, 5321.4/s)".
+    std::string Describe() const;
+};
+
+// Answers queries and expressions against the documents of a registry. A request is a 32-bit
+// big-endian length followed by the query, and is answered in the same way with what the query
+// prints in the CLI. Queries go to the current document, unless they start with "@NAME ".
+// Request ":stats" is answered with the counters of the server.
+//
+// Clients may send any number of requests without waiting for the responses, which come back
+// in the order of the requests. The requests read by one pass of the event loop are evaluated
+// together on the worker threads, with the registry locked, so watched documents are updated
+// between the passes only. The server is only available on Linux.
+class QueryServer
+{
+public:
+    // Longer requests close the connection
+    static constexpr uint32_t MaxRequestSize = 1 << 20;
+
+    // Connections with this many bytes of responses not sent yet are not read until they catch up
+    static constexpr size_t MaxPendingOutput = 16 << 20;
+
+private:
+    struct Connection
+    {
+        std::string input;          // Received, but not a whole request yet
+        std::string output;         // Not sent yet
+        size_t sent = 0;            // Part of the output already sent
+        size_t waiting = 0;         // Requests of the current pass
+        bool closing = false;       // Closed by the peer or invalid
+    };
+
+    // Request waiting for the rest of its pass
+    struct Request
+    {
+        int fd;
+        std::string query;
+        std::chrono::steady_clock::time_point received;
+    };
+
+    DocumentRegistry& documents;
+    BatchQueryExecutor executor;
+
+    std::string socketPath;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;                // Written to stop the loop
+
+    std::map<int, Connection> connections;
+    std::atomic<bool> stopping = false;
+
+    mutable std::mutex statsMutex;
+    QueryServerStats stats;
+    std::chrono::steady_clock::time_point started;
+
+    void Accept();
+
+    // Read what is available, and split it into requests. Returns false if a request is too long.
+    bool Receive(int fd, Connection& connection, std::vector<Request>& requests);
+
+    // Send what the socket accepts. Returns false if the connection should be closed.
+    bool Send(int fd, Connection& connection);
+
+    // Wait for the sockets the connection can make progress on.
+    void UpdateEvents(int fd, const Connection& connection);
+
+    void CloseConnection(int fd);
+
+    // Evaluate the requests of a pass, and queue their responses.
+    void Answer(std::vector<Request>& requests);
+
+public:
+    // Zero threads means one thread per hardware thread.
+    QueryServer(DocumentRegistry& documents, size_t threadCount = 0);
+
+    // Closes the connections, and removes the socket file.
+    ~QueryServer();
+
+    QueryServer& operator=(const QueryServer& rhs) = delete;
+    QueryServer(const QueryServer& other) = delete;
+
+    // Create the socket, replacing a stale socket file. Returns false with the reason on failure.
+    bool Listen(const std::string& path, std::string& error);
+
+    // Serve the clients until Stop is called.
+    void Run();
+
+    // Make Run return. Can be called from any thread, and from signal handlers.
+    void Stop();
+
+    QueryServerStats GetStats() const;
+
+    size_t Threads() const { return executor.Threads(); }
+};
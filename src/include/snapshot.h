@@ -0,0 +1,136 @@
+/*****************************************************************//**
+ * \file   snapshot.h
+ * \brief  Binary snapshots of a parsed JSON tree, stored next to
+ *         the source file and reused when the file is opened again.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include "json_parser.h"
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// Read-only view of a whole file. The file is memory-mapped where the
+// platform allows it, otherwise it is read into memory.
+class MappedFile
+{
+    const char* data = nullptr;
+    size_t size = 0;
+    std::string buffer;     // Holds the contents only if the file is not mapped
+
+public:
+    // With sharedMemory, the name is that of a POSIX shared-memory segment, which is
+    // mapped shared with the other processes. Segments are not available on Windows.
+    MappedFile(const std::string& filename, bool sharedMemory = false);
+    ~MappedFile();
+
+    MappedFile& operator=(const MappedFile& rhs) = delete;
+    MappedFile(const MappedFile& other) = delete;
+
+    // Empty files are never considered open.
+    bool IsOpen() const { return data != nullptr; }
+
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+};
+
+// Snapshot of a JSON file is a sidecar "<filename>.snap", containing the parsed
+// tree in a position-independent layout: all links are offsets from the start
+// of the image, so it can be mapped at any address and used without decoding it first.
+//
+// The same image can be published in a POSIX shared-memory segment. Other processes attach
+// to it read-only, so the data of the tree is kept once per host, and each process only
+// creates nodes for the part of the tree it visits.
+namespace snapshot
+{
+    constexpr char Magic[8] = { 'J', 'S', 'O', 'N', 'S', 'N', 'A', 'P' };
+    constexpr uint32_t Version = 2;
+
+    // Identity of a source file. Snapshot is only used for a file with the same
+    // size, modification time and hash. For the file to be opened in constant time,
+    // only the first and the last SampleSize bytes of the file are hashed.
+    constexpr size_t SampleSize = 64 * 1024;
+
+    struct SourceKey
+    {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        uint64_t hash = 0;
+
+        bool operator==(const SourceKey& other) const
+        {
+            return size == other.size && mtime == other.mtime && hash == other.hash;
+        }
+    };
+
+    // Image starts with the header. Records that follow are 8-byte aligned.
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        SourceKey key;
+        uint64_t rootOffset;
+        uint64_t imageSize;
+    };
+
+    // Every node is a record, which may be followed by its data:
+    //  OBJECT : count x MemberEntry, in the order of the file, then count x uint64_t,
+    //           the indices of the entries sorted by key;
+    //  LIST   : count x uint64_t, offsets of the elements;
+    //  STRING : count bytes of the value.
+    // Object keys are stored as STRING records.
+    struct NodeRecord
+    {
+        int32_t type;           // JSON::JSON_NODE_TYPE
+        uint32_t reserved;
+
+        union
+        {
+            uint64_t count;     // OBJECT, LIST: number of children; STRING: length
+            int64_t intValue;   // INT, BOOL
+            double doubleValue; // DOUBLE
+        };
+    };
+
+    struct MemberEntry
+    {
+        uint64_t keyOffset;
+        uint64_t valueOffset;
+    };
+
+    // Path of the snapshot for the given JSON file.
+    std::string SidecarPath(const std::string& filename);
+
+    // Returns false if the file cannot be accessed.
+    bool GetSourceKey(const std::string& filename, SourceKey& key);
+
+    // Write the snapshot of a fully parsed tree. The file is replaced atomically,
+    // so a concurrent reader never sees a partially written snapshot.
+    bool Write(JSON::JSONObject* root, const std::string& filename);
+
+    // If there is a valid snapshot for the file, map it and return the root object,
+    // which is expanded on demand by the returned loader. Otherwise returns nullptr, also if
+    // the root lies outside of the snapshot. Other records are checked as they are read,
+    // and expanding a damaged part of the tree throws JSONLoadError.
+    JSON::JSONObject* Open(const std::string& filename, std::unique_ptr<JSONNodeLoader>& loader);
+
+    // Name of the segment, which always starts with a '/', e.g. "/catalog" for "catalog".
+    std::string SegmentName(const std::string& name);
+
+    // Publish the image of the tree in a shared-memory segment under the name, replacing
+    // the one published before. Processes attached to the old segment keep reading it.
+    bool Publish(JSON::JSONObject* root, const std::string& name);
+
+    // Remove the segment. Attached processes keep reading it until they close it.
+    bool Unpublish(const std::string& name);
+
+    // Map the segment published under the name read-only, and return the root object as Open(..) does.
+    // Returns nullptr if there is no complete image under the name.
+    JSON::JSONObject* Attach(const std::string& name, std::unique_ptr<JSONNodeLoader>& loader);
+}
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 
 class JSONString;
 struct Either;
@@ -64,5 +65,36 @@ namespace utilstr
 
     size_t FindFirstOfOutsideString(std::string str, std::string target, size_t _pos);
 
+    //  Remove all given chars, except inside string literals.
+    std::string RemoveCharsOutsideString(std::string& str, const std::string& chars);
+
     bool BeginsWith(std::string str, std::string target, size_t pos);
+
+    constexpr uint64_t HashOffsetBasis = 14695981039346656037ull;
+
+    //  64-bit FNV-1a hash of a char sequence. Passing the result of
+    //  a previous call as state continues hashing of the same sequence.
+    constexpr uint64_t Hash(const char* data, size_t size, uint64_t state = HashOffsetBasis)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            state ^= (unsigned char)data[i];
+            state *= 1099511628211ull;
+        }
+        return state;
+    }
+
+    constexpr uint64_t CheckOffsetBasis = 0x9E3779B97F4A7C15ull;
+
+    //  Second 64-bit hash of a char sequence, unrelated to Hash(..), to check a match
+    //  of the first. Continued in the same way.
+    constexpr uint64_t CheckHash(const char* data, size_t size, uint64_t state = CheckOffsetBasis)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            state = (state + (unsigned char)data[i]) * 0xC2B2AE3D27D4EB4Full;
+            state ^= state >> 29;
+        }
+        return state;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,46 @@
+/*****************************************************************//**
+ * \file   watch.h
+ * \brief  Notifications about modifications of a file.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+// Calls the handler on its own thread whenever the file is modified. Uses inotify where
+// available, and checks the modification time of the file otherwise. Editors often
+// write a file in several steps or replace it, so the handler is only called once
+// the file stays unchanged for a short while.
+class FileWatcher
+{
+public:
+    using Handler = std::function<void(const FileWatcher& watcher)>;
+
+private:
+    const std::string filename;
+    const Handler onChange;
+
+    std::atomic<bool> stopping = false;
+    std::thread thread;
+
+    void WatchEvents();
+    void WatchModificationTime();
+
+public:
+    FileWatcher(const std::string& filename, Handler onChange);
+
+    // Waits for the handler if it is running.
+    ~FileWatcher();
+
+    FileWatcher& operator=(const FileWatcher& rhs) = delete;
+    FileWatcher(const FileWatcher& other) = delete;
+
+    // Set when the watcher is destroyed. A handler waiting for something should give up then.
+    bool IsStopping() const { return stopping.load(); }
+};
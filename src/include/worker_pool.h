@@ -0,0 +1,51 @@
+/*****************************************************************//**
+ * \file   worker_pool.h
+ * \brief  Fixed set of threads running tasks in the background.
+ *
+ * \author Mikalai Varapai
+ * \date   October 2026
+ *********************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Runs submitted tasks on its threads, in the order of submission.
+// Exceptions thrown by tasks are dropped, so tasks keep their errors themselves.
+class WorkerPool
+{
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable available;  // Signalled when a task is submitted or the pool stops
+    std::condition_variable idle;       // Signalled when the last running task is done
+
+    std::deque<std::function<void()>> tasks;
+    size_t running = 0;
+    bool stopping = false;
+
+    // Body of every thread.
+    void Work();
+
+public:
+    // Zero threads means one thread per hardware thread.
+    WorkerPool(size_t threadCount = 0);
+
+    // Waits for the running tasks. Tasks that have not started are dropped.
+    ~WorkerPool();
+
+    WorkerPool& operator=(const WorkerPool& rhs) = delete;
+    WorkerPool(const WorkerPool& other) = delete;
+
+    void Submit(std::function<void()> task);
+
+    // Wait until every submitted task is done, including the ones submitted by tasks.
+    void Wait();
+
+    size_t Size() const { return threads.size(); }
+};
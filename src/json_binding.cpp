@@ -0,0 +1,336 @@
+//          json_binding.cpp
+//
+//  Provides the reader that bound types are read from, over the text of a document.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "json_binding.h"
+#include "json_string.h"
+
+#include <charconv>
+
+size_t jsonbinding::Reader::SkipString(size_t at) const
+{
+    size_t i = at + 1;
+    while (true)
+    {
+        i = jsonstring::FindQuoteOrEscape(text, i);
+        if (i >= text.size()) return std::string::npos;
+        if (text[i] == '"') return i + 1;
+        i += 2;
+    }
+}
+
+std::string_view jsonbinding::Reader::ScanNumber()
+{
+    const size_t begin = pos;
+    auto digits = [this]()
+    {
+        size_t first = pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') pos++;
+        return pos - first;
+    };
+
+    if (pos < text.size() && text[pos] == '-') pos++;
+    size_t whole = pos;
+    bool valid = digits() > 0 && (text[whole] != '0' || pos - whole == 1);
+
+    if (valid && pos < text.size() && text[pos] == '.')
+    {
+        pos++;
+        valid = digits() > 0;
+    }
+
+    if (valid && pos < text.size() && (text[pos] == 'e' || text[pos] == 'E'))
+    {
+        pos++;
+        if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) pos++;
+        valid = digits() > 0;
+    }
+
+    if (!valid)
+    {
+        pos = begin;
+        Fail("Invalid number.");
+    }
+    return text.substr(begin, pos - begin);
+}
+
+void jsonbinding::Reader::Mismatch(const char* expected)
+{
+    const char c = Peek();
+    const char* found = nullptr;
+    if (c == '{') found = "an object";
+    else if (c == '[') found = "a list";
+    else if (c == '"') found = "a string";
+    else if (c == 't' || c == 'f') found = "a boolean";
+    else if (c == 'n') found = "null";
+    else if (c == '-' || (c >= '0' && c <= '9')) found = "a number";
+    else if (c == '\0') found = "the end of the text";
+
+    std::string message = "Expected ";
+    message += expected;
+    if (found)
+    {
+        message += ", found ";
+        message += found;
+    }
+    Fail(message + ".");
+}
+
+bool jsonbinding::Reader::ReadNull()
+{
+    if (Peek() != 'n' || text.compare(pos, 4, "null") != 0) return false;
+    pos += 4;
+    return true;
+}
+
+bool jsonbinding::Reader::ReadBool()
+{
+    const char c = Peek();
+    if (c == 't' && text.compare(pos, 4, "true") == 0)
+    {
+        pos += 4;
+        return true;
+    }
+    if (c == 'f' && text.compare(pos, 5, "false") == 0)
+    {
+        pos += 5;
+        return false;
+    }
+    Mismatch("a boolean");
+}
+
+std::string_view jsonbinding::Reader::ReadInteger()
+{
+    const char c = Peek();
+    if (c != '-' && (c < '0' || c > '9')) Mismatch("an integer");
+
+    const size_t begin = pos;
+    std::string_view number = ScanNumber();
+    if (number.find_first_of(".eE") != std::string_view::npos)
+    {
+        pos = begin;
+        Fail("Expected an integer, found a number with a fraction or an exponent.");
+    }
+    return number;
+}
+
+double jsonbinding::Reader::ReadDouble()
+{
+    const char c = Peek();
+    if (c != '-' && (c < '0' || c > '9')) Mismatch("a number");
+
+    const size_t begin = pos;
+    std::string_view number = ScanNumber();
+    double value = 0;
+    if (std::from_chars(number.data(), number.data() + number.size(), value).ec != std::errc())
+    {
+        pos = begin;
+        Fail("Number is out of range of the field.");
+    }
+    return value;
+}
+
+void jsonbinding::Reader::ReadString(std::string& value)
+{
+    if (Peek() != '"') Mismatch("a string");
+
+    value.clear();
+    pos++;
+    while (true)
+    {
+        // Runs of text without escape sequences are copied at once
+        size_t end = jsonstring::FindQuoteOrEscape(text, pos);
+        if (end >= text.size() || (text[end] == '\\' && end + 1 == text.size()))
+        {
+            pos = end;
+            Fail("No closing quote found.");
+        }
+        value.append(text.data() + pos, end - pos);
+        pos = end + 1;
+        if (text[end] == '"') return;
+
+        switch (text[pos])
+        {
+        case '"': value += '"'; break;
+        case '\\': value += '\\'; break;
+        case '/': value += '/'; break;
+        case 'b': value += '\b'; break;
+        case 'f': value += '\f'; break;
+        case 'n': value += '\n'; break;
+        case 'r': value += '\r'; break;
+        case 't': value += '\t'; break;
+        case 'u':
+            // Surrogates without their pair are read as U+FFFD
+            if (jsonstring::DecodeUnicodeEscape(text, pos, value) != JSON_UNICODE_ESCAPE::JSON_UNICODE_ESCAPE_INVALID) break;
+            [[fallthrough]];
+        default:
+            pos = end;
+            Fail("Valid escape sequence expected.");
+        }
+        pos++;
+    }
+}
+
+void jsonbinding::Reader::Enter(char opening)
+{
+    if (Peek() != opening) Mismatch(opening == '{' ? "an object" : "a list");
+    if (depth == MaxNestingDepth) Fail("Nesting is deeper than " + std::to_string(MaxNestingDepth) + " levels.");
+
+    depth++;
+    pos++;
+    fresh = true;
+}
+
+void jsonbinding::Reader::BeginObject()
+{
+    Enter('{');
+}
+
+bool jsonbinding::Reader::NextMember(std::string_view& key)
+{
+    char c = Peek();
+    if (c == '}')
+    {
+        fresh = false;
+        depth--;
+        pos++;
+        return false;
+    }
+
+    if (!fresh)
+    {
+        if (c != ',') Fail("Expected ','.");
+        pos++;
+        c = Peek();
+    }
+    fresh = false;
+    if (c != '"') Fail("Expected valid identifier.");
+
+    // Keys without escape sequences are seen in the text, the others are decoded
+    size_t end = jsonstring::FindQuoteOrEscape(text, pos + 1);
+    if (end < text.size() && text[end] == '"')
+    {
+        key = text.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+    }
+    else
+    {
+        ReadString(scratch);
+        key = scratch;
+    }
+
+    if (Peek() != ':') Fail("Expected ':'.");
+    pos++;
+    return true;
+}
+
+void jsonbinding::Reader::BeginList()
+{
+    Enter('[');
+}
+
+bool jsonbinding::Reader::NextElement()
+{
+    char c = Peek();
+    if (c == ']')
+    {
+        fresh = false;
+        depth--;
+        pos++;
+        return false;
+    }
+
+    if (!fresh)
+    {
+        if (c != ',') Fail("Expected ','.");
+        pos++;
+        if (Peek() == ']') Fail("Expected a value.");
+    }
+    fresh = false;
+    return true;
+}
+
+void jsonbinding::Reader::SkipValue()
+{
+    const char c = Peek();
+    if (c == '"')
+    {
+        size_t end = SkipString(pos);
+        if (end == std::string::npos) Fail("No closing quote found.");
+        pos = end;
+        return;
+    }
+
+    // Containers are skipped to their closing bracket, without looking at what is inside
+    if (c == '{' || c == '[')
+    {
+        size_t nested = 0;
+        for (size_t i = pos; i < text.size(); i++)
+        {
+            const char d = text[i];
+            if (d == '"')
+            {
+                i = SkipString(i);
+                if (i == std::string::npos) break;
+                i--;
+            }
+            else if (d == '{' || d == '[') nested++;
+            else if ((d == '}' || d == ']') && --nested == 0)
+            {
+                pos = i + 1;
+                return;
+            }
+        }
+        Fail("No closing parentheses found.");
+    }
+
+    const size_t begin = pos;
+    while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']'
+        && text[pos] != ' ' && text[pos] != '\n' && text[pos] != '\r' && text[pos] != '\t')
+    {
+        pos++;
+    }
+    if (pos == begin) Fail("Expected a value.");
+}
+
+void jsonbinding::Reader::End()
+{
+    if (Peek() != '\0') Fail("Invalid characters after the value.");
+}
+
+bool jsonbinding::ParseInteger(std::string_view text, int64_t& value)
+{
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool jsonbinding::ParseInteger(std::string_view text, uint64_t& value)
+{
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+void jsonbinding::Throw(const BindError& error, std::string_view text, const std::string& name)
+{
+    size_t line = 1;
+    for (size_t i = 0; i < error.pos && i < text.size(); i++)
+    {
+        if (text[i] == '\n') line++;
+    }
+
+    std::string message = "[ERROR] " + name + ":" + std::to_string(line) + " - " + error.message;
+
+    // Members at the root have a '.' before them, as the ones of any other object
+    std::string_view path = error.path;
+    if (!path.empty() && path.front() == '.') path.remove_prefix(1);
+    if (!path.empty())
+    {
+        message.pop_back();
+        message += " at \"";
+        message += path;
+        message += "\".";
+    }
+    throw JSONLoadError(message);
+}
@@ -2,15 +2,24 @@
 #include "utilstr.h"
 #include "command.h"
 #include "query.h"
+#include "snapshot.h"
+#include "offset_index.h"
+#include "progressive.h"
+#include "projection.h"
+#include "path_index.h"
+#include "path_pattern.h"
+#include "json_string.h"
+#include "worker_pool.h"
+#include "byte_stream.h"
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <thread>
+#include <exception>
 
 static constexpr char SeparatorChar = '-';
 
-// Helper recursive function, assumes unprocessed strings
-JSON::JSONNode* resolve_json(JSONString body, JSON::JSONNode* parent);
-
 // Create an initial JSONString, containing the whole trimmed data.
 JSONString JSONSource::GetString() { return JSONString(this, trimmedStr.data(), trimmedStr.size()); }
 
@@ -29,25 +38,40 @@ void isInString(const char c, bool& escape, bool& inString)
     else if (escape) escape = false;
 }
 
+// Whether the character may be a part of a number, true, false or null.
+static bool IsLiteralChar(const char c)
+{
+    return isalnum((unsigned char)c) || c == '.' || c == '+' || c == '-';
+}
+
+// Whether trimming drops the character, given whether it is in a string literal.
+// Only whitespace is ever dropped, and it does not change the string state.
+template <class Policy>
+static bool IsDroppedSpace(const char c, bool inString)
+{
+    if constexpr (Policy::trimsStrings)
+    {
+        // Tabs and newlines are removed either way, whitespaces only outside strings
+        return c == '\t' || c == '\n' || (c == ' ' && !inString);
+    }
+    else
+    {
+        // Whitespace of RFC 8259, outside strings only
+        return !inString && (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+    }
+}
+
 // Loop invariant: check whether the symbol should be retained.
 // Arguments:
 //  c : current character
 //  escape : true if previous character was '\'
 //  inString : true if character c is contained in string literal
 // Supposed to be invoked from a while loop, with initial bool values set to false.
-bool CleanTest(const char c, bool& escape, bool& inString)
+template <class Policy>
+static bool CleanTest(const char c, bool& escape, bool& inString)
 {
     isInString(c, escape, inString);
-
-    // Choose whether to drop the character
-
-    // Tabs and newlines are removed either way
-    if (c == '\t' || c == '\n') return false;
-
-    // Remove whitespaces only outside strings
-    if (c == ' ' && !inString) return false;
-
-    return true;
+    return !IsDroppedSpace<Policy>(c, inString);
 }
 
 // Function to transform initial raw character position from trimmed string,
@@ -56,33 +80,36 @@ bool CleanTest(const char c, bool& escape, bool& inString)
 // in trimmed string is returned.
 JSONSource::Pos JSONSource::GetSymbolSourcePosition(size_t trimmedOffset)
 {
-    size_t sourcePos = 0;
-    size_t trimmedPos = 0;	// Counts all symbols except whitespaces, tabs and newlines
-    size_t lineOffset = 0;		// Counts all symbols up to last newline, according to source
-    size_t line = 1;			// Number of whole lines
+    if (trimmedStr.empty()) return Pos(1, 1);
+    if (trimmedOffset >= trimmedStr.size()) trimmedOffset = trimmedStr.size() - 1;
 
-    bool escape = false;
-    bool inString = false;
+    // Kept characters are never newlines, so the source position is inside a line.
+    size_t sourcePos = GetFileOffset(trimmedOffset) - fileOffset;
 
-    for (sourcePos = 0; sourcePos < sourceStr.size(); sourcePos++)
-    {
-        char c = sourceStr.at(sourcePos);
+    size_t line = 1 + std::count(sourceStr.begin(), sourceStr.begin() + sourcePos, '\n');
+    size_t lineOffset = sourceStr.rfind('\n', sourcePos);
+    lineOffset = (lineOffset == std::string::npos) ? 0 : lineOffset + 1;
 
-        if (c == '\n')
-        {
-            line++;
-            lineOffset = sourcePos + 1;
-        }
+    Pos query(line, sourcePos - lineOffset + 1);
+    return query;
+}
 
-        if (CleanTest(c, escape, inString)) trimmedPos++;
-        if (trimmedPos == trimmedOffset + 1) break;
+size_t JSONSource::GetFileOffset(size_t trimmedPos)
+{
+    if (trimmedPos >= trimmedStr.size()) return fileOffset + sourceStr.size();
 
-        // If the end of trimmed string reached
-        if (trimmedPos == trimmedStr.size()) break;
-    }
+    // Find the last run starting at or before the position
+    auto run = std::upper_bound(offsetMap.begin(), offsetMap.end(), 
+        std::make_pair(trimmedPos, SIZE_MAX)) - 1;
+    return fileOffset + run->second + (trimmedPos - run->first);
+}
 
-    Pos query(line, sourcePos - lineOffset + 1);
-    return query;
+size_t JSONSource::GetTrimmedPos(size_t offset)
+{
+    // Find the last run starting at or before the offset
+    auto run = std::upper_bound(offsetMap.begin(), offsetMap.end(), offset - fileOffset,
+        [](size_t value, const std::pair<size_t, size_t>& run) { return value < run.second; }) - 1;
+    return run->first + (offset - fileOffset - run->second);
 }
 
 // Translate Pos object to string
@@ -97,33 +124,373 @@ std::string JSONSource::Pos::ToString()
     return str;
 }
 
+// Files are trimmed in chunks of at least this size, one per thread.
+static constexpr size_t MinTrimChunk = 64 * 1024;
+
+// State of trimming before a position of the source.
+struct TrimState
+{
+    bool escape = false;    // Check whether previous symbol was '\'.
+    bool inString = false;  // Check if currently processed symbol is part of a string literal.
+    bool dropped = true;    // Check whether previous symbol was removed.
+    char lastKept = '\0';   // Last symbol kept, if any.
+    size_t depth = 0;       // Containers opened and not closed yet, whether they match or not.
+};
+
+// Characters kept from a part of the source, and what the policy rejects among them.
+// Positions are relative to the part.
+struct TrimmedPart
+{
+    std::string result;
+    std::vector<std::pair<size_t, size_t>> offsetMap;   // Source positions are those of the whole source
+    size_t invalidPos = std::string::npos;              // Control character in a string or split literal
+    size_t nestingPos = std::string::npos;              // Container nested deeper than MaxNestingDepth
+
+    // Depth at the end and its extremes over the part, counted from zero without stopping at it
+    ptrdiff_t net = 0;
+    ptrdiff_t lowest = 0;
+    ptrdiff_t highest = 0;
+};
+
+// Trim the characters of [begin, end), starting in the given state. Returns the state after them.
+template <class Policy>
+static TrimState TrimPart(const std::string& source, size_t begin, size_t end, TrimState state, TrimmedPart& part,
+    JSONLoadProgress* progress)
+{
+    std::string& result = part.result;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const char c = source[i];
+
+        // Report every megabyte
+        if (progress && ((i - begin) & 0xFFFFF) == 0 && i != begin)
+        {
+            progress->done.fetch_add(0x100000, std::memory_order_relaxed);
+            if (progress->cancelled.load(std::memory_order_relaxed)) throw JSONLoadError("Loading cancelled.");
+        }
+
+        if (CleanTest<Policy>(c, state.escape, state.inString))
+        {
+            if constexpr (Policy::rejectsControlCharacters)
+            {
+                if (state.inString && (unsigned char)c < 0x20 && part.invalidPos == std::string::npos) part.invalidPos = result.size();
+            }
+
+            // Parts of a literal would be joined, e.g. "nu ll"
+            if constexpr (Policy::rejectsSplitLiterals)
+            {
+                if (state.dropped && !state.inString && IsLiteralChar(c) && part.invalidPos == std::string::npos)
+                {
+                    const char previous = result.empty() ? state.lastKept : result.back();
+                    if (previous != '\0' && IsLiteralChar(previous)) part.invalidPos = result.size();
+                }
+            }
+
+            if (!state.inString)
+            {
+                if (c == '{' || c == '[')
+                {
+                    if (++state.depth > MaxNestingDepth && part.nestingPos == std::string::npos) part.nestingPos = result.size();
+                    if (++part.net > part.highest) part.highest = part.net;
+                }
+                else if (c == '}' || c == ']')
+                {
+                    if (state.depth > 0) state.depth--;
+                    if (--part.net < part.lowest) part.lowest = part.net;
+                }
+            }
+
+            if (state.dropped) part.offsetMap.push_back({ result.size(), i });
+            result += c;
+            state.dropped = false;
+        }
+        else state.dropped = true;
+    }
+    return state;
+}
+
+// Take the results of trimming the whole source as one part.
+template <class Policy>
+static std::string FinishPart(TrimmedPart& part, std::vector<std::pair<size_t, size_t>>& offsetMap,
+    size_t& invalidPos, size_t& invalidUtf8Pos)
+{
+    offsetMap = std::move(part.offsetMap);
+    invalidPos = std::min(part.invalidPos, part.nestingPos);
+
+    // Bytes past ASCII are never dropped, so the trimmed string has all of them
+    if constexpr (Policy::invalidUtf8 != JSON_INVALID_UTF8::JSON_INVALID_UTF8_KEEP)
+    {
+        invalidUtf8Pos = jsonstring::FindInvalidUtf8(part.result);
+    }
+    return std::move(part.result);
+}
+
+// Run task(0..count-1) on the pool, and rethrow the first exception of the tasks, e.g. of a cancelled loading.
+template <class Task>
+static void RunParts(WorkerPool& pool, size_t count, const Task& task)
+{
+    std::mutex mutex;
+    std::exception_ptr error;
+
+    for (size_t k = 0; k < count; k++)
+    {
+        pool.Submit([&, k]()
+        {
+            try
+            {
+                task(k);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+            }
+        });
+    }
+    pool.Wait();
+    if (error) std::rethrow_exception(error);
+}
+
 //  Helper function to remove all characters that do not
 //  contibute to JSON syntax, namely:
 //      1. Tabs
 //      2. Newlines
 //      3. Whitespaces (except for string literals)
-std::string CleanJSON(std::string source)
+//  Runs of kept characters are recorded to offsetMap. The trimmed position of the first container
+//  nested deeper than MaxNestingDepth is stored to invalidPos, and so is that of the first control
+//  character in a string or split literal, if the policy rejects them.
+//  Unless the policy keeps invalid UTF-8, the trimmed position of its first byte is stored to invalidUtf8Pos.
+//
+//  Large sources are split into chunks trimmed on threads of their own. The only state that crosses
+//  chunks is whether a string is open, which changes at each unescaped quote: a first pass counts them
+//  in every chunk, and whether the previous symbol escapes the first one is seen from the backslashes
+//  before it. Chunks are then trimmed from their known states, and the depths they start at are added
+//  up from the changes of depth over the chunks before them.
+template <class Policy>
+static std::string CleanJSON(const std::string& source, std::vector<std::pair<size_t, size_t>>& offsetMap,
+    size_t& invalidPos, size_t& invalidUtf8Pos, size_t threads, JSONLoadProgress* progress = nullptr)
 {
-    std::string result;
+    if (progress)
+    {
+        progress->done.store(0, std::memory_order_relaxed);
+        progress->total.store(source.size(), std::memory_order_relaxed);
+        progress->stage.store(JSONLoadProgress::STAGE_TRIMMING, std::memory_order_relaxed);
+    }
 
-    bool escape = false;    // Check whether previous symbol was '\'.
-    bool inString = false;  // Check if currently processed symbol is part of a string literal.
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t count = std::min(threads, source.size() / MinTrimChunk);
+
+    if (count <= 1)
+    {
+        TrimmedPart part;
+        TrimPart<Policy>(source, 0, source.size(), TrimState(), part, progress);
+        return FinishPart<Policy>(part, offsetMap, invalidPos, invalidUtf8Pos);
+    }
+
+    std::vector<size_t> bounds(count + 1);
+    for (size_t k = 0; k <= count; k++) bounds[k] = source.size() / count * k;
+    bounds[count] = source.size();
+
+    // Whether the first character of a chunk is escaped, by an odd number of backslashes before it
+    auto escaped = [&source](size_t pos)
+    {
+        size_t backslashes = 0;
+        while (pos > backslashes && source[pos - backslashes - 1] == '\\') backslashes++;
+        return backslashes % 2 == 1;
+    };
+
+    WorkerPool pool(count);
+
+    std::vector<char> parities(count);
+    RunParts(pool, count, [&](size_t k)
+    {
+        parities[k] = jsonstring::OddQuotes(source, bounds[k] + (escaped(bounds[k]) ? 1 : 0), bounds[k + 1]);
+    });
+
+    // States at the starts of the chunks. The symbols dropped before a chunk are whitespace,
+    // which leaves the string state as it is, so they are found going back from its start.
+    std::vector<TrimState> states(count);
+    for (size_t k = 1; k < count; k++)
+    {
+        TrimState& state = states[k];
+        state.inString = states[k - 1].inString != (bool)parities[k - 1];
+        state.escape = escaped(bounds[k]);
+
+        size_t kept = bounds[k];
+        while (kept > 0 && IsDroppedSpace<Policy>(source[kept - 1], state.inString)) kept--;
+        state.dropped = kept < bounds[k];
+        state.lastKept = kept > 0 ? source[kept - 1] : '\0';
+    }
+
+    std::vector<TrimmedPart> parts(count);
+    RunParts(pool, count, [&](size_t k)
+    {
+        TrimPart<Policy>(source, bounds[k], bounds[k + 1], states[k], parts[k], progress);
+    });
+
+    std::vector<size_t> offsets(count + 1);    // Of the chunks in the trimmed string
+    std::vector<size_t> runs(count + 1);       // Of their first runs in offsetMap
+    size_t depth = 0;
+    invalidPos = std::string::npos;
+    for (size_t k = 0; k < count; k++)
+    {
+        TrimmedPart& part = parts[k];
+        offsets[k + 1] = offsets[k] + part.result.size();
+
+        // Depths in a chunk starting deeper than zero are only counted again if they may be too deep.
+        // Closing brackets stop at zero, so the depth at the end is that of the lowest point, if higher.
+        if (depth > 0 && (ptrdiff_t)depth + part.highest > (ptrdiff_t)MaxNestingDepth)
+        {
+            TrimmedPart again;
+            TrimState state = states[k];
+            state.depth = depth;
+            TrimPart<Policy>(source, bounds[k], bounds[k + 1], state, again, nullptr);
+            part.nestingPos = again.nestingPos;
+        }
+        depth = (size_t)std::max((ptrdiff_t)depth + part.net, part.net - part.lowest);
+
+        if (invalidPos == std::string::npos)
+        {
+            size_t first = std::min(part.invalidPos, part.nestingPos);
+            if (first != std::string::npos) invalidPos = offsets[k] + first;
+        }
+
+        runs[k + 1] = runs[k] + part.offsetMap.size();
+    }
+
+    // Chunks start in the dropped state of the symbol before them, so a run going on over the start
+    // of a chunk is not recorded again, and the runs are those of trimming in one pass
+    std::string result(offsets[count], '\0');
+    offsetMap.resize(runs[count]);
+    RunParts(pool, count, [&](size_t k)
+    {
+        std::copy(parts[k].result.begin(), parts[k].result.end(), result.begin() + offsets[k]);
+        parts[k].result = {};
+
+        auto run = offsetMap.begin() + runs[k];
+        for (const auto& partRun : parts[k].offsetMap) *run++ = { partRun.first + offsets[k], partRun.second };
+        parts[k].offsetMap = {};
+    });
 
-    for (char& c : source)
+    // Chunks of the trimmed string are checked from their first byte that does not continue a sequence.
+    // No valid sequence has such a byte inside it, so each chunk is checked as it would be in one pass.
+    if constexpr (Policy::invalidUtf8 != JSON_INVALID_UTF8::JSON_INVALID_UTF8_KEEP)
     {
-        if (CleanTest(c, escape, inString)) result += c;
+        std::vector<size_t> starts(count + 1, result.size());
+        for (size_t k = 0; k < count; k++)
+        {
+            size_t start = offsets[k];
+            while (start < offsets[k + 1] && ((unsigned char)result[start] & 0xC0) == 0x80) start++;
+            starts[k] = k == 0 ? 0 : start;
+        }
+
+        std::vector<size_t> found(count, std::string::npos);
+        RunParts(pool, count, [&](size_t k)
+        {
+            found[k] = jsonstring::FindInvalidUtf8(result, starts[k], std::max(starts[k], starts[k + 1]));
+        });
+        invalidUtf8Pos = *std::min_element(found.begin(), found.end());
     }
     return result;
 }
 
+static std::string CleanJSON(const std::string& source, std::vector<std::pair<size_t, size_t>>& offsetMap,
+    size_t& invalidPos, size_t& invalidUtf8Pos, JSON_PARSE_POLICY policy, size_t threads = 0,
+    JSONLoadProgress* progress = nullptr)
+{
+    return WithPolicy(policy, [&](auto tag)
+    {
+        return CleanJSON<decltype(tag)>(source, offsetMap, invalidPos, invalidUtf8Pos, threads, progress);
+    });
+}
+
+// Same as CleanJSON(..), for a source read in blocks, which are appended to it. Each block is trimmed
+// as it comes, while the reader reads and decompresses the next ones.
+template <class Policy>
+static std::string CleanStream(bytestream::BlockReader& reader, std::string& source,
+    std::vector<std::pair<size_t, size_t>>& offsetMap, size_t& invalidPos, size_t& invalidUtf8Pos,
+    JSONLoadProgress* progress)
+{
+    // The size is not known until the end, so only the characters read are reported
+    if (progress)
+    {
+        progress->done.store(0, std::memory_order_relaxed);
+        progress->total.store(0, std::memory_order_relaxed);
+        progress->stage.store(JSONLoadProgress::STAGE_READING, std::memory_order_relaxed);
+    }
+
+    TrimState state;
+    TrimmedPart part;
+    std::string block;
+    while (reader.Next(block))
+    {
+        if (progress)
+        {
+            if (progress->cancelled.load(std::memory_order_relaxed)) throw JSONLoadError("Loading cancelled.");
+            progress->done.fetch_add(block.size(), std::memory_order_relaxed);
+        }
+
+        const size_t begin = source.size();
+        source += block;
+        state = TrimPart<Policy>(source, begin, source.size(), state, part, nullptr);
+    }
+    return FinishPart<Policy>(part, offsetMap, invalidPos, invalidUtf8Pos);
+}
+
+JSONSource::LoadedText JSONSource::ReadText(const std::string& filename, JSON_PARSE_POLICY policy, size_t trimThreads,
+    JSONLoadProgress* progress)
+{
+    LoadedText text;
+    if (bytestream::IsPlainFile(filename))
+    {
+        text.source = utilstr::ReadFromFile(filename);
+        text.trimmed = CleanJSON(text.source, text.offsetMap, text.invalidPos, text.invalidUtf8Pos, policy, trimThreads, progress);
+        return text;
+    }
+
+    // Files that cannot be opened are empty, as for plain files
+    std::unique_ptr<bytestream::ByteStream> stream = bytestream::Open(filename);
+    if (!stream) return text;
+
+    bytestream::BlockReader reader(std::move(stream));
+    text.trimmed = WithPolicy(policy, [&](auto tag)
+    {
+        return CleanStream<decltype(tag)>(reader, text.source, text.offsetMap, text.invalidPos, text.invalidUtf8Pos, progress);
+    });
+    return text;
+}
+
 // Constructor of JSONSource - provider of underlying data to JSONString.
-JSONSource::JSONSource(std::string filename) 
-    : filename(filename), 
-    sourceStr(utilstr::ReadFromFile(filename)), 
-    trimmedStr(CleanJSON(sourceStr)) { }
+JSONSource::JSONSource(std::string filename)
+    : JSONSource(filename, nullptr, true, JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT) { }
+
+JSONSource::JSONSource(std::string filename, JSONLoadProgress* progress, bool exitOnError, JSON_PARSE_POLICY policy,
+    size_t trimThreads)
+    : JSONSource(filename, progress, exitOnError, policy, ReadText(filename, policy, trimThreads, progress)) { }
+
+JSONSource::JSONSource(std::string filename, JSONLoadProgress* progress, bool exitOnError, JSON_PARSE_POLICY policy,
+    LoadedText&& text)
+    : filename(filename),
+    progress(progress),
+    exitOnError(exitOnError),
+    policy(policy),
+    invalidPos(text.invalidPos),
+    invalidUtf8Pos(text.invalidUtf8Pos),
+    sourceStr(std::move(text.source)),
+    offsetMap(std::move(text.offsetMap)),
+    trimmedStr(std::move(text.trimmed)) { }
+
+JSONSource::JSONSource(std::string filename, std::string contents, size_t fileOffset, bool exitOnError, JSON_PARSE_POLICY policy)
+    : filename(filename),
+    fileOffset(fileOffset),
+    exitOnError(exitOnError),
+    policy(policy),
+    sourceStr(std::move(contents)),
+    trimmedStr(CleanJSON(sourceStr, offsetMap, invalidPos, invalidUtf8Pos, policy)) { }
 
 // Main means for displaying a message. If message is an error, program cannot function
-// correctly and it exits.
+// correctly and it exits, or throws JSONLoadError if the source is loaded in the background.
 void JSONString::PrintSyntaxMsg(std::string errorText, int msgType, size_t _Off)const
 {
     // [ERROR] test1.json:2 - "X expected."
@@ -148,9 +515,14 @@ void JSONString::PrintSyntaxMsg(std::string errorText, int msgType, size_t _Off)
     msg += " - ";
     msg += errorText;
 
+    // Going on with a syntax error is impossible.
+    if (msgType == SYNTAX_MSG_TYPE_ERROR && !source->ExitsOnError())
+    {
+        throw JSONLoadError(msg);
+    }
+
     std::cerr << msg << std::endl;
 
-    // Going on with a syntax error is impossible.
     if (msgType == SYNTAX_MSG_TYPE_ERROR) 
     {
         std::cerr << "Interpretation failed." << std::endl;
@@ -162,11 +534,16 @@ void JSONString::PrintSyntaxMsg(std::string errorText, int msgType, size_t _Off)
 // Given a JSONString starting with '"', retrieve the string literal.
 // If successfully terminated, returns std::string containing the literal,
 // and _Pos being equal to the position of character after closing '"'.
-// Parser uses following escape sequences:
-//  \\ -> backslash
-//  \n -> newline
-//  \t -> tab
-//  \" -> "
+// Parser uses the escape sequences of RFC 8259:
+//  \\ \" \/ -> the character itself
+//  \b \f \n \r \t -> control characters
+//  \uXXXX -> the code point in UTF-8, with surrogate pairs joined
+std::string JSONString::ScanString(size_t& _Pos)
+{
+    return WithPolicy(source->GetPolicy(), [&](auto tag) { return ScanString<decltype(tag)>(_Pos); });
+}
+
+template <class Policy>
 std::string JSONString::ScanString(size_t& _Pos)
 {
     if (at(0) != '"')
@@ -175,59 +552,87 @@ std::string JSONString::ScanString(size_t& _Pos)
         return "";
     }
 
-    bool escape = false;
-    bool closingFound = false;
-    std::string str;
-
-    size_t i;
-    for (i = 1; i < size; i++)
+    // Escape sequences the parser does not read are reported as the policy says
+    auto unknownEscape = [this](const std::string& message, size_t i)
     {
-        char c = at(i);
-
-        // If this character follows \, it is an escape sequence
-        if (escape)
+        if constexpr (Policy::unknownEscapes == JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_ERROR)
         {
-            escape = false;
-            switch (c)
-            {
-            case '\\':
-                str += '\\';
-                break;
-            case 'n':
-                str += '\n';
-                break;
-            case 't':
-                str += '\t';
-                break;
-            case '\"':
-                str += '\"';
-                break;
-            default:
-                PrintSyntaxMsg("Valid escape sequence expected.", SYNTAX_MSG_TYPE_WARNING, i);
-            }
-            continue;
+            PrintSyntaxMsg(message, SYNTAX_MSG_TYPE_ERROR, i);
         }
-        
-        // Read next character as an escape sequence
-        if (c == '\\')
+        else if constexpr (Policy::unknownEscapes == JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_WARN)
         {
-            escape = true;
-            continue;
+            PrintSyntaxMsg(message, SYNTAX_MSG_TYPE_WARNING, i);
         }
+    };
+
+    std::string_view text = View();
+    std::string str;
+
+    size_t i = 1;
+    while (true)
+    {
+        // Characters up to the next quote or backslash are copied at once
+        size_t next = jsonstring::FindQuoteOrEscape(text, i);
+        str.append(text.data() + i, next - i);
+        i = next;
+        if (i >= size) break;
 
         // Closing '"' found
-        if (c == '"')
+        if (text[i] == '"')
         {
             _Pos = i + 1;
             return str;
         }
 
-        // Any other character
-        str += c;
+        // Read next character as an escape sequence
+        if (++i >= size) break;
+
+        const char c = text[i];
+        switch (c)
+        {
+        case '\\':
+        case '"':
+        case '/':
+            str += c;
+            break;
+        case 'b':
+            str += '\b';
+            break;
+        case 'f':
+            str += '\f';
+            break;
+        case 'n':
+            str += '\n';
+            break;
+        case 'r':
+            str += '\r';
+            break;
+        case 't':
+            str += '\t';
+            break;
+        case 'u':
+        {
+            JSON_UNICODE_ESCAPE result = jsonstring::DecodeUnicodeEscape(text, i, str);
+            if (result == JSON_UNICODE_ESCAPE::JSON_UNICODE_ESCAPE_UNPAIRED)
+            {
+                unknownEscape("Valid surrogate pair expected.", i);
+            }
+            else if (result == JSON_UNICODE_ESCAPE::JSON_UNICODE_ESCAPE_INVALID)
+            {
+                if constexpr (Policy::unknownEscapes == JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_KEEP) str += c;
+                unknownEscape("Valid escape sequence expected.", i);
+            }
+            break;
+        }
+        default:
+            if constexpr (Policy::unknownEscapes == JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_KEEP) str += c;
+            unknownEscape("Valid escape sequence expected.", i);
+        }
+        i++;
     }
 
     // No closing '"' found.
-    PrintSyntaxMsg("'\"' expected.", SYNTAX_MSG_TYPE_ERROR, i - 1);    
+    PrintSyntaxMsg("'\"' expected.", SYNTAX_MSG_TYPE_ERROR, i - 1);
     _Pos = i;
     return str;
 }
@@ -289,72 +694,1020 @@ JSONString JSONString::ScanListObjectBody(size_t& _Pos)
             return substr(0, _Pos);
         }
     }
-    PrintSyntaxMsg("No closing parentheses found.", SYNTAX_MSG_TYPE_ERROR, size - 1);
-    return *this;
+    PrintSyntaxMsg("No closing parentheses found.", SYNTAX_MSG_TYPE_ERROR, size - 1);
+    return *this;
+}
+
+// Given JSONString, the function looks for a comma outside a string literal.
+// If found, returns a substring without the comma and _Pos of the comma.
+// If no comma found, returns this string and _Pos one symbol after.
+JSONString JSONString::ScanLiteral(size_t& _Pos)
+{
+    bool escape = false;
+    bool inString = false;
+
+    // Scan till the first comma outside a string
+    size_t i;
+    for (i = 0; i < size; i++)
+    {
+        const char c = at(i);
+        isInString(c, escape, inString);
+
+        if (c == ',' && !inString)
+        {
+            // When substr(_Pos) is called afterwards,
+            // the comma is preserved for parser to perform further reasoning.
+            // substr(0, i), on the other hand, does not include that comma.
+            _Pos = i;
+            return substr(0, i);
+        }
+    }
+
+    // Here, if no comma was detected, we return _Pos = size.
+    // That is, whole string is returned, and no substring can be
+    // found using _Pos, because it is the first element after the string end.
+    _Pos = i;
+    return substr(0, i);
+}
+
+// Report the first character that trimming found to be against the policy of the source.
+static void CheckTrimmed(JSONString source)
+{
+    size_t invalidPos = source.GetSource()->GetInvalidPos();
+
+    // Invalid UTF-8 may only be a warning, after which the rest is checked as well
+    size_t invalidUtf8Pos = source.GetSource()->GetInvalidUtf8Pos();
+    if (invalidUtf8Pos < invalidPos)
+    {
+        bool error = InvalidUtf8(source.GetSource()->GetPolicy()) == JSON_INVALID_UTF8::JSON_INVALID_UTF8_ERROR;
+        source.PrintSyntaxMsg("Invalid UTF-8 sequence.", error ? SYNTAX_MSG_TYPE_ERROR : SYNTAX_MSG_TYPE_WARNING, invalidUtf8Pos);
+    }
+
+    if (invalidPos != std::string::npos)
+    {
+        const char c = source.at(invalidPos);
+        if (c == '{' || c == '[')
+        {
+            source.PrintSyntaxMsg("Nesting is deeper than " + std::to_string(MaxNestingDepth) + " levels.",
+                SYNTAX_MSG_TYPE_ERROR, invalidPos);
+        }
+        bool control = (unsigned char)c < 0x20;
+        source.PrintSyntaxMsg(control ? "Control characters in strings must be escaped." : "Invalid literal.",
+            SYNTAX_MSG_TYPE_ERROR, invalidPos);
+    }
+}
+
+// Check that the whole trimmed source is an object.
+static bool CheckRoot(JSONString source)
+{
+    CheckTrimmed(source);
+
+    // Check for empty input
+    if (source.Size() == 0)
+    {
+        std::string errorMsg = "JSON file does not exist or is empty.";
+        source.PrintSyntaxMsg(errorMsg, SYNTAX_MSG_TYPE_ERROR);
+
+        return false;
+    }
+
+    // Check first important condition - global space must be an object.
+    if (!utilstr::BeginsAndEndsWith(source, '{', '}'))
+    {
+        std::string errorMsg = "JSON file does not contain an object. ";
+        errorMsg += "Correct format of the file would be: \"{..}\". ";
+        errorMsg += "Empty JSON object returned.";
+        source.PrintSyntaxMsg(errorMsg);
+
+        return false;
+    }
+    return true;
+}
+
+// Entry point to creating a JSON object.
+// Performs some assertions and builds recursively the JSON syntax tree.
+JSON::JSON(const std::string& filename, const JSONLoadOptions& options)
+{
+    // The tree is not complete if an error is thrown, so nothing is kept.
+    try
+    {
+        Load(filename, options);
+    }
+    catch (...)
+    {
+        if (loader) loader->Cancel();
+        if (globalSpace) delete globalSpace;
+        globalSpace = nullptr;
+        if (jsonSource) delete jsonSource;
+        jsonSource = nullptr;
+        throw;
+    }
+
+    pathIndexEnabled = options.pathIndex;
+    if (options.progress) options.progress->stage.store(JSONLoadProgress::STAGE_DONE);
+}
+
+void JSON::Load(const std::string& filename, const JSONLoadOptions& options)
+{
+    // A published tree is shared with its publisher, and its containers are expanded on first access.
+    if (options.attachShared)
+    {
+        globalSpace = snapshot::Attach(filename, loader);
+        if (!globalSpace) throw JSONLoadError("No document is published as \"" + snapshot::SegmentName(filename) + "\".");
+        return;
+    }
+
+    if (!options.projection.empty())
+    {
+        std::shared_ptr<JSONProjection> paths = std::make_shared<JSONProjection>();
+        for (const std::string& path : options.projection)
+        {
+            if (!paths->Add(path)) throw JSONLoadError("Path \"" + path + "\" cannot be projected.");
+        }
+        projection = paths;
+    }
+
+    // Snapshots are checked against a file on disk, and indices read it by offsets, so the standard input
+    // and pipes are only parsed. Compressed files may have a snapshot, but not an index.
+    const bool useSnapshot = options.useSnapshot && !projection && bytestream::IsRegularFile(filename);
+    const bool useIndex = options.useIndex && !projection && bytestream::IsPlainFile(filename);
+
+    // A valid snapshot lets us skip reading and parsing the file altogether.
+    // Its containers are expanded on first access.
+    if (useSnapshot)
+    {
+        globalSpace = snapshot::Open(filename, loader);
+        if (globalSpace) return;
+    }
+
+    // With an index, only the visited parts of the file are read.
+    if (useIndex)
+    {
+        globalSpace = offsetindex::Open(filename, loader);
+        if (globalSpace) return;
+    }
+
+    JSONLoadProgress* progress = options.progress;
+
+    jsonSource = new JSONSource(filename, progress, options.exitOnError, options.policy, options.trimThreads);
+    JSONString source = jsonSource->GetString();
+
+    if (!CheckRoot(source)) return;
+
+    // Here, by the condition above, we are certain that the global space
+    // is in fact a JSON object.
+    if (progress)
+    {
+        progress->done.store(0, std::memory_order_relaxed);
+        progress->total.store(source.Size(), std::memory_order_relaxed);
+        progress->stage.store(JSONLoadProgress::STAGE_PARSING, std::memory_order_relaxed);
+    }
+
+    // Snapshots are written from the whole tree, so it is parsed at once.
+    if (projection)
+    {
+        globalSpace = projection::Parse(*jsonSource, *projection);
+    }
+    else if (options.progressive && !useSnapshot)
+    {
+        globalSpace = progressive::Parse(*jsonSource, options.progressiveThreshold, loader);
+    }
+    else
+    {
+        globalSpace = static_cast<JSONObject*>(resolve_json(source, globalSpace));
+    }
+
+    if (progress) progress->stage.store(JSONLoadProgress::STAGE_SAVING, std::memory_order_relaxed);
+
+    if (useSnapshot && !snapshot::Write(globalSpace, filename))
+    {
+        std::cerr << "[WARNING] Could not write snapshot \"" 
+            << snapshot::SidecarPath(filename) << "\"." << std::endl;
+    }
+
+    if (useIndex && !offsetindex::Write(*jsonSource, filename, options.indexThreshold))
+    {
+        std::cerr << "[WARNING] Could not write index \""
+            << offsetindex::SidecarPath(filename) << "\"." << std::endl;
+    }
+}
+
+// Container found by a scan of the trimmed string.
+struct ScannedContainer
+{
+    size_t begin = 0;       // Position of the opening parenthesis
+    size_t end = 0;         // One past the closing parenthesis, once it is found
+    bool isObject = false;
+    size_t keyBegin = 0;    // Objects: position of the key of the current member
+    size_t index = 0;       // Lists: number of the current element
+};
+
+// Find the containers enclosing the position, the root first. Their current members are the ones
+// that contain the position, and their ends are filled in as the rest of the string is scanned.
+static std::vector<ScannedContainer> FindEnclosing(const std::string& text, size_t position)
+{
+    std::vector<ScannedContainer> stack;
+    std::vector<ScannedContainer> enclosing;
+
+    bool escape = false;
+    bool inString = false;
+    size_t stringBegin = 0;
+
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (i == position) enclosing = stack;
+
+        const char c = text[i];
+        bool wasInString = inString;
+        isInString(c, escape, inString);
+
+        if (!wasInString && inString) stringBegin = i;
+        if (wasInString || inString) continue;
+
+        switch (c)
+        {
+        case '{':
+        case '[':
+            stack.push_back(ScannedContainer());
+            stack.back().begin = i;
+            stack.back().isObject = (c == '{');
+            break;
+        case '}':
+        case ']':
+            if (stack.empty()) return enclosing;
+
+            // The first container closed at a depth after the position is the enclosing one
+            if (stack.size() <= enclosing.size() && enclosing[stack.size() - 1].end == 0)
+            {
+                enclosing[stack.size() - 1].end = i + 1;
+            }
+            stack.pop_back();
+            break;
+        case ':':
+            if (!stack.empty()) stack.back().keyBegin = stringBegin;
+            break;
+        case ',':
+            if (!stack.empty()) stack.back().index++;
+            break;
+        }
+    }
+    return enclosing;
+}
+
+// Check that the parenthesis at begin is closed exactly at end - 1.
+static bool IsBalanced(const std::string& text, size_t begin, size_t end)
+{
+    bool escape = false;
+    bool inString = false;
+    size_t depth = 0;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const char c = text[i];
+        isInString(c, escape, inString);
+        if (inString || c == '"') continue;
+
+        if (c == '{' || c == '[') depth++;
+        if (c == '}' || c == ']')
+        {
+            depth--;
+            if (depth == 0) return i == end - 1;
+        }
+    }
+    return false;
+}
+
+// Decode the value of a literal, if it is not decoded yet.
+static void DecodeLiteral(JSON::JSONNode* node)
+{
+    switch (node->GetType())
+    {
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING:
+        ((JSON::JSONLiteral<std::string>*)node)->GetValue();
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT:
+        ((JSON::JSONLiteral<int>*)node)->GetValue();
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_DOUBLE:
+        ((JSON::JSONLiteral<double>*)node)->GetValue();
+        break;
+    default:
+        break;
+    }
+}
+
+// Move the spans of the nodes, other than the replaced one, to the new version of the file,
+// and decode their literals, whose text goes away with the old version. The trimmed texts of
+// the versions only differ in [begin, end) of the old one, which is replaced by [begin, end + delta) of the new one.
+static void MoveToNewSource(JSON::JSONNode* root, const JSON::JSONNode* replaced, JSONSource& oldSource,
+    JSONSource& newSource, size_t end, ptrdiff_t delta)
+{
+    auto move = [&](size_t offset)
+    {
+        size_t pos = oldSource.GetTrimmedPos(offset);
+        return newSource.GetFileOffset(pos >= end ? pos + delta : pos);
+    };
+
+    for (JSON::JSONTreeIterator it(root); !it.AtEnd(); ++it)
+    {
+        JSON::JSONNode* node = *it;
+        if (node == replaced)
+        {
+            it.SkipChildren();
+            continue;
+        }
+
+        if (node->HasSpan()) node->SetSpan(move(node->GetSpanBegin()), move(node->GetSpanEnd() - 1) + 1);
+        DecodeLiteral(node);
+    }
+}
+
+bool JSON::Update(JSONPath& changed)
+{
+    // Errors in the new version are thrown, so that the tree is kept
+    std::unique_ptr<JSONSource> newSource = std::make_unique<JSONSource>(jsonSource->GetFilename(), nullptr, false, jsonSource->GetPolicy());
+    CheckTrimmed(newSource->GetString());
+
+    const std::string& oldText = jsonSource->GetTrimmed();
+    const std::string& newText = newSource->GetTrimmed();
+    if (oldText == newText) return false;
+
+    // Changes are between the common prefix and the common suffix
+    size_t limit = std::min(oldText.size(), newText.size());
+    size_t prefix = std::mismatch(oldText.begin(), oldText.begin() + limit, newText.begin()).first - oldText.begin();
+    size_t suffix = 0;
+    while (suffix < limit - prefix && oldText[oldText.size() - 1 - suffix] == newText[newText.size() - 1 - suffix])
+    {
+        suffix++;
+    }
+
+    // The smallest container with both parentheses outside of the changes. Its opening
+    // parenthesis is before the prefix end, as it encloses that position.
+    std::vector<ScannedContainer> enclosing = FindEnclosing(oldText, prefix);
+    size_t depth = enclosing.size();
+    while (depth > 0 && (enclosing[depth - 1].end == 0 || enclosing[depth - 1].end - 1 < oldText.size() - suffix))
+    {
+        depth--;
+    }
+
+    JSONPath path;
+    for (size_t i = 0; i + 1 < depth; i++)
+    {
+        JSONPathStep step;
+        if (enclosing[i].isObject)
+        {
+            JSONString key = jsonSource->GetString().substr(enclosing[i].keyBegin);
+            size_t pos = 0;
+            step.identifier = key.ScanString(pos);
+        }
+        else
+        {
+            step.isIndex = true;
+            step.index = enclosing[i].index;
+        }
+        path.push_back(step);
+    }
+
+    size_t resolved = 0;
+    JSONNode* oldNode = path.empty() ? nullptr : FindPath(path, resolved);
+
+    // A projected tree has no nodes for most of the file, so it is always built again along the same paths
+    if (!projection && oldNode && resolved == path.size())
+    {
+        size_t begin = enclosing[depth - 1].begin;
+        size_t end = enclosing[depth - 1].end + newText.size() - oldText.size();
+
+        // Changes may also move the parentheses of the container, in which case the whole file is parsed
+        if (IsBalanced(newText, begin, end))
+        {
+            JSONNode* parent = oldNode->GetParent();
+            JSONNode* newNode = resolve_json(newSource->GetString().substr(begin, end - begin), parent);
+
+            if (path.back().isIndex) ((JSONList*)parent)->Replace(path.back().index, newNode);
+            else ((JSONObject*)parent)->Replace(path.back().identifier, newNode);
+            delete oldNode;
+            EnablePathIndex(pathIndexEnabled);
+
+            // Whitespace of the file may have changed anywhere, so the rest of the tree is moved as well
+            MoveToNewSource(globalSpace, newNode, *jsonSource, *newSource, enclosing[depth - 1].end,
+                (ptrdiff_t)newText.size() - (ptrdiff_t)oldText.size());
+
+            delete jsonSource;
+            jsonSource = newSource.release();
+            changed = path;
+            return true;
+        }
+    }
+
+    // Changes reach the root object
+    JSONString source = newSource->GetString();
+    CheckRoot(source);
+    JSONObject* root = projection ? projection::Parse(*newSource, *projection) : (JSONObject*)resolve_json(source, nullptr);
+
+    delete globalSpace;
+    globalSpace = root;
+    EnablePathIndex(pathIndexEnabled);
+    delete jsonSource;
+    jsonSource = newSource.release();
+    changed.clear();
+    return true;
+}
+
+void JSON::EnablePathIndex(bool enable)
+{
+    std::lock_guard<std::mutex> lock(pathIndexMutex);
+
+    // Also drops an index of the previous tree
+    publishedPathIndex.store(nullptr, std::memory_order_release);
+    pathIndexEnabled.store(enable, std::memory_order_release);
+    pathIndex.reset();
+}
+
+JSONPathIndex* JSON::GetPathIndex()
+{
+    // Once built, the index is read without the lock
+    if (JSONPathIndex* index = publishedPathIndex.load(std::memory_order_acquire)) return index;
+    if (!pathIndexEnabled.load(std::memory_order_acquire)) return nullptr;
+
+    std::lock_guard<std::mutex> lock(pathIndexMutex);
+    if (!pathIndexEnabled.load(std::memory_order_relaxed)) return nullptr;
+
+    if (!pathIndex)
+    {
+        pathIndex = std::make_unique<JSONPathIndex>(globalSpace);
+        publishedPathIndex.store(pathIndex.get(), std::memory_order_release);
+    }
+    return pathIndex.get();
+}
+
+bool JSON::Publish(const std::string& name)
+{
+    return snapshot::Publish(globalSpace, name);
+}
+
+// Forget the spans of a node and its children, and decode their literals,
+// as both refer to a text that goes away.
+static void DetachFromSource(JSON::JSONNode* root)
+{
+    for (JSON::JSONTreeIterator it(root); !it.AtEnd(); ++it)
+    {
+        (*it)->SetSpan(0, 0);
+        DecodeLiteral(*it);
+    }
+}
+
+void JSON::DecodeLiterals(JSONNode* root)
+{
+    for (JSONTreeIterator it(root); !it.AtEnd(); ++it) DecodeLiteral(*it);
+}
+
+JSON::JSONNode* JSON::ParseValue(const std::string& text)
+{
+    JSONSource source("value", text, 0, false);
+    JSONString body = source.GetString();
+    if (body.Size() == 0) throw JSONLoadError("[ERROR] Expected a value.");
+    CheckTrimmed(body);
+
+    JSONNode* node = resolve_json(body, nullptr);
+    DetachFromSource(node);
+    return node;
+}
+
+std::string_view JSON::GetSourceBytes() const
+{
+    if (jsonSource) return jsonSource->GetText();
+    if (loader) return loader->GetSourceBytes();
+    return {};
+}
+
+JSON::JSONContainer* JSON::FindEditParent(const JSONPath& path)
+{
+    if (path.empty()) return nullptr;
+
+    JSONPath parentPath(path.begin(), path.end() - 1);
+    size_t resolved = 0;
+    JSONNode* parent = FindPath(parentPath, resolved);
+    if (resolved != parentPath.size()) return nullptr;
+
+    JSON_NODE_TYPE expected = path.back().isIndex ? JSON_NODE_TYPE::JSON_NODE_TYPE_LIST : JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT;
+    if (parent->GetType() != expected) return nullptr;
+
+    // Loaders must not bring back the children taken out later
+    JSONContainer* container = (JSONContainer*)parent;
+    container->Expand();
+    return container;
+}
+
+void JSON::Record(const Edit& edit, JSONContainer* parent)
+{
+    // Edits undone before are not made again after another one
+    for (size_t i = version; i < history.size(); i++) delete history[i].detached;
+    history.resize(version);
+
+    parent->MarkDirty();
+    history.push_back(edit);
+    version++;
+}
+
+void JSON::UnindexChildren(JSONContainer* parent, const JSONPathStep& step)
+{
+    if (JSONPathIndex* index = publishedPathIndex.load(std::memory_order_acquire)) index->RemoveChildren(parent, step);
+}
+
+void JSON::IndexChildren(JSONContainer* parent, const JSONPathStep& step)
+{
+    if (JSONPathIndex* index = publishedPathIndex.load(std::memory_order_acquire)) index->AddChildren(parent, step);
+}
+
+bool JSON::Set(const JSONPath& path, JSONNode* node)
+{
+    JSONContainer* parent = FindEditParent(path);
+    const JSONPathStep& step = path.empty() ? JSONPathStep() : path.back();
+
+    if (!parent || (step.isIndex && step.index > ((JSONList*)parent)->Size()))
+    {
+        delete node;
+        return false;
+    }
+    node->SetParent(parent);
+    UnindexChildren(parent, step);
+
+    Edit edit = { JSON_EDIT::JSON_EDIT_REPLACE, path };
+    if (step.isIndex)
+    {
+        JSONList* list = (JSONList*)parent;
+        if (step.index < list->Size()) edit.detached = list->Replace(step.index, node);
+        else list->Append(node);
+    }
+    else
+    {
+        JSONObject* object = (JSONObject*)parent;
+        if (object->FindLoaded(step.identifier)) edit.detached = object->Replace(step.identifier, node);
+        else
+        {
+            edit.slot = object->GetShape()->Size();
+            object->Insert(step.identifier, node);
+        }
+
+        // The new member is written where the old one was
+        if (edit.detached && !node->HasSpan()) node->SetSpan(edit.detached->GetSpanBegin(), 0);
+    }
+
+    if (!edit.detached) edit.kind = JSON_EDIT::JSON_EDIT_ADD;
+    IndexChildren(parent, step);
+    Record(edit, parent);
+    return true;
+}
+
+bool JSON::Insert(const JSONPath& path, JSONNode* node)
+{
+    JSONContainer* parent = FindEditParent(path);
+    const JSONPathStep& step = path.empty() ? JSONPathStep() : path.back();
+
+    bool valid = parent && (step.isIndex ? step.index <= ((JSONList*)parent)->Size()
+        : !((JSONObject*)parent)->FindLoaded(step.identifier));
+    if (!valid)
+    {
+        delete node;
+        return false;
+    }
+    node->SetParent(parent);
+    UnindexChildren(parent, step);
+
+    Edit edit = { JSON_EDIT::JSON_EDIT_ADD, path };
+    if (step.isIndex) ((JSONList*)parent)->Insert(step.index, node);
+    else
+    {
+        JSONObject* object = (JSONObject*)parent;
+        edit.slot = object->GetShape()->Size();
+        object->Insert(step.identifier, node);
+    }
+
+    IndexChildren(parent, step);
+    Record(edit, parent);
+    return true;
+}
+
+bool JSON::Remove(const JSONPath& path)
+{
+    JSONContainer* parent = FindEditParent(path);
+    if (!parent) return false;
+
+    const JSONPathStep& step = path.back();
+    Edit edit = { JSON_EDIT::JSON_EDIT_REMOVE, path };
+
+    if (step.isIndex)
+    {
+        JSONList* list = (JSONList*)parent;
+        if (step.index >= list->Size()) return false;
+        UnindexChildren(parent, step);
+        edit.detached = list->Erase(step.index);
+    }
+    else
+    {
+        JSONObject* object = (JSONObject*)parent;
+        int64_t slot = object->GetShape()->SlotOf(step.identifier);
+        if (slot < 0) return false;
+        edit.slot = (uint32_t)slot;
+        UnindexChildren(parent, step);
+        edit.detached = object->Erase(step.identifier);
+    }
+
+    IndexChildren(parent, step);
+    Record(edit, parent);
+    return true;
+}
+
+void JSON::Apply(Edit& edit, bool undo)
+{
+    // Edits are made in order and undone in reverse, so the parent of each one exists by then
+    JSONContainer* parent = FindEditParent(edit.path);
+    const JSONPathStep& step = edit.path.back();
+    JSONList* list = step.isIndex ? (JSONList*)parent : nullptr;
+    JSONObject* object = step.isIndex ? nullptr : (JSONObject*)parent;
+    parent->MarkDirty();
+    UnindexChildren(parent, step);
+
+    // Adding a node undoes removing it, and the other way round
+    bool adds = (edit.kind == JSON_EDIT::JSON_EDIT_ADD) != undo;
+    switch (edit.kind)
+    {
+    case JSON_EDIT::JSON_EDIT_REPLACE:
+        edit.detached = step.isIndex ? list->Replace(step.index, edit.detached) : object->Replace(step.identifier, edit.detached);
+        break;
+    default:
+        if (adds)
+        {
+            // Members come back at their slot, so the keys keep their order
+            if (step.isIndex) list->Insert(step.index, edit.detached);
+            else object->Insert(step.identifier, edit.detached, edit.slot);
+            edit.detached = nullptr;
+        }
+        else edit.detached = step.isIndex ? list->Erase(step.index) : object->Erase(step.identifier);
+        break;
+    }
+    IndexChildren(parent, step);
+}
+
+void JSON::GoTo(size_t version)
+{
+    version = std::min(version, history.size());
+    while (this->version > version) Apply(history[--this->version], true);
+    while (this->version < version) Apply(history[this->version++], false);
+}
+
+void JSON::Revert(size_t version)
+{
+    GoTo(std::min(version, this->version));
+
+    for (size_t i = this->version; i < history.size(); i++) delete history[i].detached;
+    history.resize(this->version);
+}
+
+std::vector<JSONPath> JSON::ChangesSince(size_t version) const
+{
+    std::vector<JSONPath> paths;
+    size_t from = std::min(version, this->version);
+    size_t to = std::min(std::max(version, this->version), history.size());
+    for (size_t i = from; i < to; i++) paths.push_back(history[i].path);
+    return paths;
+}
+
+JSON::~JSON()
+{
+    // Nodes are deleted before the loader, which may still own their underlying data.
+    if (loader) loader->Cancel();
+    if (globalSpace) delete globalSpace;
+    globalSpace = nullptr;
+
+    for (const Edit& edit : history) delete edit.detached;
+
+    if (jsonSource) delete jsonSource;
+    jsonSource = nullptr;
+}
+
+void JSON::JSONContainer::Expand()
+{
+    if (IsExpanded()) return;
+
+    std::call_once(expanded, [this]()
+    {
+        loader->Expand(this, loaderRef);
+    });
+    complete.store(true, std::memory_order_release);
+}
+
+void JSON::JSONContainer::DeleteContents()
+{
+    const std::vector<JSONNode*>& children = GetType() == JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT
+        ? ((JSONObject*)this)->slots : ((JSONList*)this)->elements;
+    if (children.empty()) return;
+
+    // Nodes are deleted after their children, and containers are emptied first, so that their
+    // destructors have nothing left to delete. The walk moves on before the node is deleted.
+    JSONTreeIterator it(this, JSON_TREE_ORDER::JSON_TREE_ORDER_POST, UINT32_MAX, false);
+    while (*it != this)
+    {
+        JSONNode* node = *it;
+        ++it;
+
+        if (node->GetType() == JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT) ((JSONObject*)node)->slots.clear();
+        else if (node->GetType() == JSON_NODE_TYPE::JSON_NODE_TYPE_LIST) ((JSONList*)node)->elements.clear();
+        delete node;
+    }
+}
+
+JSON::JSONNode* JSON::JSONObject::Find(const std::string& identifier)
+{
+    return IsExpanded() ? FindLoaded(identifier) 
+        : loader->FindMember(this, loaderRef, identifier);
+}
+
+JSON::JSONShape::JSONShape(const JSONShape* parent, const std::string& key) 
+    : parent(parent), key(key), size(parent->size + 1)
+{
+    static std::atomic<uint32_t> lastId = 1;
+    id = ++lastId;
+}
+
+JSON::JSONShape::JSONShape(const JSONShape& other) : size(other.size)
+{
+    for (uint32_t slot = 0; slot < other.size; slot++)
+    {
+        auto added = index.emplace(other.KeyAt(slot), slot).first;
+        keys.push_back(&added->first);
+    }
+}
+
+const JSON::JSONShape* JSON::JSONShape::Empty()
+{
+    static JSONShape empty(true);
+    return &empty;
+}
+
+void JSON::JSONShape::BuildIndex() const
+{
+    keys.resize(size);
+    for (const JSONShape* shape = this; shape->parent; shape = shape->parent)
+    {
+        keys[shape->size - 1] = &shape->key;
+        index.emplace(shape->key, shape->size - 1);
+    }
+}
+
+const JSON::JSONShape* JSON::JSONShape::Add(const std::string& key, bool& taken) const
+{
+    taken = false;
+    {
+        std::shared_lock lock(transitionsMutex);
+        auto transition = transitions.find(key);
+        if (transition != transitions.end())
+        {
+            taken = !transition->second;
+            return transition->second.get();
+        }
+    }
+
+    std::unique_lock lock(transitionsMutex);
+    auto transition = transitions.find(key);
+    if (transition != transitions.end())
+    {
+        taken = !transition->second;
+        return transition->second.get();
+    }
+    if (size >= MaxSize || transitions.size() >= MaxTransitions) return nullptr;
+
+    for (const JSONShape* shape = this; shape->parent; shape = shape->parent)
+    {
+        if (shape->key == key)
+        {
+            transitions.emplace(key, nullptr);
+            taken = true;
+            return nullptr;
+        }
+    }
+
+    JSONShape* shape = new JSONShape(this, key);
+    transitions.emplace(key, std::unique_ptr<JSONShape>(shape));
+    return shape;
+}
+
+int64_t JSON::JSONShape::SlotOf(const std::string& key) const
+{
+    if (IsShared()) std::call_once(indexed, [this]() { BuildIndex(); });
+
+    auto slot = index.find(key);
+    return slot == index.end() ? -1 : (int64_t)slot->second;
+}
+
+const std::string& JSON::JSONShape::KeyAt(uint32_t slot) const
+{
+    if (IsShared()) std::call_once(indexed, [this]() { BuildIndex(); });
+    return *keys[slot];
+}
+
+bool JSON::JSONShape::Append(const std::string& key)
+{
+    auto added = index.emplace(key, size);
+    if (!added.second) return false;
+
+    keys.push_back(&added.first->first);
+    size++;
+    return true;
+}
+
+bool JSON::JSONShape::Insert(uint32_t slot, const std::string& key)
+{
+    auto added = index.emplace(key, slot);
+    if (!added.second) return false;
+
+    keys.insert(keys.begin() + slot, &added.first->first);
+    size++;
+    for (uint32_t later = slot + 1; later < size; later++) index[*keys[later]] = later;
+    return true;
+}
+
+void JSON::JSONShape::Remove(uint32_t slot)
+{
+    index.erase(*keys[slot]);
+    keys.erase(keys.begin() + slot);
+    size--;
+    for (uint32_t later = slot; later < size; later++) index[*keys[later]] = later;
+}
+
+void JSON::JSONObject::MakeOwnShape()
+{
+    ownShape = std::make_unique<JSONShape>(*shape);
+    shape = ownShape.get();
+}
+
+JSON::JSONNode* JSON::JSONObject::FindLoaded(const std::string& identifier, JSONMemberCache& cache) const
+{
+    uint64_t entry = cache.entry.load(std::memory_order_relaxed);
+    if (shape->IsShared() && entry >> 32 == shape->Id()) return slots[(uint32_t)entry];
+
+    int64_t slot = shape->SlotOf(identifier);
+    if (slot < 0) return nullptr;
+
+    if (shape->IsShared()) cache.entry.store((uint64_t)shape->Id() << 32 | (uint64_t)slot, std::memory_order_relaxed);
+    return slots[slot];
+}
+
+bool JSON::JSONObject::Insert(const std::string& identifier, JSONNode* node)
+{
+    if (!ownShape)
+    {
+        bool taken = false;
+        const JSONShape* next = shape->Add(identifier, taken);
+        if (taken) return false;
+        if (next)
+        {
+            shape = next;
+            slots.push_back(node);
+            return true;
+        }
+        MakeOwnShape();
+    }
+
+    if (!ownShape->Append(identifier)) return false;
+    slots.push_back(node);
+    return true;
 }
 
-// Given JSONString, the function looks for a comma outside a string literal.
-// If found, returns a substring without the comma and _Pos of the comma.
-// If no comma found, returns this string and _Pos one symbol after.
-JSONString JSONString::ScanLiteral(size_t& _Pos)
+bool JSON::JSONObject::Insert(const std::string& identifier, JSONNode* node, uint32_t slot)
 {
-    bool escape = false;
-    bool inString = false;
+    if (slot >= slots.size()) return Insert(identifier, node);
+    if (shape->SlotOf(identifier) >= 0) return false;
 
-    // Scan till the first comma outside a string
-    size_t i;
-    for (i = 0; i < size; i++)
+    if (!ownShape)
     {
-        const char c = at(i);
-        isInString(c, escape, inString);
+        // The keys are added again from the empty shape, in their new order
+        const JSONShape* reordered = JSONShape::Empty();
+        for (uint32_t i = 0; i < shape->Size() && reordered; i++)
+        {
+            bool taken = false;
+            if (i == slot) reordered = reordered->Add(identifier, taken);
+            if (reordered) reordered = reordered->Add(shape->KeyAt(i), taken);
+        }
 
-        if (c == ',' && !inString)
+        if (reordered)
         {
-            // When substr(_Pos) is called afterwards,
-            // the comma is preserved for parser to perform further reasoning.
-            // substr(0, i), on the other hand, does not include that comma.
-            _Pos = i;
-            return substr(0, i);
+            shape = reordered;
+            slots.insert(slots.begin() + slot, node);
+            return true;
         }
+        MakeOwnShape();
     }
 
-    // Here, if no comma was detected, we return _Pos = size.
-    // That is, whole string is returned, and no substring can be
-    // found using _Pos, because it is the first element after the string end.
-    _Pos = i;
-    return substr(0, i);
+    ownShape->Insert(slot, identifier);
+    slots.insert(slots.begin() + slot, node);
+    return true;
 }
 
-// Entry point to creating a JSON object.
-// Performs some assertions and builds recursively the JSON syntax tree.
-JSON::JSON(const std::string& filename)
+JSON::JSONNode* JSON::JSONObject::Erase(const std::string& identifier)
 {
-    jsonSource = new JSONSource(filename);
-    JSONString source = jsonSource->GetString();
+    int64_t slot = shape->SlotOf(identifier);
+    if (slot < 0) throw std::out_of_range(identifier);
 
-    // Check for empty input
-    if (source.Size() == 0)
+    JSONNode* old = slots[slot];
+    slots.erase(slots.begin() + slot);
+    if (ownShape)
     {
-        std::string errorMsg = "JSON file does not exist or is empty.";
-        source.PrintSyntaxMsg(errorMsg, SYNTAX_MSG_TYPE_ERROR);
+        ownShape->Remove((uint32_t)slot);
+        return old;
+    }
 
-        return;
+    // The remaining keys are added again from the empty shape
+    const JSONShape* remaining = JSONShape::Empty();
+    for (uint32_t i = 0; i < shape->Size() && remaining; i++)
+    {
+        bool taken = false;
+        if (i != (uint32_t)slot) remaining = remaining->Add(shape->KeyAt(i), taken);
     }
 
-    // Check first important condition - global space must be an object.
-    if (!utilstr::BeginsAndEndsWith(source, '{', '}'))
+    if (remaining) shape = remaining;
+    else
     {
-        std::string errorMsg = "JSON file does not contain an object. ";
-        errorMsg += "Correct format of the file would be: \"{..}\". ";
-        errorMsg += "Empty JSON object returned.";
-        source.PrintSyntaxMsg(errorMsg);
+        MakeOwnShape();
+        ownShape->Remove((uint32_t)slot);
+    }
+    return old;
+}
+
+JSON::JSONNode* JSON::JSONList::Find(size_t index)
+{
+    return IsExpanded() ? FindLoaded(index) 
+        : loader->FindElement(this, loaderRef, index);
+}
+
+JSON::JSONTreeIterator::JSONTreeIterator(JSONNode* root, JSON_TREE_ORDER order, unsigned int maxDepth, bool expands)
+    : node(root),
+    entries(order != JSON_TREE_ORDER::JSON_TREE_ORDER_POST),
+    exits(order != JSON_TREE_ORDER::JSON_TREE_ORDER_PRE),
+    maxDepth(maxDepth),
+    expands(expands)
+{
+    if (root && !entries && isContainer(root->GetType())) ++*this;
+}
+
+const std::string* JSON::JSONTreeIterator::Key() const
+{
+    if (stack.empty() || stack.back().container->GetType() != JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT) return nullptr;
+    return &((JSONObject*)stack.back().container)->shape->KeyAt((uint32_t)index);
+}
+
+void JSON::JSONTreeIterator::Step()
+{
+    // A container visited before its children is entered, unless it is left out
+    if (!exit && isContainer(node->GetType()))
+    {
+        bool enters = !skip && stack.size() <= maxDepth;
+        skip = false;
+        if (!enters)
+        {
+            exit = true;
+            return;
+        }
+
+        JSONContainer* container = (JSONContainer*)node;
+        if (expands) container->Expand();
+        const std::vector<JSONNode*>& children = node->GetType() == JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT
+            ? ((JSONObject*)node)->slots : ((JSONList*)node)->elements;
+        stack.push_back({ container, &children, index, 0 });
+    }
 
+    if (stack.empty())
+    {
+        node = nullptr;
         return;
     }
 
-    // Here, by the condition above, we are certain that the global space
-    // is in fact a JSON object.
-    globalSpace = static_cast<JSONObject*>(resolve_json(source, globalSpace));
+    // Next child of the innermost container, or the container itself once it has none left.
+    // Children not loaded yet are empty, and skipped.
+    Frame& top = stack.back();
+    const std::vector<JSONNode*>& children = *top.children;
+    while (top.next < children.size())
+    {
+        index = top.next++;
+        if (children[index])
+        {
+            node = children[index];
+            exit = false;
+            return;
+        }
+    }
+
+    node = top.container;
+    index = top.index;
+    exit = true;
+    stack.pop_back();
+}
+
+JSON::JSONTreeIterator& JSON::JSONTreeIterator::operator++()
+{
+    do Step();
+    while (node && (exit ? !exits : !entries && isContainer(node->GetType())));
+    return *this;
 }
 
 // Forward declarations for functions used in resolve_json(..)
@@ -369,19 +1722,35 @@ inline JSON::JSONNode* resolve_number(JSONString body, JSON::JSONNode* parent);
 // Builds on the structure of JSONSource and JSONString.
 JSON::JSONNode* resolve_json(JSONString body, JSON::JSONNode* parent)
 {	
+    JSON::JSONNode* node;
+
     // A JSON object
     if (utilstr::BeginsAndEndsWith(body, '{', '}'))
     {
-        return resolve_object(body, parent);
+        node = resolve_object(body, parent);
     }
 
     // A JSON list
     else if (utilstr::BeginsAndEndsWith(body, '[', ']'))
     {
-        return resolve_list(body, parent);
+        node = resolve_list(body, parent);
+    }
+    else
+    {
+        node = resolve_literal(body, parent);
     }
 
-    return resolve_literal(body, parent);
+    if (node) set_span(node, body);
+    return node;
+}
+
+// Spans are kept in file offsets, as parts of a file may be parsed from sources of their own.
+void set_span(JSON::JSONNode* node, JSONString body)
+{
+    if (body.Size() == 0) return;
+
+    JSONSource* source = body.GetSource();
+    node->SetSpan(source->GetFileOffset(body.GetOffset()), source->GetFileOffset(body.GetOffset() + body.Size() - 1) + 1);
 }
 
 // Recursively resolve members of an object.
@@ -391,14 +1760,31 @@ inline JSON::JSONNode* resolve_object(JSONString body, JSON::JSONNode* parent)
     JSON::JSONObject* object = new JSON::JSONObject(parent);
     body = body.substr(1, body.Size() - 2);
 
-    if (body.Size() == 0)
+    // Members resolved so far are deleted along with the object, as is the object on an empty body.
+    try
+    {
+        if (body.Size() == 0)
+        {
+            body.PrintSyntaxMsg("Expected an expression.");
+        }
+        resolve_members(body, object);
+    }
+    catch (...)
     {
-        body.PrintSyntaxMsg("Expected an expression.");
+        delete object;
+        throw;
     }
+    return object;
+}
 
+// Resolve comma-separated "id": value pairs, and insert them into the object.
+void resolve_members(JSONString body, JSON::JSONObject* object, const ValueResolver& resolve)
+{
     // Iterate through "id": value pairs
     do
     {
+        body.GetSource()->ReportProgress(body.GetOffset());
+
         // Pair to store member
         std::pair<std::string, JSON::JSONNode*> member;
 
@@ -408,15 +1794,19 @@ inline JSON::JSONNode* resolve_object(JSONString body, JSON::JSONNode* parent)
         if (id.size() < 1)
         {
             body.PrintSyntaxMsg("Expected valid identifier.");
-            return nullptr;
+            return;
         }
 
-        // Check for uniqueness
-        if (object->members.find(id) != object->members.end())
+        // Check for uniqueness. The object may be in the middle of expansion,
+        // so only members that are already present are checked.
+        // The member is added now, and its value is filled in once resolved.
+        // Policies may let a repeated identifier replace the earlier member instead.
+        bool duplicate = !object->Insert(id, nullptr);
+        if (duplicate && !KeepsLastDuplicate(body.GetSource()->GetPolicy()))
         {
             // There already exists an object with such id.
             body.PrintSyntaxMsg("Identifier is not unique.");
-            return nullptr;
+            return;
         }
 
         // If the identifier is valid, write it
@@ -427,7 +1817,7 @@ inline JSON::JSONNode* resolve_object(JSONString body, JSON::JSONNode* parent)
         if (body.front() != ':')
         {
             body.PrintSyntaxMsg("Expected ':'.");
-            return nullptr;
+            return;
         }
 
         // Trim the ':'
@@ -439,15 +1829,16 @@ inline JSON::JSONNode* resolve_object(JSONString body, JSON::JSONNode* parent)
         if (body.front() == '{' || body.front() == '[')
         {
             JSONString objectListBody = body.ScanListObjectBody(pos);
-            member.second = resolve_json(objectListBody, object);
+            member.second = resolve(objectListBody, object);
         }
         else    // Some literal
         {
             JSONString literalBody = body.ScanLiteral(pos);
-            member.second = resolve_json(literalBody, object);
+            member.second = resolve(literalBody, object);
         }
 
-        object->members.insert(member);
+        if (duplicate) delete object->Replace(member.first, member.second);
+        else object->LastMember() = member.second;
 
         // Remove contents from the string.
         body = body.substr(pos);
@@ -471,8 +1862,6 @@ inline JSON::JSONNode* resolve_object(JSONString body, JSON::JSONNode* parent)
         }
 
     } while (true);
-
-    return object;
 }
 
 // Resolve the contents of the list and recursively call
@@ -482,7 +1871,6 @@ inline JSON::JSONNode* resolve_list(JSONString body, JSON::JSONNode* parent)
     body = body.substr(1, body.Size() - 2);
 
     JSON::JSONList* list = new JSON::JSONList(parent);
-    size_t pos = 0;
 
     // Return an empty list
     if (body.Size() == 0)
@@ -490,18 +1878,45 @@ inline JSON::JSONNode* resolve_list(JSONString body, JSON::JSONNode* parent)
         return list;
     }
 
+    std::vector<JSON::JSONNode*> elements;
+    try
+    {
+        resolve_elements(body, list, elements);
+    }
+    catch (...)
+    {
+        for (JSON::JSONNode* element : elements) delete element;
+        delete list;
+        throw;
+    }
+
+    for (JSON::JSONNode* element : elements)
+    {
+        list->Append(element);
+    }
+    return list;
+}
+
+// Resolve comma-separated values, whose parent is given, and append them to elements.
+void resolve_elements(JSONString body, JSON::JSONNode* parent, std::vector<JSON::JSONNode*>& elements,
+    const ValueResolver& resolve)
+{
+    size_t pos = 0;
+
     // Read elements
     do
     {
+        body.GetSource()->ReportProgress(body.GetOffset());
+
         if (body.front() == '{' || body.front() == '[')
         {
             JSONString objectListBody = body.ScanListObjectBody(pos);
-            list->elements.push_back(resolve_json(objectListBody, list));
+            elements.push_back(resolve(objectListBody, parent));
         }
         else    // Some literal
         {
             JSONString literalBody = body.ScanLiteral(pos);
-            list->elements.push_back(resolve_json(literalBody, list));
+            elements.push_back(resolve(literalBody, parent));
         }
 
         // Remove everything before the current object
@@ -526,19 +1941,124 @@ inline JSON::JSONNode* resolve_list(JSONString body, JSON::JSONNode* parent)
         }
 
     } while (true);
-    return list;
+}
+
+// Whether the number can be decoded later: it is valid as read by utilstr::GetNumLiteralValue(..),
+// and its type is known from the text, which isDouble is. Integers with an exponent or of more than
+// 9 digits may be out of the range of int, and are read as double, so they are decoded at once.
+static bool IsDeferredNumber(std::string_view text, bool& isDouble)
+{
+    size_t digits[3] = { 0, 0, 0 };     // Whole part, fraction and exponent
+    int part = 0;
+    bool negativeExponent = false;
+
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        if (c >= '0' && c <= '9') digits[part]++;
+        else if ((c == '-' || c == '+') && i == 0) continue;
+        else if ((c == '-' || c == '+') && part == 2 && digits[2] == 0 && (text[i - 1] == 'e' || text[i - 1] == 'E'))
+        {
+            negativeExponent = c == '-';
+        }
+        else if (c == '.' && part == 0) part = 1;
+        else if ((c == 'e' || c == 'E') && part < 2) part = 2;
+        else return false;
+    }
+
+    bool fractional = text.find('.') != std::string_view::npos;
+    bool exponent = part == 2;
+    if (digits[0] == 0 || (fractional && digits[1] == 0) || (exponent && digits[2] == 0)) return false;
+    isDouble = fractional || negativeExponent;
+    return isDouble || (!exponent && digits[0] <= 9);
+}
+
+// Whether the number follows the grammar of RFC 8259: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool IsStrictNumber(std::string_view text)
+{
+    size_t i = 0;
+    auto digits = [&text, &i]()
+    {
+        size_t begin = i;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9') i++;
+        return i - begin;
+    };
+
+    if (i < text.size() && text[i] == '-') i++;
+    size_t whole = i;
+    if (digits() == 0 || (text[whole] == '0' && i - whole > 1)) return false;
+
+    if (i < text.size() && text[i] == '.')
+    {
+        i++;
+        if (digits() == 0) return false;
+    }
+
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E'))
+    {
+        i++;
+        if (i < text.size() && (text[i] == '+' || text[i] == '-')) i++;
+        if (digits() == 0) return false;
+    }
+    return i == text.size();
+}
+
+void decode_literal(std::string_view text, std::string& value)
+{
+    value.assign(text.data() + 1, text.size() - 2);
+}
+
+void decode_literal(std::string_view text, int& value)
+{
+    Either number;
+    utilstr::GetNumLiteralValue(std::string(text), number);
+    value = number.NumInt;
+}
+
+void decode_literal(std::string_view text, double& value)
+{
+    Either number;
+    utilstr::GetNumLiteralValue(std::string(text), number);
+    value = number.NumDouble;
+}
+
+void decode_literal(std::string_view text, bool& value)
+{
+    value = text == "true";
 }
 
 // If passed string is neither list nor object, it is dealt with as a literal.
 // Here, types bool and null are considered. For numerical, subfunction is called.
 inline JSON::JSONNode* resolve_literal(JSONString body, JSON::JSONNode* parent)
 {
-    // A string literal
+    std::string_view text = body.View();
+
+    // The type is told by the first character. Strings without escape sequences, and numbers
+    // that are checked to be valid, are decoded on first access.
+    if (text.size() >= 2 && text.size() <= UINT32_MAX && text.front() == '"'
+        && text.find_first_of("\\\"", 1) == text.size() - 1)
+    {
+        return new JSON::JSONLiteral<std::string>(JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING, text, parent);
+    }
+
+    bool isNumber = !text.empty() && (isdigit((unsigned char)text.front()) || text.front() == '-' || text.front() == '+');
+    if (isNumber && HasStrictNumbers(body.GetSource()->GetPolicy()) && !IsStrictNumber(text))
+    {
+        body.PrintSyntaxMsg("Invalid number.");
+    }
+
+    bool isDouble = false;
+    if (isNumber && IsDeferredNumber(text, isDouble))
+    {
+        if (isDouble) return new JSON::JSONLiteral<double>(JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_DOUBLE, text, parent);
+        return new JSON::JSONLiteral<int>(JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT, text, parent);
+    }
+
+    // A string literal with escape sequences, or an invalid one
     if (utilstr::BeginsAndEndsWith(body, '"'))
     {
         size_t pos = 0;
-        JSON::JSONLiteral<std::string>* literalPtr = new JSON::JSONLiteral<std::string>(
-            body.ScanString(pos), JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING, parent);
+        std::string value = body.ScanString(pos);
 
         // If there are any symbols after the string
         if (body.Size() > pos)
@@ -546,20 +2066,20 @@ inline JSON::JSONNode* resolve_literal(JSONString body, JSON::JSONNode* parent)
             body.PrintSyntaxMsg("Invalid characters after string literal.", SYNTAX_MSG_TYPE_ERROR, pos);
         }
 
-        return literalPtr;
+        return new JSON::JSONLiteral<std::string>(std::move(value), JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING, parent);
     }
 
-    if (body.ToString() == "true")
+    if (text == "true")
     {
         return new JSON::JSONLiteral<bool>(true, JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_BOOL, parent);
     }
 
-    if (body.ToString() == "false")
+    if (text == "false")
     {
         return new JSON::JSONLiteral<bool>(false, JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_BOOL, parent);
     }
 
-    if (body.ToString() == "null")
+    if (text == "null")
     {
         return new JSON::JSONNull(parent);
     }
@@ -588,9 +2108,22 @@ inline JSON::JSONNode* resolve_number(JSONString body, JSON::JSONNode* parent)
     }
 }
 
+// Streams of the threads that evaluate queries, if they are not std::cout
+static thread_local std::ostream* queryOutput = nullptr;
+
+std::ostream& QueryOutput()
+{
+    return queryOutput ? *queryOutput : std::cout;
+}
+
+void RedirectQueryOutput(std::ostream* output)
+{
+    queryOutput = output;
+}
+
 JSONInterface JSON::CreateInterface()
 {
-    return JSONInterface(globalSpace);
+    return JSONInterface(globalSpace, this);
 }
 
 // Relative to local object, find the node at this request
@@ -615,8 +2148,27 @@ std::string JSONInterface::Select(std::string request)
 
 JSON::JSONNode* JSONInterface::tree_walk(std::string request)
 {
+    // Paths of identifiers and numeric indices are looked up without walking the tree
+    JSONPathIndex* index = json ? json->GetPathIndex() : nullptr;
+    JSONPathHash path;
+    JSON::JSONNode* found = nullptr;
+    if (index && index->HashOf(currentObject, path) && JSONPathIndex::HashQuery(request, path)
+        && index->Find(path, found))
+    {
+        if (accessed) accessed->push_back(found);
+        return found;
+    }
+
     JSON::JSONNode* current = currentObject;
+    JSON::JSONNode* node = tree_walk(request, current);
+
+    // On failure, current is the last node reached
+    if (accessed) accessed->push_back(current);
+    return node;
+}
 
+JSON::JSONNode* JSONInterface::tree_walk(std::string request, JSON::JSONNode*& current)
+{
     size_t prevPos = 0;
     size_t pos = 0;
 
@@ -643,7 +2195,7 @@ JSON::JSONNode* JSONInterface::tree_walk(std::string request)
                     return nullptr;
                 if (indexNode->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT)
                 {
-                    std::cout << "[ERROR] Tried to access a list using non-numeric index." << std::endl;
+                    QueryOutput() << "[ERROR] Tried to access a list using non-numeric index." << std::endl;
                     return nullptr;
                 }
 
@@ -655,15 +2207,18 @@ JSON::JSONNode* JSONInterface::tree_walk(std::string request)
             // Here, index is known, retrieve next node
             if (current->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST)
             {
-                std::cout << "[ERROR] Tried to access a non-list element with an index." << std::endl;
+                QueryOutput() << "[ERROR] Tried to access a non-list element with an index." << std::endl;
                 return nullptr;
             }
 
             JSON::JSONList* list = (JSON::JSONList*)current;
-            if (!(current = list->Find(indexNum)))
+            JSON::JSONNode* element = list->Find(indexNum);
+            if (!element)
             {
+                QueryOutput() << "[ERROR] Tried to access an out-of-bound index." << std::endl;
                 return nullptr;
             }
+            current = element;
         }
 
         // If dot detected or at the start
@@ -678,22 +2233,24 @@ JSON::JSONNode* JSONInterface::tree_walk(std::string request)
             // Check if current node is an object
             if (current->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
             {
-                std::cout << "[ERROR] Tried to access a member \"" 
+                QueryOutput() << "[ERROR] Tried to access a member \"" 
                     << identifier << "\" of non-object element" << std::endl;
                 return nullptr;
             }
 
             JSON::JSONObject* obj = (JSON::JSONObject*)current;
-            
-            if (!(current = obj->Find(identifier)))
+            JSON::JSONNode* member = obj->Find(identifier);
+            if (!member)
             {
+                QueryOutput() << "[ERROR] Cannot find member \"" << identifier << "\" of the object." << std::endl;
                 return nullptr;
             }
+            current = member;
         }
 
         else
         {
-            std::cout << "Invalid situation." << std::endl;
+            QueryOutput() << "Invalid situation." << std::endl;
             return nullptr;
         }
     }
@@ -738,130 +2295,211 @@ std::string getLiteralValue(JSON::JSONNode* node)
     return result;
 }
 
-void JSON::JSONObject::ListMembers(bool showValues,
-    unsigned int depth, unsigned int maxDepth)
+// Print the members of the container as a table indented by its depth, each followed by the table
+// of its own members if it is a container and the depth of the table is below maxDepth.
+static void ListTree(JSON::JSONContainer* root, bool showValues, unsigned int depth, unsigned int maxDepth)
 {
-    ConsoleTable<2> table({ 2, 2 }, depth);
-    table.PrintSeparator(SeparatorChar);
+    // Containers at depths up to the limit, under the root, have their tables printed
+    const unsigned int limit = maxDepth > depth ? maxDepth - depth : 0;
 
-    for (std::pair<std::string, JSONNode*> member : members)
+    for (JSON::JSONTreeIterator it(root, JSON::JSON_TREE_ORDER::JSON_TREE_ORDER_BOTH, limit); !it.AtEnd(); ++it)
     {
-        JSON_NODE_TYPE type = member.second->GetType();
-
-        // Assemble first column
-        
-        std::string col1 = member.first;
-
-
-        std::string col2 = ": ";
-        col2 += ToString(type);
-
-        // Print data to console
-        table.PrintLine({ col1, col2 });
+        JSON::JSONNode* node = *it;
+        JSON::JSON_NODE_TYPE type = node->GetType();
+        bool listed = JSON::isContainer(type) && it.Depth() <= limit;
+        ConsoleTable<2> table({ 2, 2 }, depth + it.Depth());
 
-        // Print values
-
-        if (isLiteral(type) && showValues)
+        if (it.IsExit())
         {
-            table.PrintLine({ std::string("= ") + getLiteralValue(member.second), "" });
+            if (!listed) continue;
+            table.PrintSeparator(SeparatorChar);
+            if (node != root) std::cout << std::endl;
+            continue;
         }
-        
-        if (depth < maxDepth)
+
+        // Line of the node in the table of its container
+        if (node != root)
         {
-            if (type == JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
-            {
-                JSONObject* obj = (JSONObject*)member.second;
-                obj->ListMembers(showValues, depth + 1, maxDepth);
-                std::cout << std::endl;
-            }
+            ConsoleTable<2> parentTable({ 2, 2 }, depth + it.Depth() - 1);
 
-            if (type == JSON_NODE_TYPE::JSON_NODE_TYPE_LIST)
+            std::string col1 = it.Key() ? *it.Key() : "[" + std::to_string(it.Index()) + "]";
+            std::string col2 = ": ";
+            col2 += JSON::ToString(type);
+            parentTable.PrintLine({ col1, col2 });
+
+            if (JSON::isLiteral(type) && showValues)
             {
-                JSONList* list = (JSONList*)member.second;
-                list->ListMembers(showValues, depth + 1, maxDepth);
-                std::cout << std::endl;
+                parentTable.PrintLine({ std::string("= ") + getLiteralValue(node), "" });
             }
         }
+
+        if (listed) table.PrintSeparator(SeparatorChar);
     }
-    table.PrintSeparator(SeparatorChar);
+}
+
+void JSON::JSONObject::ListMembers(bool showValues,
+    unsigned int depth, unsigned int maxDepth)
+{
+    ListTree(this, showValues, depth, maxDepth);
 }
 
 void JSON::JSONList::ListMembers(bool showValues,
     unsigned int depth, unsigned int maxDepth)
 {
-    ConsoleTable<2> table({ 2, 2 }, depth);
-    table.PrintSeparator(SeparatorChar);
+    ListTree(this, showValues, depth, maxDepth);
+}
+
+void JSONInterface::Back(unsigned int steps)
+{
+    // Up to the steps-th object above, lists on the way are not counted, or up to the root
+    JSON::JSONNode* node = currentObject;
+    while (steps > 0 && node->GetParent())
+    {
+        node = node->GetParent();
+        if (node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT) steps--;
+    }
+    currentObject = (JSON::JSONObject*)node;
+}
+
+bool JSONInterface::Rebind(JSON& json, const JSONPath& path)
+{
+    size_t resolved = 0;
+    JSON::JSONNode* node = json.FindPath(path, resolved);
 
-    size_t index = 0;
-    for (JSONNode* element : elements)
+    // Only objects can be selected
+    while (node->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
     {
-        JSON_NODE_TYPE type = element->GetType();
+        node = node->GetParent();
+        resolved--;
+    }
 
-        // Assemble first column
+    currentObject = (JSON::JSONObject*)node;
+    this->json = &json;
+    return resolved == path.size();
+}
+
+bool JSONInterface::EvaluateIndex(const std::string& query, size_t& index)
+{
+    JSON::JSONNode* indexNode = tree_walk(query);
+    if (!indexNode) return false;
+
+    if (indexNode->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT)
+    {
+        QueryOutput() << "[ERROR] Tried to access a list using non-numeric index." << std::endl;
+        return false;
+    }
+    index = ((JSON::JSONLiteral<int>*)indexNode)->GetValue();
+    return true;
+}
 
-        std::string col1 = "[";
-        col1 += std::to_string(index);
-        col1 += "]";
+bool JSONInterface::ResolvePath(std::string query, JSONPath& path)
+{
+    utilstr::RemoveCharsOutsideString(query, " \t\n");
 
-        std::string col2 = ": ";
-        col2 += ToString(type);
+    // Steps are read as in patterns, without walking the tree, except for nested queries of indices
+    JSONPathPattern pattern;
+    bool valid = pattern.Parse(query, [this](const std::string& indexQuery, size_t& index)
+    {
+        return EvaluateIndex(indexQuery, index);
+    });
+    if (!valid) return false;
 
-        // Print data to console
-        table.PrintLine({ col1, col2 });
+    if (pattern.Steps().empty())
+    {
+        QueryOutput() << "[ERROR] Expected a path." << std::endl;
+        return false;
+    }
 
-        if (isLiteral(type) && showValues)
+    path = JSON::PathOf(currentObject);
+    for (const JSONPatternStep& step : pattern.Steps())
+    {
+        if (step.type == PATTERN_STEP::PATTERN_STEP_MEMBER) path.push_back({ false, step.identifier });
+        else if (step.type == PATTERN_STEP::PATTERN_STEP_INDEX) path.push_back({ true, "", step.index });
+        else
         {
-            table.PrintLine({ std::string("= ") + getLiteralValue(element), ""});
+            QueryOutput() << "[ERROR] Wildcards and filters cannot be used in paths of edits." << std::endl;
+            return false;
         }
+    }
+    return true;
+}
 
+JSONPath JSON::PathOf(JSONNode* node)
+{
+    JSONPath path;
 
-        if (depth < maxDepth)
+    for (JSONNode* parent = node->GetParent(); parent; node = parent, parent = parent->GetParent())
+    {
+        JSONPathStep step;
+        if (parent->GetType() == JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
         {
-            if (type == JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+            for (const auto& member : ((JSONObject*)parent)->Members())
             {
-                JSONObject* obj = (JSONObject*)element;
-                obj->ListMembers(showValues, depth + 1, maxDepth);
-                std::cout << std::endl;
-            }
-
-            if (type == JSON_NODE_TYPE::JSON_NODE_TYPE_LIST)
-            {
-                JSONList* list = (JSONList*)element;
-                list->ListMembers(showValues, depth + 1, maxDepth);
-                std::cout << std::endl;
+                if (member.second == node) step.identifier = member.first;
             }
         }
-        index++;
+        else
+        {
+            const std::vector<JSONNode*>& elements = ((JSONList*)parent)->Elements();
+            step.isIndex = true;
+            step.index = std::find(elements.begin(), elements.end(), node) - elements.begin();
+        }
+        path.push_back(step);
     }
-    table.PrintSeparator(SeparatorChar);
+
+    std::reverse(path.begin(), path.end());
+    return path;
 }
 
-// Can only return JSON objects
-JSON::JSONNode* recursive_back(JSON::JSONNode* ptr, unsigned int steps)
+std::string JSON::PathToString(const JSONPath& path)
 {
-    JSON::JSONNode* parent = ptr->GetParent();
+    if (path.empty()) return "~";
 
-    // Reached the root
-    if (!parent)
+    std::string result;
+    for (const JSONPathStep& step : path)
     {
-        return ptr;
-    }
+        if (step.isIndex)
+        {
+            result += "[" + std::to_string(step.index) + "]";
+            continue;
+        }
 
-    if (parent->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
-    {
-        steps--;
+        if (!result.empty()) result += ".";
+        result += step.identifier;
     }
+    return result;
+}
 
-    if (steps == 0)
-    {
-        return parent;
-    }
-    return recursive_back(parent, steps);
+bool JSON::PathsOverlap(const JSONPath& a, const JSONPath& b)
+{
+    size_t common = std::min(a.size(), b.size());
+    return std::equal(a.begin(), a.begin() + common, b.begin());
 }
 
-void JSONInterface::Back(unsigned int steps)
+JSON::JSONNode* JSON::FindPath(const JSONPath& path, size_t& resolved)
 {
-    currentObject = (JSON::JSONObject*)recursive_back(currentObject, steps);
+    JSONNode* node = globalSpace;
+
+    for (resolved = 0; resolved < path.size(); resolved++)
+    {
+        const JSONPathStep& step = path[resolved];
+        JSONNode* child = nullptr;
+
+        if (!step.isIndex && node->GetType() == JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+        {
+            JSONObject* object = (JSONObject*)node;
+            if (object->Contains(step.identifier)) child = object->Find(step.identifier);
+        }
+        if (step.isIndex && node->GetType() == JSON_NODE_TYPE::JSON_NODE_TYPE_LIST)
+        {
+            JSONList* list = (JSONList*)node;
+            if (step.index < list->Size()) child = list->Find(step.index);
+        }
+
+        if (!child) break;
+        node = child;
+    }
+    return node;
 }
 
 bool JSONInterface::GetValue(JSON::JSONNode* node, Either& value)
@@ -0,0 +1,277 @@
+//          json_patch.cpp
+//
+//  Provides application of JSON Patch documents to loaded trees.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "json_patch.h"
+
+#include <memory>
+#include <algorithm>
+#include <cctype>
+
+static JSON::JSONNode* CloneValue(JSON::JSONNode* node, JSON::JSONNode* parent);
+
+// Copy of the node and everything under it. Unedited copies keep the span of the original,
+// so that they are written out as they were read.
+static JSON::JSONNode* Clone(JSON::JSONNode* node, JSON::JSONNode* parent)
+{
+    JSON::JSONNode* copy = CloneValue(node, parent);
+    if (!node->IsDirty()) copy->SetSpan(node->GetSpanBegin(), node->GetSpanEnd());
+    return copy;
+}
+
+static JSON::JSONNode* CloneValue(JSON::JSONNode* node, JSON::JSONNode* parent)
+{
+    switch (node->GetType())
+    {
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT:
+    {
+        JSON::JSONObject* object = new JSON::JSONObject(parent);
+        for (const auto& member : ((JSON::JSONObject*)node)->Members())
+        {
+            object->Insert(member.first, Clone(member.second, object));
+        }
+        return object;
+    }
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST:
+    {
+        JSON::JSONList* list = new JSON::JSONList(parent);
+        for (JSON::JSONNode* element : ((JSON::JSONList*)node)->Elements())
+        {
+            list->Append(Clone(element, list));
+        }
+        return list;
+    }
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING:
+        return new JSON::JSONLiteral<std::string>(((JSON::JSONLiteral<std::string>*)node)->GetValue(), node->GetType(), parent);
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT:
+        return new JSON::JSONLiteral<int>(((JSON::JSONLiteral<int>*)node)->GetValue(), node->GetType(), parent);
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_DOUBLE:
+        return new JSON::JSONLiteral<double>(((JSON::JSONLiteral<double>*)node)->GetValue(), node->GetType(), parent);
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_BOOL:
+        return new JSON::JSONLiteral<bool>(((JSON::JSONLiteral<bool>*)node)->GetValue(), node->GetType(), parent);
+    default:
+        return new JSON::JSONNull(parent);
+    }
+}
+
+static double NumberOf(JSON::JSONNode* node)
+{
+    if (node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT) return ((JSON::JSONLiteral<int>*)node)->GetValue();
+    return ((JSON::JSONLiteral<double>*)node)->GetValue();
+}
+
+// Equality of values as defined for the test operation: numbers are compared by value,
+// and members of objects regardless of their order.
+static bool Equal(JSON::JSONNode* a, JSON::JSONNode* b)
+{
+    if (JSON::isNumericLiteral(a->GetType()) && JSON::isNumericLiteral(b->GetType())) return NumberOf(a) == NumberOf(b);
+    if (a->GetType() != b->GetType()) return false;
+
+    switch (a->GetType())
+    {
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT:
+    {
+        JSON::JSONObject* objectA = (JSON::JSONObject*)a;
+        JSON::JSONObject* objectB = (JSON::JSONObject*)b;
+        if (objectA->Size() != objectB->Size()) return false;
+
+        for (const auto& member : objectA->Members())
+        {
+            JSON::JSONNode* other = objectB->FindLoaded(member.first);
+            if (!other || !Equal(member.second, other)) return false;
+        }
+        return true;
+    }
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST:
+    {
+        const std::vector<JSON::JSONNode*>& elementsA = ((JSON::JSONList*)a)->Elements();
+        const std::vector<JSON::JSONNode*>& elementsB = ((JSON::JSONList*)b)->Elements();
+        return std::equal(elementsA.begin(), elementsA.end(), elementsB.begin(), elementsB.end(), Equal);
+    }
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING:
+        return ((JSON::JSONLiteral<std::string>*)a)->GetValue() == ((JSON::JSONLiteral<std::string>*)b)->GetValue();
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_BOOL:
+        return ((JSON::JSONLiteral<bool>*)a)->GetValue() == ((JSON::JSONLiteral<bool>*)b)->GetValue();
+    default:
+        return true;
+    }
+}
+
+// Node at the path, or nullptr if there is none.
+static JSON::JSONNode* Find(JSON& json, const JSONPath& path)
+{
+    size_t resolved = 0;
+    JSON::JSONNode* node = json.FindPath(path, resolved);
+    return resolved == path.size() ? node : nullptr;
+}
+
+// String member of an operation, or nullptr if there is none.
+static const std::string* StringMember(JSON::JSONObject* operation, const std::string& identifier)
+{
+    JSON::JSONNode* node = operation->Find(identifier);
+    if (!node || node->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING) return nullptr;
+    return &((JSON::JSONLiteral<std::string>*)node)->GetValue();
+}
+
+bool jsonpatch::ResolvePointer(JSON& json, const std::string& pointer, JSONPath& path, std::string& error)
+{
+    path.clear();
+    if (pointer.empty()) return true;
+
+    if (pointer[0] != '/')
+    {
+        error = "\"" + pointer + "\" is not a JSON Pointer.";
+        return false;
+    }
+
+    size_t resolved = 0;
+    JSON::JSONNode* node = json.FindPath({}, resolved);
+    size_t pos = 1;
+    while (true)
+    {
+        size_t end = std::min(pointer.find('/', pos), pointer.size());
+        std::string token = pointer.substr(pos, end - pos);
+
+        // "~1" stands for '/', and "~0" for '~'
+        for (size_t i = token.find('~'); i != std::string::npos; i = token.find('~', i + 1))
+        {
+            if (i + 1 < token.size() && (token[i + 1] == '0' || token[i + 1] == '1')) token.replace(i, 2, token[i + 1] == '0' ? "~" : "/");
+        }
+
+        if (!node)
+        {
+            error = "\"" + pointer + "\" does not exist.";
+            return false;
+        }
+
+        JSONPathStep step;
+        if (node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+        {
+            step.identifier = token;
+            if (end < pointer.size()) node = ((JSON::JSONObject*)node)->Find(token);
+        }
+        else if (node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST)
+        {
+            JSON::JSONList* list = (JSON::JSONList*)node;
+            bool numeric = !token.empty() && std::all_of(token.begin(), token.end(), ::isdigit) && (token == "0" || token[0] != '0');
+            if (!numeric && token != "-")
+            {
+                error = "\"" + token + "\" in \"" + pointer + "\" is not an index.";
+                return false;
+            }
+
+            step.isIndex = true;
+            step.index = token == "-" ? list->Size() : std::stoull(token);
+            if (end < pointer.size()) node = list->Find(step.index);
+        }
+        else
+        {
+            error = "\"" + pointer + "\" goes through a value that is not an object or a list.";
+            return false;
+        }
+
+        path.push_back(step);
+        if (end == pointer.size()) return true;
+        pos = end + 1;
+    }
+}
+
+bool jsonpatch::Apply(JSON& json, const std::string& patch, std::string& error)
+{
+    std::unique_ptr<JSON::JSONNode> operations(JSON::ParseValue(patch));
+    if (operations->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST)
+    {
+        throw JSONLoadError("[ERROR] A patch must be a list of operations.");
+    }
+
+    size_t version = json.GetVersion();
+    const std::vector<JSON::JSONNode*>& elements = ((JSON::JSONList*)operations.get())->Elements();
+
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        std::string prefix = "Operation " + std::to_string(i + 1);
+        std::string reason;
+        bool applied = false;
+
+        if (elements[i]->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+        {
+            reason = "is not an object.";
+        }
+        else
+        {
+            JSON::JSONObject* operation = (JSON::JSONObject*)elements[i];
+            const std::string* op = StringMember(operation, "op");
+            const std::string* pointer = StringMember(operation, "path");
+            const std::string* fromPointer = StringMember(operation, "from");
+            bool hasValue = operation->Contains("value");
+            if (op) prefix += " (" + *op + ")";
+
+            JSONPath path, from;
+            JSON::JSONNode* target = nullptr;
+
+            if (!op || !pointer) reason = "needs \"op\" and \"path\".";
+            else if (*op != "add" && *op != "remove" && *op != "replace" && *op != "move" && *op != "copy" && *op != "test")
+            {
+                reason = "is not a known operation.";
+            }
+            else if ((*op == "add" || *op == "replace" || *op == "test") && !hasValue) reason = "needs a \"value\".";
+            else if ((*op == "move" || *op == "copy") && !fromPointer) reason = "needs a \"from\".";
+            else if (!ResolvePointer(json, *pointer, path, reason)) { }
+            else if (fromPointer && (*op == "move" || *op == "copy") && !ResolvePointer(json, *fromPointer, from, reason)) { }
+            else if ((*op == "remove" || *op == "replace" || *op == "test") && !(target = Find(json, path)))
+            {
+                reason = "\"" + *pointer + "\" does not exist.";
+            }
+            else if (path.empty() && *op != "test") reason = "cannot replace the root object.";
+            else if (*op == "test")
+            {
+                applied = Equal(target, operation->Find("value"));
+                if (!applied) reason = "\"" + *pointer + "\" has another value.";
+            }
+            else if (*op == "remove")
+            {
+                applied = json.Remove(path);
+            }
+            else if (*op == "replace")
+            {
+                applied = json.Set(path, operation->Erase("value"));
+            }
+            else
+            {
+                // The value of add is taken from the patch, the others are copied from the tree
+                JSON::JSONNode* value = nullptr;
+                if (*op == "add") value = operation->Erase("value");
+                else if (JSON::JSONNode* source = Find(json, from)) value = Clone(source, nullptr);
+
+                bool intoItself = *op == "move" && from.size() < path.size() && std::equal(from.begin(), from.end(), path.begin());
+                if (!value) reason = "\"" + *fromPointer + "\" does not exist.";
+                else if (intoItself) reason = "cannot move a value into itself.";
+
+                // The target of a move is found again, as removing the value may shift it
+                if (*op == "move" && reason.empty() && !(from == path))
+                {
+                    applied = json.Remove(from) && ResolvePointer(json, *pointer, path, reason);
+                }
+                else applied = reason.empty();
+
+                if (applied && !(*op == "move" && from == path))
+                {
+                    applied = path.back().isIndex ? json.Insert(path, value) : json.Set(path, value);
+                }
+                else delete value;
+            }
+
+            if (!applied && reason.empty()) reason = "cannot be applied to \"" + *pointer + "\".";
+        }
+
+        if (!applied)
+        {
+            json.Revert(version);
+            error = prefix + " " + reason;
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,215 @@
+//          json_string.cpp
+//
+//  Provides escape sequences and UTF-8 of string literals, and the searches
+//  that let runs of text without them be copied at once.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "json_string.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+size_t jsonstring::FindQuoteOrEscape(std::string_view text, size_t pos)
+{
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; pos + 16 <= text.size(); pos += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(text.data() + pos));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)));
+        if (mask) return pos + __builtin_ctz(mask);
+    }
+#endif
+
+    for (; pos < text.size(); pos++)
+    {
+        if (text[pos] == '"' || text[pos] == '\\') return pos;
+    }
+    return text.size();
+}
+
+bool jsonstring::OddQuotes(std::string_view text, size_t pos, size_t end)
+{
+    bool odd = false;
+
+#ifdef __SSE2__
+    // Quotes of blocks without backslashes are counted at once, the other blocks are gone through
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (pos + 16 <= end)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(text.data() + pos));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, backslash)) == 0)
+        {
+            odd ^= __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, quote))) & 1;
+            pos += 16;
+            continue;
+        }
+
+        const size_t blockEnd = pos + 16;
+        while (pos < blockEnd)
+        {
+            if (text[pos] == '"') odd = !odd;
+            pos += text[pos] == '\\' ? 2 : 1;
+        }
+    }
+#endif
+
+    while (pos < end)
+    {
+        if (text[pos] == '"') odd = !odd;
+        pos += text[pos] == '\\' ? 2 : 1;
+    }
+    return odd;
+}
+
+size_t jsonstring::SequenceLength(std::string_view text, size_t pos)
+{
+    const unsigned char first = text[pos];
+    if (first < 0x80) return 1;
+
+    // Well-formed sequences of the Unicode standard (table 3-7): the range of the second byte depends
+    // on the first one, which rules out overlong forms, surrogates and code points past U+10FFFF.
+    size_t length;
+    unsigned char low = 0x80, high = 0xBF;
+    if (first >= 0xC2 && first <= 0xDF) length = 2;
+    else if (first >= 0xE0 && first <= 0xEF)
+    {
+        length = 3;
+        if (first == 0xE0) low = 0xA0;
+        if (first == 0xED) high = 0x9F;
+    }
+    else if (first >= 0xF0 && first <= 0xF4)
+    {
+        length = 4;
+        if (first == 0xF0) low = 0x90;
+        if (first == 0xF4) high = 0x8F;
+    }
+    else return 0;
+
+    if (pos + length > text.size()) return 0;
+
+    const unsigned char second = text[pos + 1];
+    if (second < low || second > high) return 0;
+    for (size_t i = 2; i < length; i++)
+    {
+        if (((unsigned char)text[pos + i] & 0xC0) != 0x80) return 0;
+    }
+    return length;
+}
+
+size_t jsonstring::FindInvalidUtf8(std::string_view text)
+{
+    return FindInvalidUtf8(text, 0, text.size());
+}
+
+size_t jsonstring::FindInvalidUtf8(std::string_view text, size_t pos, size_t end)
+{
+#ifdef __SSE2__
+    // Blocks of ASCII are skipped at once, the others are checked from their first non-ASCII byte on.
+    // Sequences may cross the end of a block, so the next block starts where the last one ended.
+    while (pos + 16 <= end)
+    {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(text.data() + pos)));
+        if (mask == 0)
+        {
+            pos += 16;
+            continue;
+        }
+
+        const size_t blockEnd = pos + 16;
+        pos += __builtin_ctz(mask);
+        while (pos < blockEnd)
+        {
+            size_t length = SequenceLength(text, pos);
+            if (length == 0) return pos;
+            pos += length;
+        }
+    }
+#endif
+
+    while (pos < end)
+    {
+        size_t length = SequenceLength(text, pos);
+        if (length == 0) return pos;
+        pos += length;
+    }
+    return std::string::npos;
+}
+
+void jsonstring::AppendUtf8(std::string& out, uint32_t codePoint)
+{
+    if (codePoint < 0x80)
+    {
+        out += (char)codePoint;
+    }
+    else if (codePoint < 0x800)
+    {
+        out += (char)(0xC0 | codePoint >> 6);
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000)
+    {
+        out += (char)(0xE0 | codePoint >> 12);
+        out += (char)(0x80 | (codePoint >> 6 & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+        out += (char)(0xF0 | codePoint >> 18);
+        out += (char)(0x80 | (codePoint >> 12 & 0x3F));
+        out += (char)(0x80 | (codePoint >> 6 & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+}
+
+// Value of the four hexadecimal digits at pos, or -1 if there are none.
+static int32_t ReadHex(std::string_view text, size_t pos)
+{
+    if (pos + 4 > text.size()) return -1;
+
+    int32_t value = 0;
+    for (size_t i = pos; i < pos + 4; i++)
+    {
+        const char c = text[i];
+        int32_t digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return -1;
+        value = value << 4 | digit;
+    }
+    return value;
+}
+
+JSON_UNICODE_ESCAPE jsonstring::DecodeUnicodeEscape(std::string_view text, size_t& pos, std::string& out)
+{
+    int32_t high = ReadHex(text, pos + 1);
+    if (high < 0) return JSON_UNICODE_ESCAPE::JSON_UNICODE_ESCAPE_INVALID;
+
+    if (high < 0xD800 || high > 0xDFFF)
+    {
+        AppendUtf8(out, (uint32_t)high);
+        pos += 4;
+        return JSON_UNICODE_ESCAPE::JSON_UNICODE_ESCAPE_VALID;
+    }
+
+    // A high surrogate followed by "\uDC00".."\uDFFF" is a code point past U+FFFF
+    if (high <= 0xDBFF && pos + 7 <= text.size() && text.compare(pos + 5, 2, "\\u") == 0)
+    {
+        int32_t low = ReadHex(text, pos + 7);
+        if (low >= 0xDC00 && low <= 0xDFFF)
+        {
+            AppendUtf8(out, 0x10000 + ((uint32_t)(high - 0xD800) << 10) + (uint32_t)(low - 0xDC00));
+            pos += 10;
+            return JSON_UNICODE_ESCAPE::JSON_UNICODE_ESCAPE_VALID;
+        }
+    }
+
+    AppendUtf8(out, 0xFFFD);
+    pos += 4;
+    return JSON_UNICODE_ESCAPE::JSON_UNICODE_ESCAPE_UNPAIRED;
+}
@@ -0,0 +1,582 @@
+//          json_validator.cpp
+//
+//  Provides validation of JSON text without building a tree.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "json_validator.h"
+#include "snapshot.h"
+#include "json_string.h"
+#include "byte_stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <unordered_set>
+
+// Characters that end a literal
+static bool IsDelimiter(char c)
+{
+    return c == ',' || c == ':' || c == '{' || c == '}' || c == '[' || c == ']' || c == '"';
+}
+
+// Whether the text is a number: [+-]?[0-9]+(.[0-9]+)?([eE][+-]?[0-9]+)?, as read by the parser.
+// Strict numbers have no '+' sign and no leading zeros.
+static bool IsNumber(std::string_view text, bool strict)
+{
+    size_t i = 0;
+    auto digits = [&text, &i]()
+    {
+        size_t begin = i;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9') i++;
+        return i - begin;
+    };
+
+    if (i < text.size() && (text[i] == '-' || (text[i] == '+' && !strict))) i++;
+    size_t whole = i;
+    if (digits() == 0 || (strict && text[whole] == '0' && i - whole > 1)) return false;
+
+    if (i < text.size() && text[i] == '.')
+    {
+        i++;
+        if (digits() == 0) return false;
+    }
+
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E'))
+    {
+        i++;
+        if (i < text.size() && (text[i] == '+' || text[i] == '-')) i++;
+        if (digits() == 0) return false;
+    }
+    return i == text.size();
+}
+
+template <class Policy>
+class JSONValidator
+{
+    // Objects with more keys than this look up duplicates in a hash set
+    static constexpr size_t LinearKeys = 16;
+
+    enum class STATE
+    {
+        STATE_KEY = 0,      // Identifier of a member, or the end of an empty object
+        STATE_COLON = 1,
+        STATE_VALUE = 2,    // Value, or the end of an empty list
+        STATE_NEXT = 3,     // ',' or the end of the container
+    };
+
+    // Container the validator is in. Levels are kept when they are left, so that
+    // their storage is reused by the next container at the same depth; they are in
+    // a deque, as keys of the outer levels point into their decoded keys.
+    struct Level
+    {
+        bool isObject = false;
+        bool empty = true;
+        std::vector<std::string_view> keys;
+        std::unordered_set<std::string_view> keySet;
+        std::deque<std::string> decodedKeys;        // Keys that differ from their text
+    };
+
+    std::string_view text;
+    size_t maxMessages;
+    size_t pos = 0;
+    size_t line = 1;
+    size_t lineStart = 0;
+
+    std::deque<Level> levels;
+
+    std::string scratch;        // Code points of "\uXXXX" escapes, which are only checked
+    size_t depth = 0;
+    STATE state = STATE::STATE_VALUE;
+
+public:
+    JSONValidationReport report;
+
+    JSONValidator(std::string_view text, size_t maxMessages) : text(text), maxMessages(maxMessages)
+    {
+        report.bytes = text.size();
+    }
+
+    void Run();
+
+private:
+    void Message(const std::string& message, bool warning, size_t at)
+    {
+        (warning ? report.warnings : report.errors)++;
+        if (report.messages.size() >= maxMessages) return;
+
+        // Errors are reported where they are found, which is never before the current line
+        JSONValidationMessage entry;
+        entry.line = line;
+        entry.col = at - lineStart + 1;
+        entry.warning = warning;
+        entry.text = message;
+        report.messages.push_back(entry);
+    }
+
+    void Error(const std::string& message) { Message(message, false, std::min(pos, text.size())); }
+
+    void NewLine(size_t at)
+    {
+        line++;
+        lineStart = at + 1;
+    }
+
+    bool IsSpace(char c) const
+    {
+        if constexpr (Policy::trimsStrings) return c == ' ' || c == '\t' || c == '\n';
+        else return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    void SkipSpaces()
+    {
+        while (pos < text.size() && IsSpace(text[pos]))
+        {
+            if (text[pos] == '\n') NewLine(pos);
+            pos++;
+        }
+    }
+
+    // Go over the string at the position, returning its contents as they are in the text.
+    // Sets escaped if the value differs from the contents.
+    bool ScanString(std::string_view& contents, bool& escaped);
+
+    // Value of a string with escape sequences, as the parser reads it.
+    std::string Decode(std::string_view contents) const;
+
+    void ScanLiteral();
+    void CheckKey(std::string_view contents, bool escaped, size_t at);
+
+    void Push(bool isObject);
+    void Pop();
+
+    // Skip to the next ',' or closing bracket of the current container.
+    void Recover();
+};
+
+template <class Policy>
+bool JSONValidator<Policy>::ScanString(std::string_view& contents, bool& escaped)
+{
+    size_t begin = ++pos;
+    escaped = false;
+
+    while (pos < text.size())
+    {
+        char c = text[pos];
+        if (c == '"')
+        {
+            contents = text.substr(begin, pos - begin);
+            pos++;
+            return true;
+        }
+
+        if (c == '\\')
+        {
+            escaped = true;
+            if (++pos >= text.size()) break;
+
+            char e = text[pos];
+            const char* unknown = nullptr;
+            if (e == 'u')
+            {
+                scratch.clear();
+                JSON_UNICODE_ESCAPE result = jsonstring::DecodeUnicodeEscape(text, pos, scratch);
+                if (result == JSON_UNICODE_ESCAPE::JSON_UNICODE_ESCAPE_UNPAIRED) unknown = "Valid surrogate pair expected.";
+                if (result == JSON_UNICODE_ESCAPE::JSON_UNICODE_ESCAPE_INVALID) unknown = "Valid escape sequence expected.";
+            }
+            else if (std::strchr("\\\"/bfnrt", e) == nullptr || e == '\0')
+            {
+                unknown = "Valid escape sequence expected.";
+            }
+
+            if (unknown)
+            {
+                if constexpr (Policy::unknownEscapes == JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_ERROR)
+                {
+                    Message(unknown, false, pos);
+                }
+                else if constexpr (Policy::unknownEscapes == JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_WARN)
+                {
+                    Message(unknown, true, pos);
+                }
+            }
+            if (e == '\n') NewLine(pos);
+        }
+        else if ((unsigned char)c >= 0x80)
+        {
+            size_t length = jsonstring::SequenceLength(text, pos);
+            if (length == 0)
+            {
+                if constexpr (Policy::invalidUtf8 == JSON_INVALID_UTF8::JSON_INVALID_UTF8_ERROR)
+                {
+                    Message("Invalid UTF-8 sequence.", false, pos);
+                }
+                else if constexpr (Policy::invalidUtf8 == JSON_INVALID_UTF8::JSON_INVALID_UTF8_WARN)
+                {
+                    Message("Invalid UTF-8 sequence.", true, pos);
+                }
+
+                // The rest of the sequence is not reported again
+                while (pos + 1 < text.size() && ((unsigned char)text[pos + 1] & 0xC0) == 0x80) pos++;
+            }
+            else pos += length - 1;
+        }
+        else if (c == '\n')
+        {
+            if constexpr (Policy::rejectsControlCharacters) Message("Control characters in strings must be escaped.", false, pos);
+            if constexpr (Policy::trimsStrings) escaped = true;
+            NewLine(pos);
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            if constexpr (Policy::rejectsControlCharacters) Message("Control characters in strings must be escaped.", false, pos);
+            if (Policy::trimsStrings && c == '\t') escaped = true;
+        }
+        pos++;
+    }
+
+    Error("'\"' expected.");
+    return false;
+}
+
+template <class Policy>
+std::string JSONValidator<Policy>::Decode(std::string_view contents) const
+{
+    std::string value;
+    for (size_t i = 0; i < contents.size(); i++)
+    {
+        char c = contents[i];
+        if (Policy::trimsStrings && (c == '\t' || c == '\n')) continue;
+        if (c != '\\' || i + 1 == contents.size())
+        {
+            value += c;
+            continue;
+        }
+
+        char e = contents[++i];
+        switch (e)
+        {
+        case '\\': value += '\\'; break;
+        case 'n': value += '\n'; break;
+        case 't': value += '\t'; break;
+        case '"': value += '"'; break;
+        case '/': value += '/'; break;
+        case 'b': value += '\b'; break;
+        case 'f': value += '\f'; break;
+        case 'r': value += '\r'; break;
+        case 'u':
+            if (jsonstring::DecodeUnicodeEscape(contents, i, value) != JSON_UNICODE_ESCAPE::JSON_UNICODE_ESCAPE_INVALID) break;
+            if (Policy::unknownEscapes == JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_KEEP) value += e;
+            break;
+        default:
+            if (Policy::unknownEscapes == JSON_UNKNOWN_ESCAPE::JSON_UNKNOWN_ESCAPE_KEEP) value += e;
+        }
+    }
+    return value;
+}
+
+template <class Policy>
+void JSONValidator<Policy>::CheckKey(std::string_view contents, bool escaped, size_t at)
+{
+    Level& level = levels[depth - 1];
+    std::string_view key = contents;
+    if (escaped)
+    {
+        level.decodedKeys.push_back(Decode(contents));
+        key = level.decodedKeys.back();
+    }
+
+    if (key.empty())
+    {
+        Message("Expected valid identifier.", false, at);
+        return;
+    }
+    if constexpr (Policy::keepsLastDuplicate) return;
+
+    bool duplicate = false;
+    if (level.keys.size() < LinearKeys)
+    {
+        duplicate = std::find(level.keys.begin(), level.keys.end(), key) != level.keys.end();
+        if (!duplicate) level.keys.push_back(key);
+    }
+    else
+    {
+        if (level.keySet.empty()) level.keySet.insert(level.keys.begin(), level.keys.end());
+        duplicate = !level.keySet.insert(key).second;
+    }
+
+    if (duplicate) Message("Identifier is not unique.", false, at);
+}
+
+template <class Policy>
+void JSONValidator<Policy>::ScanLiteral()
+{
+    size_t begin = pos;
+    while (pos < text.size() && !IsSpace(text[pos]) && !IsDelimiter(text[pos])) pos++;
+    std::string_view literal = text.substr(begin, pos - begin);
+
+    // Trimming joins the parts of a literal split by whitespace, unless the policy rejects them
+    std::string joined;
+    if constexpr (!Policy::rejectsSplitLiterals)
+    {
+        size_t end = pos;
+        while (true)
+        {
+            size_t next = end;
+            while (next < text.size() && IsSpace(text[next])) next++;
+            if (next == end || next == text.size() || IsDelimiter(text[next])) break;
+
+            if (joined.empty()) joined = literal;
+            for (end = next; end < text.size() && !IsSpace(text[end]) && !IsDelimiter(text[end]); end++) joined += text[end];
+        }
+
+        for (; pos < end; pos++)
+        {
+            if (text[pos] == '\n') NewLine(pos);
+        }
+        if (!joined.empty()) literal = joined;
+    }
+
+    char first = literal.front();
+    bool isNumber = (first >= '0' && first <= '9') || first == '-' || first == '+';
+    if (isNumber && !IsNumber(literal, Policy::strictNumbers))
+    {
+        Message(Policy::strictNumbers ? "Invalid number." : "Invalid literal.", false, begin);
+    }
+    else if (!isNumber && literal != "true" && literal != "false" && literal != "null")
+    {
+        Message("Invalid literal.", false, begin);
+    }
+}
+
+template <class Policy>
+void JSONValidator<Policy>::Push(bool isObject)
+{
+    if (depth == levels.size()) levels.emplace_back();
+
+    Level& level = levels[depth++];
+    level.isObject = isObject;
+    level.empty = true;
+    level.keys.clear();
+    level.keySet.clear();
+    level.decodedKeys.clear();
+
+    report.maxDepth = std::max(report.maxDepth, depth);
+    state = isObject ? STATE::STATE_KEY : STATE::STATE_VALUE;
+}
+
+template <class Policy>
+void JSONValidator<Policy>::Pop()
+{
+    depth--;
+    state = STATE::STATE_NEXT;
+}
+
+template <class Policy>
+void JSONValidator<Policy>::Recover()
+{
+    size_t nested = 0;
+    bool escape = false;
+    bool inString = false;
+
+    for (; pos < text.size(); pos++)
+    {
+        char c = text[pos];
+        if (c == '\n') NewLine(pos);
+
+        if (inString)
+        {
+            if (escape) escape = false;
+            else if (c == '\\') escape = true;
+            else if (c == '"') inString = false;
+            continue;
+        }
+
+        if (c == '"') inString = true;
+        else if (c == '{' || c == '[') nested++;
+        else if ((c == '}' || c == ']') && nested > 0) nested--;
+        else if (nested == 0 && (c == ',' || c == '}' || c == ']')) break;
+    }
+    state = STATE::STATE_NEXT;
+}
+
+template <class Policy>
+void JSONValidator<Policy>::Run()
+{
+    SkipSpaces();
+    if (pos == text.size())
+    {
+        Error("JSON file does not exist or is empty.");
+        return;
+    }
+    if (text[pos] != '{')
+    {
+        Error("JSON file does not contain an object.");
+        return;
+    }
+
+    report.values++;
+    pos++;
+    Push(true);
+
+    while (depth > 0)
+    {
+        SkipSpaces();
+        if (pos >= text.size())
+        {
+            Error("No closing parentheses found.");
+            return;
+        }
+
+        char c = text[pos];
+        Level& level = levels[depth - 1];
+        char closing = level.isObject ? '}' : ']';
+
+        switch (state)
+        {
+        case STATE::STATE_KEY:
+        {
+            if (c == '}')
+            {
+                // The parser does not take empty objects, nor a ',' before the end
+                Error(level.empty ? "Expected an expression." : "Expected valid identifier.");
+                pos++;
+                Pop();
+                break;
+            }
+            if (c != '"')
+            {
+                Error("Expected valid identifier.");
+                Recover();
+                break;
+            }
+
+            size_t at = pos;
+            std::string_view contents;
+            bool escaped = false;
+            if (!ScanString(contents, escaped)) return;
+
+            CheckKey(contents, escaped, at);
+            state = STATE::STATE_COLON;
+            break;
+        }
+
+        case STATE::STATE_COLON:
+            if (c != ':')
+            {
+                Error("Expected ':'.");
+                Recover();
+                break;
+            }
+            pos++;
+            state = STATE::STATE_VALUE;
+            break;
+
+        case STATE::STATE_VALUE:
+            if (c == ']' && !level.isObject && level.empty)
+            {
+                pos++;
+                Pop();
+                break;
+            }
+            if (c == ',' || c == '}' || c == ']' || c == ':')
+            {
+                Error("Expected a value.");
+                if (c == ':') Recover();
+                else state = STATE::STATE_NEXT;
+                break;
+            }
+
+            report.values++;
+            if (c == '{' || c == '[')
+            {
+                // The container is skipped as a whole, as the parser does not build it
+                if (depth == MaxNestingDepth)
+                {
+                    Error("Nesting is deeper than " + std::to_string(MaxNestingDepth) + " levels.");
+                    Recover();
+                    break;
+                }
+                pos++;
+                Push(c == '{');
+                break;
+            }
+
+            if (c == '"')
+            {
+                std::string_view contents;
+                bool escaped = false;
+                if (!ScanString(contents, escaped)) return;
+            }
+            else ScanLiteral();
+            state = STATE::STATE_NEXT;
+            break;
+
+        case STATE::STATE_NEXT:
+            if (c == ',')
+            {
+                pos++;
+                level.empty = false;
+                state = level.isObject ? STATE::STATE_KEY : STATE::STATE_VALUE;
+            }
+            else if (c == '}' || c == ']')
+            {
+                // A bracket of another kind is left to close an enclosing container
+                if (c != closing) Error("Parentheses mismatch.");
+                else pos++;
+                Pop();
+            }
+            else
+            {
+                Error("Expected ','.");
+                Recover();
+            }
+            break;
+        }
+    }
+
+    SkipSpaces();
+    if (pos < text.size()) Error("Invalid characters after the root object.");
+}
+
+JSONValidationReport jsonvalidator::Validate(std::string_view text, JSON_PARSE_POLICY policy, size_t maxMessages)
+{
+    return WithPolicy(policy, [&](auto tag)
+    {
+        JSONValidator<decltype(tag)> validator(text, maxMessages);
+        validator.Run();
+        return std::move(validator.report);
+    });
+}
+
+JSONValidationReport jsonvalidator::ValidateFile(const std::string& filename, JSON_PARSE_POLICY policy, size_t maxMessages)
+{
+    // Streams and compressed files are read whole first, as they cannot be mapped. Missing files,
+    // and those compressed in a way this build does not read, cannot be read either.
+    if (!bytestream::IsPlainFile(filename))
+    {
+        std::string text;
+        try
+        {
+            text = bytestream::ReadAll(filename);
+        }
+        catch (const JSONLoadError&)
+        {
+            JSONValidationReport report = Validate({}, policy, maxMessages);
+            report.readable = false;
+            return report;
+        }
+        return Validate(text, policy, maxMessages);
+    }
+
+    MappedFile file(filename);
+    if (!file.IsOpen())
+    {
+        // Empty files are reported as the parser does
+        JSONValidationReport report = Validate({}, policy, maxMessages);
+        report.readable = std::ifstream(filename).is_open();
+        return report;
+    }
+    return Validate(std::string_view(file.Data(), file.Size()), policy, maxMessages);
+}
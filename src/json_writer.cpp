@@ -0,0 +1,321 @@
+//          json_writer.cpp
+//
+//  Provides writing of trees as JSON, with passthrough of unedited values.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "json_writer.h"
+
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Whitespace of the file around a member or an element, reused when its container is written from the tree.
+struct Layout
+{
+    std::string_view indent;        // Before the member or element
+    std::string_view separator;     // Between the key and the value, including ':'
+    bool valid = false;
+};
+
+class JSONWriter
+{
+    static constexpr size_t BufferSize = 1 << 16;
+
+    std::string_view source;
+    std::ostream& out;
+    std::string buffer;
+
+public:
+    JSONWriteStats stats;
+
+    JSONWriter(std::string_view source, std::ostream& out) : source(source), out(out) { }
+
+    ~JSONWriter() { Flush(); }
+
+    void Flush()
+    {
+        out.write(buffer.data(), buffer.size());
+        stats.bytes += buffer.size();
+        buffer.clear();
+    }
+
+    void Put(std::string_view text)
+    {
+        if (buffer.size() + text.size() > BufferSize) Flush();
+
+        // Large spans go to the stream directly
+        if (text.size() >= BufferSize)
+        {
+            out.write(text.data(), text.size());
+            stats.bytes += text.size();
+        }
+        else buffer.append(text);
+    }
+
+    void Put(char c)
+    {
+        if (buffer.size() + 1 > BufferSize) Flush();
+        buffer.push_back(c);
+    }
+
+    void Copy(uint64_t begin, uint64_t end)
+    {
+        Put(source.substr(begin, end - begin));
+        stats.copiedBytes += end - begin;
+    }
+
+    // Whether the span of the node can be used at all, i.e. it refers to the source.
+    bool InSource(uint64_t begin, uint64_t end) const { return end != 0 && end <= source.size() && begin < end; }
+
+    Layout LayoutOf(JSON::JSONNode* child, bool isMember) const;
+
+    // Whitespace before the closing bracket of the container.
+    std::string_view ClosingOf(JSON::JSONNode* container) const;
+
+    void WriteString(const std::string& value);
+    void WriteNode(JSON::JSONNode* node);
+    void WriteContainer(JSON::JSONNode* node);
+};
+
+Layout JSONWriter::LayoutOf(JSON::JSONNode* child, bool isMember) const
+{
+    Layout layout;
+
+    // A member put in place of another one has the position of the old value
+    uint64_t pos = child->GetSpanBegin();
+    if (pos == 0 || pos >= source.size()) return layout;
+
+    auto skipSpaces = [this](uint64_t& pos)
+    {
+        uint64_t end = pos;
+        while (pos > 0 && IsSpace(source[pos - 1])) pos--;
+        return end;
+    };
+
+    if (isMember)
+    {
+        uint64_t separatorEnd = skipSpaces(pos);
+        if (pos == 0 || source[pos - 1] != ':') return layout;
+        pos--;
+        skipSpaces(pos);
+        layout.separator = source.substr(pos, separatorEnd - pos);
+
+        // Opening quote of the key is not escaped, i.e. preceded by an even number of backslashes
+        if (pos == 0 || source[pos - 1] != '"') return layout;
+        pos--;
+        while (true)
+        {
+            if (pos == 0) return layout;
+            pos--;
+            if (source[pos] != '"') continue;
+
+            uint64_t backslashes = 0;
+            while (pos > backslashes && source[pos - 1 - backslashes] == '\\') backslashes++;
+            if (backslashes % 2 == 0) break;
+        }
+    }
+
+    uint64_t indentEnd = skipSpaces(pos);
+    if (pos == 0) return layout;
+
+    char before = source[pos - 1];
+    if (before != ',' && before != (isMember ? '{' : '[')) return layout;
+
+    layout.indent = source.substr(pos, indentEnd - pos);
+    layout.valid = true;
+    return layout;
+}
+
+std::string_view JSONWriter::ClosingOf(JSON::JSONNode* container) const
+{
+    if (!InSource(container->GetSpanBegin(), container->GetSpanEnd())) return {};
+
+    uint64_t end = container->GetSpanEnd() - 1;
+    uint64_t pos = end;
+    while (pos > container->GetSpanBegin() + 1 && IsSpace(source[pos - 1])) pos--;
+    return source.substr(pos, end - pos);
+}
+
+void JSONWriter::WriteString(const std::string& value)
+{
+    Put('"');
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"': Put("\\\""); break;
+        case '\\': Put("\\\\"); break;
+        case '\n': Put("\\n"); break;
+        case '\t': Put("\\t"); break;
+        case '\r': Put("\\r"); break;
+        case '\b': Put("\\b"); break;
+        case '\f': Put("\\f"); break;
+        default:
+            if ((unsigned char)c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)c);
+                Put(escaped);
+            }
+            else Put(c);
+        }
+    }
+    Put('"');
+}
+
+void JSONWriter::WriteNode(JSON::JSONNode* node)
+{
+    if (!node->IsDirty() && InSource(node->GetSpanBegin(), node->GetSpanEnd()))
+    {
+        Copy(node->GetSpanBegin(), node->GetSpanEnd());
+        stats.copiedNodes++;
+        return;
+    }
+    stats.encodedNodes++;
+
+    switch (node->GetType())
+    {
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT:
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST:
+        WriteContainer(node);
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING:
+        WriteString(((JSON::JSONLiteral<std::string>*)node)->GetValue());
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT:
+        Put(std::to_string(((JSON::JSONLiteral<int>*)node)->GetValue()));
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_DOUBLE:
+    {
+        double value = ((JSON::JSONLiteral<double>*)node)->GetValue();
+        if (!std::isfinite(value))
+        {
+            Put("null");
+            break;
+        }
+
+        // Shortest text that reads back as the same value, which is still read as a double
+        char text[32];
+        for (int precision = 15; precision <= 17; precision++)
+        {
+            std::snprintf(text, sizeof(text), "%.*g", precision, value);
+            if (std::strtod(text, nullptr) == value) break;
+        }
+        Put(text);
+        if (!std::strpbrk(text, ".eE")) Put(".0");
+        break;
+    }
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_BOOL:
+        Put(((JSON::JSONLiteral<bool>*)node)->GetValue() ? "true" : "false");
+        break;
+    default:
+        Put("null");
+    }
+}
+
+void JSONWriter::WriteContainer(JSON::JSONNode* node)
+{
+    bool isObject = node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT;
+
+    // Members are written in the order of the file, followed by the new ones
+    std::vector<std::pair<const std::string*, JSON::JSONNode*>> children;
+    if (isObject)
+    {
+        for (const auto& member : ((JSON::JSONObject*)node)->Members()) children.push_back({ &member.first, member.second });
+
+        auto position = [](JSON::JSONNode* child) { return child->GetSpanBegin() ? child->GetSpanBegin() : UINT64_MAX; };
+        std::sort(children.begin(), children.end(), [&position](const auto& a, const auto& b)
+        {
+            uint64_t positionA = position(a.second), positionB = position(b.second);
+            return positionA != positionB ? positionA < positionB : *a.first < *b.first;
+        });
+    }
+    else
+    {
+        for (JSON::JSONNode* element : ((JSON::JSONList*)node)->Elements()) children.push_back({ nullptr, element });
+    }
+
+    // Children without a layout of their own take that of the child before them, or of the first one
+    Layout previous;
+    for (const auto& child : children)
+    {
+        previous = LayoutOf(child.second, isObject);
+        if (previous.valid) break;
+    }
+
+    Put(isObject ? '{' : '[');
+    for (size_t i = 0; i < children.size(); i++)
+    {
+        Layout layout = LayoutOf(children[i].second, isObject);
+        if (layout.valid) previous = layout;
+        else layout = previous;
+
+        if (i > 0) Put(',');
+        Put(layout.indent);
+        if (isObject)
+        {
+            WriteString(*children[i].first);
+            Put(layout.valid ? layout.separator : ":");
+        }
+        WriteNode(children[i].second);
+    }
+
+    if (!children.empty()) Put(ClosingOf(node));
+    Put(isObject ? '}' : ']');
+}
+
+void jsonwriter::Write(JSON::JSONNode* node, std::string_view source, std::ostream& out, JSONWriteStats* stats)
+{
+    JSONWriter writer(source, out);
+    writer.WriteNode(node);
+    writer.Flush();
+    if (stats) *stats = writer.stats;
+}
+
+void jsonwriter::Write(JSON& json, std::ostream& out, JSONWriteStats* stats)
+{
+    size_t resolved = 0;
+    JSON::JSONNode* root = json.FindPath({}, resolved);
+
+    JSONWriter writer(json.GetSourceBytes(), out);
+    bool surrounded = writer.InSource(root->GetSpanBegin(), root->GetSpanEnd());
+
+    if (surrounded) writer.Copy(0, root->GetSpanBegin());
+    writer.WriteNode(root);
+    if (surrounded) writer.Copy(root->GetSpanEnd(), json.GetSourceBytes().size());
+
+    writer.Flush();
+    if (stats) *stats = writer.stats;
+}
+
+bool jsonwriter::Save(JSON& json, const std::string& filename, JSONWriteStats* stats)
+{
+    std::string tempPath = filename + ".tmp";
+
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+
+    Write(json, out, stats);
+    out.close();
+
+    std::error_code error;
+    if (out.fail())
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(tempPath, filename, error);
+    return !error;
+}
@@ -7,51 +7,232 @@
  *********************************************************************/
 
 #include <iostream>
+#include <filesystem>
+#include <csignal>
+#include <chrono>
+#include <cstdio>
 
 // JSON parser library
 #include <json_parser.h>
+#include <documents.h>
+#include <server.h>
+#include <json_validator.h>
+#include <byte_stream.h>
 
 #include "command.h"
 #include "fsm.h"
+#include "utilstr.h"
+
+// Server stopped by SIGINT and SIGTERM
+static QueryServer* server = nullptr;
+
+static void StopServer(int)
+{
+    if (server) server->Stop();
+}
+
+// Serve queries on the socket instead of reading commands, until the process is interrupted.
+static int Serve(DocumentRegistry& documents, const std::string& socketPath, size_t threads)
+{
+    QueryServer queryServer(documents, threads);
+
+    std::string error;
+    if (!queryServer.Listen(socketPath, error))
+    {
+        std::cout << "[ERROR] " << error << std::endl;
+        return 1;
+    }
+
+    server = &queryServer;
+    std::signal(SIGINT, StopServer);
+    std::signal(SIGTERM, StopServer);
+
+    std::cout << "Serving " << documents.Documents().size() << " documents on \"" << socketPath << "\" with "
+        << queryServer.Threads() << " threads." << std::endl;
+    queryServer.Run();
+    server = nullptr;
+
+    std::cout << "Server stopped.\n" << queryServer.GetStats().Describe() << std::flush;
+    return 0;
+}
+
+// Check the files without loading them, printing every error and a summary of each file.
+// Returns 1 if any of them is invalid.
+static int Validate(const CommandLineInterpreter& interpreter, JSON_PARSE_POLICY policy)
+{
+    bool valid = true;
+    for (const Token& token : interpreter.GetTokens())
+    {
+        std::string path = token.GetValue();
+
+        auto start = std::chrono::steady_clock::now();
+        JSONValidationReport report = jsonvalidator::ValidateFile(path, policy);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (!report.readable)
+        {
+            std::cout << "[ERROR] " << path << " cannot be read." << std::endl;
+            valid = false;
+            continue;
+        }
+
+        for (const JSONValidationMessage& message : report.messages)
+        {
+            std::cout << (message.warning ? "[WARNING] " : "[ERROR] ") << path << ":" << message.line << ":" << message.col
+                << " - " << message.text << std::endl;
+        }
+
+        size_t shown = report.messages.size();
+        if (report.errors + report.warnings > shown)
+        {
+            std::cout << "... and " << report.errors + report.warnings - shown << " more." << std::endl;
+        }
+
+        char milliseconds[32];
+        std::snprintf(milliseconds, sizeof(milliseconds), "%.2f", elapsed.count());
+        std::cout << path << ": " << (report.IsValid() ? "valid" : "invalid") << ", " << report.errors << " errors, "
+            << report.warnings << " warnings, " << report.values << " values, depth " << report.maxDepth << ", "
+            << report.bytes << " bytes checked in " << milliseconds << " ms." << std::endl;
+
+        valid = valid && report.IsValid();
+    }
+    return valid ? 0 : 1;
+}
 
 // Entry point to the program
 int main(int argc, char* argv[])
 {
+    // Read the arguments in the same way as CLI commands.
+    std::string commandLine = "parser";
+    for (int i = 1; i < argc; i++)
+    {
+        commandLine += " ";
+        commandLine += argv[i];
+    }
+
+    CommandLineInterpreter interpreter(commandLine);
+
     // Validate the arguments
-    if (argc < 2)
+    if (!interpreter.Interpret() || interpreter.GetTokens().empty())
     {
-        std::cout << "Enter the file name. Correct syntax:\n./json_eval <filename>\n";
+        std::cout << "Enter the file name. Correct syntax:\n./json_eval <filename|-> (<filename>..) (--snapshot) (--index(=THRESHOLD)) (--progressive(=THRESHOLD)) (--path-index) (--shared) (--strict|--lenient) (--project=PATH,..) (--validate) (--watch) (--serve=SOCKET (--threads=N))\n";
         return 0;
     }
 
-    // argv[1] is guaranteed to be a valid pointer
-    std::string path = argv[1];
-    JSON json(path);
-    
-    // Here, JSON file is guaranteed to be valid, otherwise it would have exited.
+    JSONLoadOptions options = ReadLoadOptions(interpreter);
 
-    JSONInterface interface = json.CreateInterface();
+    // With --validate, the files are only checked, and no tree is built
+    for (const Argument& arg : interpreter.GetArgs())
+    {
+        if (arg == ArgumentAlias("validate", "V")) return Validate(interpreter, options.policy);
+    }
+
+    // All files start loading at once, each document named after its file, e.g. "dump" for dump.json.gz.
+    // The standard input, given as "-", is named "stdin".
+    DocumentRegistry documents;
+    std::string standardInput;
+    for (const Token& token : interpreter.GetTokens())
+    {
+        std::string path = token.GetValue();
+        std::filesystem::path file(path);
+        if (file.extension() == ".gz" || file.extension() == ".zst") file = file.stem();
+        std::string name = path == bytestream::StandardInput ? "stdin" : file.stem().string();
+
+        std::string unique = name;
+        for (int i = 2; documents.Find(unique); i++) unique = name + "_" + std::to_string(i);
+
+        documents.Open(unique, path, options);
+        if (path == bytestream::StandardInput) standardInput = unique;
+    }
 
     std::string welcome_msg = "Welcome to JSON Parser v1.0 by Mikalai Varapai!\n";
     welcome_msg += "The list of available commands can be accessed with \":h\" or \":help\".\n";
-    welcome_msg += "Current file: " + path;
+    welcome_msg += "Current file: " + interpreter.GetTokens().at(0).GetValue();
     std::cout << welcome_msg << std::endl;
 
+    // Only the first file is waited for, the others keep loading in the background.
+    WaitForDocument(*documents.Current());
+
+    // With --watch, changes of the files are applied as they are made.
+    WatchList watches;
+    for (const Argument& arg : interpreter.GetArgs())
+    {
+        if (arg == ArgumentAlias("watch", "w"))
+        {
+            for (const auto& document : documents.Documents())
+            {
+                if (document.second->GetPath() != bytestream::StandardInput) watches.Watch(documents, *document.second);
+            }
+        }
+    }
+
+    // With --serve, other processes query the documents instead of the prompt
+    for (const Argument& arg : interpreter.GetArgs())
+    {
+        if (arg == ArgumentAlias("serve", "S") && arg.HasValue())
+        {
+            size_t threads = 0;
+            for (const Argument& threadsArg : interpreter.GetArgs())
+            {
+                if (threadsArg == ArgumentAlias("threads", "t") && threadsArg.HasValue() && utilstr::IsNumLiteral(threadsArg.GetValue()))
+                {
+                    threads = std::stoull(threadsArg.GetValue());
+                }
+            }
+            return Serve(documents, arg.GetValue(), threads);
+        }
+    }
+
+    // Commands are read from the terminal once the document has been read from the standard input
+    if (!standardInput.empty())
+    {
+        WaitForDocument(*documents.Find(standardInput));
+#if defined(_WIN32)
+        std::freopen("CONIN$", "r", stdin);
+#else
+        std::freopen("/dev/tty", "r", stdin);
+#endif
+        std::cin.clear();
+    }
+
     CommandInterface cmdInterface;
     cmdInterface.RegisterCommand(new CommandHelp(cmdInterface));
     cmdInterface.RegisterCommand(new CommandQuit());
-    cmdInterface.RegisterCommand(new CommandCurrent(interface));
-    cmdInterface.RegisterCommand(new CommandSelect(interface));
-    cmdInterface.RegisterCommand(new CommandBack(interface));
+    cmdInterface.RegisterCommand(new CommandCurrent(documents));
+    cmdInterface.RegisterCommand(new CommandSelect(documents));
+    cmdInterface.RegisterCommand(new CommandBack(documents));
+    cmdInterface.RegisterCommand(new CommandOpen(documents));
+    cmdInterface.RegisterCommand(new CommandUse(documents));
+    cmdInterface.RegisterCommand(new CommandClose(documents, watches));
+    cmdInterface.RegisterCommand(new CommandWait(documents));
+    cmdInterface.RegisterCommand(new CommandDocuments(documents));
+    cmdInterface.RegisterCommand(new CommandWatch(documents, watches));
+    cmdInterface.RegisterCommand(new CommandUnwatch(documents, watches));
+    cmdInterface.RegisterCommand(new CommandPathIndex(documents));
+    cmdInterface.RegisterCommand(new CommandBatch(documents));
+    cmdInterface.RegisterCommand(new CommandPublish(documents));
+    cmdInterface.RegisterCommand(new CommandSet(documents));
+    cmdInterface.RegisterCommand(new CommandInsert(documents));
+    cmdInterface.RegisterCommand(new CommandDelete(documents));
+    cmdInterface.RegisterCommand(new CommandUndo(documents));
+    cmdInterface.RegisterCommand(new CommandChanges(documents));
+    cmdInterface.RegisterCommand(new CommandPatch(documents));
+    cmdInterface.RegisterCommand(new CommandSave(documents));
 
     std::string command;
 
     while (true)
     {
-        std::cout << "json_eval>";
-        std::getline(std::cin, command);
-        ProcessInput(command, interface, cmdInterface);
+        for (const std::string& message : documents.PollFinished())
+        {
+            std::cout << message << std::endl;
+        }
+
+        JSONDocument* current = documents.Current();
+        std::cout << "json_eval" << (current ? "[" + current->GetName() + "]" : "") << ">";
+        if (!std::getline(std::cin, command)) break;
+        ProcessInput(command, documents, cmdInterface);
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,484 @@
+//          offset_index.cpp
+//
+//  Provides building of structural offset indices, and reading
+//  of JSON files through them.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "offset_index.h"
+
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+std::string offsetindex::SidecarPath(const std::string& filename)
+{
+    return filename + ".idx";
+}
+
+// Container found while building the index, with its children in file order.
+struct IndexedContainer
+{
+    struct Member
+    {
+        std::string key;
+        uint64_t memberBegin;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    uint64_t begin;
+    uint64_t end;
+    JSON::JSON_NODE_TYPE type;
+    std::vector<Member> children;
+};
+
+// Single pass over the trimmed source, which records spans of all containers
+// of at least threshold bytes, and the spans of their children.
+static std::vector<IndexedContainer> ScanContainers(JSONSource& source, uint64_t threshold)
+{
+    // State of a container which is not closed yet
+    struct Frame
+    {
+        IndexedContainer container;
+        size_t memberBegin = 0;     // Trimmed position of the current member
+        size_t valueBegin = 0;      // Trimmed position of the current value
+        std::string key;
+        bool expectKey = false;
+    };
+
+    std::vector<IndexedContainer> result;
+    std::vector<Frame> stack;
+
+    JSONString text = source.GetString();
+
+    // Close the current member of the frame, which ends before position end.
+    auto closeMember = [&source](Frame& frame, size_t end)
+    {
+        frame.container.children.push_back({ std::move(frame.key),
+            source.GetFileOffset(frame.memberBegin),
+            source.GetFileOffset(frame.valueBegin),
+            source.GetFileOffset(end - 1) + 1 });
+        frame.key.clear();
+    };
+
+    for (size_t i = 0; i < text.Size(); i++)
+    {
+        const char c = text.at(i);
+
+        if (c == '"')
+        {
+            size_t length = 0;
+            Frame* frame = stack.empty() ? nullptr : &stack.back();
+
+            if (frame && frame->expectKey)
+            {
+                JSONString key = text.substr(i);
+                frame->memberBegin = i;
+                frame->key = key.ScanString(length);
+                frame->expectKey = false;
+            }
+            else
+            {
+                // Skip the string, stopping at the closing '"'
+                bool escape = false;
+                for (length = 1; i + length < text.Size(); length++)
+                {
+                    const char s = text.at(i + length);
+                    if (s == '"' && !escape) break;
+                    escape = (s == '\\') && !escape;
+                }
+                length++;
+            }
+
+            i += length - 1;
+            continue;
+        }
+
+        switch (c)
+        {
+        case '{':
+        case '[':
+        {
+            Frame frame;
+            frame.container.begin = source.GetFileOffset(i);
+            frame.container.type = (c == '{') ? JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT
+                : JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST;
+            frame.expectKey = (c == '{');
+            frame.memberBegin = frame.valueBegin = i + 1;
+            stack.push_back(std::move(frame));
+            break;
+        }
+        case ':':
+            if (!stack.empty()) stack.back().valueBegin = i + 1;
+            break;
+        case ',':
+            if (stack.empty()) break;
+            closeMember(stack.back(), i);
+            stack.back().expectKey = (stack.back().container.type == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT);
+            stack.back().memberBegin = stack.back().valueBegin = i + 1;
+            break;
+        case '}':
+        case ']':
+        {
+            if (stack.empty()) break;
+            Frame& frame = stack.back();
+
+            // Empty containers have no members
+            if (frame.valueBegin < i) closeMember(frame, i);
+
+            frame.container.end = source.GetFileOffset(i) + 1;
+
+            // The root is always indexed
+            if (frame.container.end - frame.container.begin >= threshold || stack.size() == 1)
+            {
+                result.push_back(std::move(frame.container));
+            }
+            stack.pop_back();
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const IndexedContainer& a, const IndexedContainer& b)
+    {
+        return a.begin < b.begin;
+    });
+    return result;
+}
+
+bool offsetindex::Write(JSONSource& source, const std::string& filename, uint64_t threshold)
+{
+    snapshot::SourceKey key;
+    if (!snapshot::GetSourceKey(filename, key)) return false;
+
+    std::vector<IndexedContainer> containers = ScanContainers(source, threshold);
+
+    std::string path = SidecarPath(filename);
+    std::string tempPath = path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+
+    // Every record is 8-byte aligned, put(..) returns its offset.
+    uint64_t offset = 0;
+    auto put = [&out, &offset](const void* bytes, size_t count)
+    {
+        static const char padding[8] = { };
+        out.write(padding, (8 - offset % 8) % 8);
+        offset += (8 - offset % 8) % 8;
+
+        uint64_t recordOffset = offset;
+        out.write((const char*)bytes, count);
+        offset += count;
+        return recordOffset;
+    };
+
+    // Header is rewritten once offsets are known.
+    Header header = { };
+    std::memcpy(header.magic, Magic, sizeof(header.magic));
+    header.version = Version;
+    header.key = key;
+    header.threshold = threshold;
+    header.entryCount = containers.size();
+    put(&header, sizeof(header));
+
+    std::vector<Entry> entries;
+    for (const IndexedContainer& container : containers)
+    {
+        Entry entry = { };
+        entry.begin = container.begin;
+        entry.end = container.end;
+        entry.type = (int32_t)container.type;
+        entry.childCount = container.children.size();
+
+        std::vector<Child> children;
+        for (const IndexedContainer::Member& member : container.children)
+        {
+            Child child = { 0, member.memberBegin, member.begin, member.end };
+
+            // Only object members have keys
+            if (container.type == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+            {
+                uint64_t length = member.key.size();
+                child.keyOffset = put(&length, sizeof(length));
+                out.write(member.key.data(), member.key.size());
+                offset += member.key.size();
+            }
+            children.push_back(child);
+        }
+
+        entry.childrenOffset = put(children.data(), children.size() * sizeof(Child));
+
+        if (container.type == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+        {
+            std::vector<uint64_t> keyOrder(children.size());
+            for (uint64_t i = 0; i < keyOrder.size(); i++) keyOrder[i] = i;
+
+            std::sort(keyOrder.begin(), keyOrder.end(), [&container](uint64_t a, uint64_t b)
+            {
+                return container.children[a].key < container.children[b].key;
+            });
+
+            entry.keyOrderOffset = put(keyOrder.data(), keyOrder.size() * sizeof(uint64_t));
+        }
+        entries.push_back(entry);
+    }
+
+    header.entriesOffset = put(entries.data(), entries.size() * sizeof(Entry));
+    header.imageSize = offset;
+
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    out.close();
+
+    std::error_code error;
+    if (out.fail())
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    return !error;
+}
+
+// Builds the tree along the visited paths. Indexed containers are created empty,
+// and any other value is parsed from its own span of the file.
+class IndexLoader : public JSONNodeLoader
+{
+    const std::string filename;
+    MappedFile index;
+    MappedFile source;      // Only the visited parts of the file are actually read
+
+    // Guards the contents of containers which are not expanded yet,
+    // and the list of regions.
+    std::mutex mutex;
+
+    // Parsed parts of the file. Kept as long as nodes may refer to them.
+    std::vector<std::unique_ptr<JSONSource>> regions;
+
+    const offsetindex::Header* Header() const { return (const offsetindex::Header*)index.Data(); }
+
+    const offsetindex::Entry* Entries() const
+    {
+        return (const offsetindex::Entry*)(index.Data() + Header()->entriesOffset);
+    }
+
+    const offsetindex::Child* Children(const offsetindex::Entry& entry) const
+    {
+        return (const offsetindex::Child*)(index.Data() + entry.childrenOffset);
+    }
+
+    std::string_view KeyAt(uint64_t offset) const
+    {
+        const uint64_t* length = (const uint64_t*)(index.Data() + offset);
+        return std::string_view((const char*)(length + 1), *length);
+    }
+
+    // Trim a part of the file, so it can be parsed.
+    JSONString Region(uint64_t begin, uint64_t end)
+    {
+        regions.push_back(std::make_unique<JSONSource>(filename,
+            std::string(source.Data() + begin, end - begin), begin));
+        return regions.back()->GetString();
+    }
+
+    // Entry of the container beginning at the offset, or nullptr if it is not indexed.
+    const offsetindex::Entry* FindEntry(uint64_t begin) const
+    {
+        const offsetindex::Entry* first = Entries();
+        const offsetindex::Entry* last = first + Header()->entryCount;
+
+        const offsetindex::Entry* entry = std::lower_bound(first, last, begin,
+            [](const offsetindex::Entry& e, uint64_t offset) { return e.begin < offset; });
+
+        return (entry != last && entry->begin == begin) ? entry : nullptr;
+    }
+
+    // Whether the i-th child was already added to the container.
+    bool IsLoaded(JSON::JSONContainer* container, const offsetindex::Child& child, uint64_t i) const
+    {
+        if (container->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+        {
+            return ((JSON::JSONObject*)container)->FindLoaded(std::string(KeyAt(child.keyOffset))) != nullptr;
+        }
+        return ((JSON::JSONList*)container)->FindLoaded(i) != nullptr;
+    }
+
+    JSON::JSONNode* CreateChild(const offsetindex::Child& child, JSON::JSONNode* parent);
+
+public:
+    IndexLoader(const std::string& filename) : filename(filename),
+        index(offsetindex::SidecarPath(filename)), source(filename) { }
+
+    // Checks that the index matches the file.
+    bool IsValid(const snapshot::SourceKey& key) const;
+
+    JSON::JSONObject* CreateRoot();
+
+    void Expand(JSON::JSONContainer* container, uint64_t ref) override;
+    JSON::JSONNode* FindMember(JSON::JSONObject* object, uint64_t ref, const std::string& identifier) override;
+    JSON::JSONNode* FindElement(JSON::JSONList* list, uint64_t ref, size_t index) override;
+
+    std::string_view GetSourceBytes() const override { return std::string_view(source.Data(), source.Size()); }
+};
+
+bool IndexLoader::IsValid(const snapshot::SourceKey& key) const
+{
+    if (!index.IsOpen() || !source.IsOpen() || index.Size() < sizeof(offsetindex::Header)) return false;
+
+    const offsetindex::Header* header = Header();
+    return std::memcmp(header->magic, offsetindex::Magic, sizeof(header->magic)) == 0
+        && header->version == offsetindex::Version
+        && header->key == key
+        && header->imageSize == index.Size()
+        && header->entryCount > 0
+        && header->entriesOffset + header->entryCount * sizeof(offsetindex::Entry) <= index.Size()
+        && source.Size() == key.size
+        && Entries()[0].type == (int32_t)JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT;
+}
+
+JSON::JSONObject* IndexLoader::CreateRoot()
+{
+    JSON::JSONObject* root = new JSON::JSONObject(nullptr);
+    root->SetLoader(this, 0);
+    root->SetSpan(Entries()[0].begin, Entries()[0].end);
+    return root;
+}
+
+JSON::JSONNode* IndexLoader::CreateChild(const offsetindex::Child& child, JSON::JSONNode* parent)
+{
+    // Indexed containers are expanded later
+    if (const offsetindex::Entry* entry = FindEntry(child.begin))
+    {
+        JSON::JSONContainer* container;
+        if (entry->type == (int32_t)JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+        {
+            container = new JSON::JSONObject(parent);
+        }
+        else
+        {
+            container = new JSON::JSONList(parent);
+        }
+        container->SetLoader(this, entry - Entries());
+        container->SetSpan(entry->begin, entry->end);
+        return container;
+    }
+
+    return resolve_json(Region(child.begin, child.end), parent);
+}
+
+// Consecutive children which are neither indexed nor present yet are parsed together,
+// from one region of the file.
+void IndexLoader::Expand(JSON::JSONContainer* container, uint64_t ref)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const offsetindex::Entry& entry = Entries()[ref];
+    const offsetindex::Child* children = Children(entry);
+
+    // The container is only cast to the class of its type
+    bool isObject = container->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT;
+    JSON::JSONObject* object = isObject ? (JSON::JSONObject*)container : nullptr;
+    JSON::JSONList* list = isObject ? nullptr : (JSON::JSONList*)container;
+
+    uint64_t i = 0;
+    while (i < entry.childCount)
+    {
+        const offsetindex::Child& child = children[i];
+
+        if (IsLoaded(container, child, i))
+        {
+            i++;
+            continue;
+        }
+
+        if (FindEntry(child.begin))
+        {
+            JSON::JSONNode* node = CreateChild(child, container);
+            if (isObject) object->Insert(std::string(KeyAt(child.keyOffset)), node);
+            else list->SetElement(i, node, entry.childCount);
+            i++;
+            continue;
+        }
+
+        // Extend the run while the children are neither indexed nor loaded
+        uint64_t last = i;
+        while (last + 1 < entry.childCount
+            && !IsLoaded(container, children[last + 1], last + 1)
+            && !FindEntry(children[last + 1].begin))
+        {
+            last++;
+        }
+
+        JSONString run = Region(child.memberBegin, children[last].end);
+        if (isObject)
+        {
+            resolve_members(run, object);
+        }
+        else
+        {
+            std::vector<JSON::JSONNode*> elements;
+            resolve_elements(run, list, elements);
+            for (size_t k = 0; k < elements.size(); k++)
+            {
+                list->SetElement(i + k, elements[k], entry.childCount);
+            }
+        }
+        i = last + 1;
+    }
+}
+
+// Keys are sorted in the index, so a single member is found by binary search.
+JSON::JSONNode* IndexLoader::FindMember(JSON::JSONObject* object, uint64_t ref, const std::string& identifier)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (JSON::JSONNode* node = object->FindLoaded(identifier)) return node;
+
+    const offsetindex::Entry& entry = Entries()[ref];
+    const offsetindex::Child* children = Children(entry);
+    const uint64_t* begin = (const uint64_t*)(index.Data() + entry.keyOrderOffset);
+    const uint64_t* end = begin + entry.childCount;
+
+    const uint64_t* child = std::lower_bound(begin, end, identifier,
+        [this, children](uint64_t i, const std::string& key)
+        {
+            return KeyAt(children[i].keyOffset) < key;
+        });
+
+    if (child == end || KeyAt(children[*child].keyOffset) != identifier) return nullptr;
+
+    JSON::JSONNode* node = CreateChild(children[*child], object);
+    object->Insert(identifier, node);
+    return node;
+}
+
+JSON::JSONNode* IndexLoader::FindElement(JSON::JSONList* list, uint64_t ref, size_t index)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (JSON::JSONNode* node = list->FindLoaded(index)) return node;
+
+    const offsetindex::Entry& entry = Entries()[ref];
+    if (index >= entry.childCount) return nullptr;
+
+    JSON::JSONNode* node = CreateChild(Children(entry)[index], list);
+    list->SetElement(index, node, entry.childCount);
+    return node;
+}
+
+JSON::JSONObject* offsetindex::Open(const std::string& filename, std::unique_ptr<JSONNodeLoader>& loader)
+{
+    snapshot::SourceKey key;
+    if (!snapshot::GetSourceKey(filename, key)) return nullptr;
+
+    std::unique_ptr<IndexLoader> indexLoader = std::make_unique<IndexLoader>(filename);
+    if (!indexLoader->IsValid(key)) return nullptr;
+
+    JSON::JSONObject* root = indexLoader->CreateRoot();
+    loader = std::move(indexLoader);
+    return root;
+}
@@ -0,0 +1,459 @@
+//          path_filter.cpp
+//
+//  Provides compilation and batch evaluation of filter predicates.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "path_filter.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+// Characters that end a field name or a keyword
+static const std::string FieldEnd = ".[]()=!<>&| ";
+
+static void SkipSpaces(const std::string& source, size_t& pos)
+{
+    while (pos < source.size() && isspace((unsigned char)source[pos])) pos++;
+}
+
+static bool Accept(const std::string& source, size_t& pos, const char* token)
+{
+    SkipSpaces(source, pos);
+
+    size_t length = std::char_traits<char>::length(token);
+    if (source.compare(pos, length, token) != 0) return false;
+
+    pos += length;
+    return true;
+}
+
+size_t JSONFilter::FindEnd(const std::string& source, size_t open)
+{
+    size_t depth = 0;
+    bool inString = false;
+
+    for (size_t pos = open; pos < source.size(); pos++)
+    {
+        const char c = source[pos];
+
+        if (inString)
+        {
+            if (c == '\\') pos++;
+            else if (c == '"') inString = false;
+            continue;
+        }
+
+        if (c == '"') inString = true;
+        if (c == '(') depth++;
+        if (c == ')' && --depth == 0) return pos;
+    }
+    return std::string::npos;
+}
+
+bool JSONFilter::Parse(const std::string& predicate)
+{
+    fields.clear();
+    strings.clear();
+    program.clear();
+
+    size_t pos = 0;
+    if (!ParseOr(predicate, pos)) return false;
+
+    SkipSpaces(predicate, pos);
+    if (pos != predicate.size())
+    {
+        QueryOutput() << "[ERROR] Unexpected \"" << predicate.substr(pos) << "\" in the filter." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool JSONFilter::ParseOr(const std::string& source, size_t& pos)
+{
+    if (!ParseAnd(source, pos)) return false;
+
+    while (Accept(source, pos, "||"))
+    {
+        if (!ParseAnd(source, pos)) return false;
+        program.push_back({ FILTER_OP::FILTER_OP_OR, Operand(), Operand() });
+    }
+    return true;
+}
+
+bool JSONFilter::ParseAnd(const std::string& source, size_t& pos)
+{
+    if (!ParseUnary(source, pos)) return false;
+
+    while (Accept(source, pos, "&&"))
+    {
+        if (!ParseUnary(source, pos)) return false;
+        program.push_back({ FILTER_OP::FILTER_OP_AND, Operand(), Operand() });
+    }
+    return true;
+}
+
+bool JSONFilter::ParseUnary(const std::string& source, size_t& pos)
+{
+    // Not to be taken for "!="
+    SkipSpaces(source, pos);
+    if (source.compare(pos, 1, "!") == 0 && source.compare(pos, 2, "!=") != 0)
+    {
+        pos++;
+        if (!ParseUnary(source, pos)) return false;
+        program.push_back({ FILTER_OP::FILTER_OP_NOT, Operand(), Operand() });
+        return true;
+    }
+
+    if (Accept(source, pos, "("))
+    {
+        if (!ParseOr(source, pos)) return false;
+        if (!Accept(source, pos, ")"))
+        {
+            QueryOutput() << "[ERROR] Missing ')' in the filter." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    return ParseComparison(source, pos);
+}
+
+bool JSONFilter::ParseComparison(const std::string& source, size_t& pos)
+{
+    Instruction instruction;
+    if (!ParseOperand(source, pos, instruction.lhs)) return false;
+
+    // Longer operators first
+    static const std::pair<const char*, FILTER_OP> operators[] =
+    {
+        { "==", FILTER_OP::FILTER_OP_EQUAL },
+        { "!=", FILTER_OP::FILTER_OP_NOT_EQUAL },
+        { "<=", FILTER_OP::FILTER_OP_LESS_EQUAL },
+        { ">=", FILTER_OP::FILTER_OP_GREATER_EQUAL },
+        { "<", FILTER_OP::FILTER_OP_LESS },
+        { ">", FILTER_OP::FILTER_OP_GREATER },
+    };
+
+    for (const auto& [token, op] : operators)
+    {
+        if (!Accept(source, pos, token)) continue;
+
+        instruction.op = op;
+        if (!ParseOperand(source, pos, instruction.rhs)) return false;
+
+        program.push_back(instruction);
+        return true;
+    }
+
+    if (!instruction.lhs.isField)
+    {
+        QueryOutput() << "[ERROR] Expected a comparison in the filter." << std::endl;
+        return false;
+    }
+
+    instruction.op = FILTER_OP::FILTER_OP_EXISTS;
+    program.push_back(instruction);
+    return true;
+}
+
+bool JSONFilter::ParseOperand(const std::string& source, size_t& pos, Operand& operand)
+{
+    SkipSpaces(source, pos);
+    if (pos == source.size())
+    {
+        QueryOutput() << "[ERROR] Unexpected end of the filter." << std::endl;
+        return false;
+    }
+
+    const char c = source[pos];
+
+    // Field of the child, e.g. @.a.b[2]
+    if (c == '@')
+    {
+        pos++;
+
+        JSONPath field;
+        while (pos < source.size() && (source[pos] == '.' || source[pos] == '['))
+        {
+            JSONPathStep step;
+            if (source[pos] == '.')
+            {
+                size_t end = std::min(source.find_first_of(FieldEnd, pos + 1), source.size());
+                step.identifier = source.substr(pos + 1, end - pos - 1);
+                pos = end;
+            }
+            else
+            {
+                size_t end = source.find(']', pos);
+                std::string index = end == std::string::npos ? "" : source.substr(pos + 1, end - pos - 1);
+                if (index.empty() || !std::all_of(index.begin(), index.end(), ::isdigit))
+                {
+                    QueryOutput() << "[ERROR] Fields of a filter take numeric indices only." << std::endl;
+                    return false;
+                }
+
+                step.isIndex = true;
+                step.index = std::stoull(index);
+                pos = end + 1;
+            }
+            field.push_back(step);
+        }
+
+        operand.isField = true;
+        operand.field = std::find(fields.begin(), fields.end(), field) - fields.begin();
+        if (operand.field == fields.size())
+        {
+            fields.push_back(field);
+            caches.emplace_back(field.size());
+        }
+        return true;
+    }
+
+    if (c == '"')
+    {
+        std::string value;
+        for (pos++; pos < source.size() && source[pos] != '"'; pos++)
+        {
+            if (source[pos] == '\\' && pos + 1 < source.size())
+            {
+                pos++;
+                if (source[pos] == 'n') value += '\n';
+                else if (source[pos] == 't') value += '\t';
+                else value += source[pos];
+                continue;
+            }
+            value += source[pos];
+        }
+
+        if (pos == source.size())
+        {
+            QueryOutput() << "[ERROR] Missing '\"' in the filter." << std::endl;
+            return false;
+        }
+        pos++;
+
+        strings.push_back(value);
+        operand.constant.type = FILTER_VALUE::FILTER_VALUE_STRING;
+        operand.constant.string = &strings.back();
+        return true;
+    }
+
+    if (isdigit((unsigned char)c) || c == '-')
+    {
+        const char* begin = source.c_str() + pos;
+        char* end = nullptr;
+        operand.constant.number = std::strtod(begin, &end);
+        if (end == begin)
+        {
+            QueryOutput() << "[ERROR] Invalid number in the filter." << std::endl;
+            return false;
+        }
+
+        pos += end - begin;
+        operand.constant.type = FILTER_VALUE::FILTER_VALUE_NUMBER;
+        return true;
+    }
+
+    size_t end = std::min(source.find_first_of(FieldEnd, pos), source.size());
+    std::string keyword = source.substr(pos, end - pos);
+
+    if (keyword == "true" || keyword == "false")
+    {
+        operand.constant.type = FILTER_VALUE::FILTER_VALUE_BOOL;
+        operand.constant.number = keyword == "true";
+    }
+    else if (keyword == "null")
+    {
+        operand.constant.type = FILTER_VALUE::FILTER_VALUE_NULL;
+    }
+    else
+    {
+        QueryOutput() << "[ERROR] Unexpected \"" << source.substr(pos) << "\" in the filter." << std::endl;
+        return false;
+    }
+
+    pos = end;
+    return true;
+}
+
+FilterValue JSONFilter::Extract(JSON::JSONNode* node, const JSONPath& field, JSON::JSONMemberCache* caches)
+{
+    FilterValue value;
+
+    for (size_t i = 0; i < field.size(); i++)
+    {
+        const JSONPathStep& step = field[i];
+        if (step.isIndex)
+        {
+            if (node->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST) return value;
+
+            JSON::JSONList* list = (JSON::JSONList*)node;
+            if (step.index >= list->Size()) return value;
+            node = list->FindLoaded(step.index);
+        }
+        else
+        {
+            if (node->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT) return value;
+
+            JSON::JSONObject* object = (JSON::JSONObject*)node;
+            object->Expand();
+            node = caches ? object->FindLoaded(step.identifier, caches[i]) : object->FindLoaded(step.identifier);
+            if (!node) return value;
+        }
+    }
+
+    switch (node->GetType())
+    {
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT:
+        value.type = FILTER_VALUE::FILTER_VALUE_NUMBER;
+        value.number = ((JSON::JSONLiteral<int>*)node)->GetValue();
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_DOUBLE:
+        value.type = FILTER_VALUE::FILTER_VALUE_NUMBER;
+        value.number = ((JSON::JSONLiteral<double>*)node)->GetValue();
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_BOOL:
+        value.type = FILTER_VALUE::FILTER_VALUE_BOOL;
+        value.number = ((JSON::JSONLiteral<bool>*)node)->GetValue();
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING:
+        value.type = FILTER_VALUE::FILTER_VALUE_STRING;
+        value.string = &((JSON::JSONLiteral<std::string>*)node)->GetValue();
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_NULL:
+        value.type = FILTER_VALUE::FILTER_VALUE_NULL;
+        break;
+    default:
+        value.type = FILTER_VALUE::FILTER_VALUE_CONTAINER;
+        break;
+    }
+    return value;
+}
+
+static bool Equal(const FilterValue& a, const FilterValue& b)
+{
+    if (a.type != b.type) return false;
+
+    switch (a.type)
+    {
+    case FILTER_VALUE::FILTER_VALUE_NULL:
+        return true;
+    case FILTER_VALUE::FILTER_VALUE_BOOL:
+    case FILTER_VALUE::FILTER_VALUE_NUMBER:
+        return a.number == b.number;
+    case FILTER_VALUE::FILTER_VALUE_STRING:
+        return *a.string == *b.string;
+    default:
+        return false;
+    }
+}
+
+// Ordering of numbers or of strings. order is given the sign of the comparison; values
+// of other or different types are not ordered.
+template <typename Order>
+static bool Ordered(const FilterValue& a, const FilterValue& b, Order order)
+{
+    if (a.type != b.type) return false;
+
+    if (a.type == FILTER_VALUE::FILTER_VALUE_NUMBER) return order(a.number < b.number ? -1 : a.number > b.number ? 1 : 0);
+    if (a.type == FILTER_VALUE::FILTER_VALUE_STRING) return order(a.string->compare(*b.string));
+    return false;
+}
+
+// Compare two columns element by element. A constant is a column whose step is zero.
+template <typename Compare>
+static void CompareColumns(const FilterValue* lhs, size_t lhsStep, const FilterValue* rhs, size_t rhsStep,
+    size_t count, uint8_t* mask, Compare compare)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        mask[i] = compare(lhs[i * lhsStep], rhs[i * rhsStep]);
+    }
+}
+
+void JSONFilter::Evaluate(JSON::JSONNode* const* nodes, size_t count, std::vector<uint8_t>& matches) const
+{
+    // Every field is extracted once for the batch
+    std::vector<std::vector<FilterValue>> columns(fields.size(), std::vector<FilterValue>(count));
+    for (size_t field = 0; field < fields.size(); field++)
+    {
+        for (size_t i = 0; i < count; i++) columns[field][i] = Extract(nodes[i], fields[field], caches[field].data());
+    }
+
+    std::vector<std::vector<uint8_t>> stack;
+    for (const Instruction& instruction : program)
+    {
+        if (instruction.op == FILTER_OP::FILTER_OP_AND || instruction.op == FILTER_OP::FILTER_OP_OR)
+        {
+            std::vector<uint8_t> rhs = std::move(stack.back());
+            stack.pop_back();
+            std::vector<uint8_t>& lhs = stack.back();
+
+            if (instruction.op == FILTER_OP::FILTER_OP_AND) for (size_t i = 0; i < count; i++) lhs[i] &= rhs[i];
+            else for (size_t i = 0; i < count; i++) lhs[i] |= rhs[i];
+            continue;
+        }
+
+        if (instruction.op == FILTER_OP::FILTER_OP_NOT)
+        {
+            for (uint8_t& match : stack.back()) match ^= 1;
+            continue;
+        }
+
+        stack.emplace_back(count);
+        uint8_t* mask = stack.back().data();
+
+        const Operand& lhsOperand = instruction.lhs;
+        const Operand& rhsOperand = instruction.rhs;
+        const FilterValue* lhs = lhsOperand.isField ? columns[lhsOperand.field].data() : &lhsOperand.constant;
+        const FilterValue* rhs = rhsOperand.isField ? columns[rhsOperand.field].data() : &rhsOperand.constant;
+        size_t lhsStep = lhsOperand.isField ? 1 : 0;
+        size_t rhsStep = rhsOperand.isField ? 1 : 0;
+
+        switch (instruction.op)
+        {
+        case FILTER_OP::FILTER_OP_EXISTS:
+            for (size_t i = 0; i < count; i++) mask[i] = lhs[i].type != FILTER_VALUE::FILTER_VALUE_MISSING;
+            break;
+        case FILTER_OP::FILTER_OP_EQUAL:
+            CompareColumns(lhs, lhsStep, rhs, rhsStep, count, mask, Equal);
+            break;
+        case FILTER_OP::FILTER_OP_NOT_EQUAL:
+            CompareColumns(lhs, lhsStep, rhs, rhsStep, count, mask, [](const FilterValue& a, const FilterValue& b)
+            {
+                return a.type != FILTER_VALUE::FILTER_VALUE_MISSING && b.type != FILTER_VALUE::FILTER_VALUE_MISSING && !Equal(a, b);
+            });
+            break;
+        case FILTER_OP::FILTER_OP_LESS:
+            CompareColumns(lhs, lhsStep, rhs, rhsStep, count, mask, [](const FilterValue& a, const FilterValue& b)
+            {
+                return Ordered(a, b, [](int order) { return order < 0; });
+            });
+            break;
+        case FILTER_OP::FILTER_OP_LESS_EQUAL:
+            CompareColumns(lhs, lhsStep, rhs, rhsStep, count, mask, [](const FilterValue& a, const FilterValue& b)
+            {
+                return Ordered(a, b, [](int order) { return order <= 0; });
+            });
+            break;
+        case FILTER_OP::FILTER_OP_GREATER:
+            CompareColumns(lhs, lhsStep, rhs, rhsStep, count, mask, [](const FilterValue& a, const FilterValue& b)
+            {
+                return Ordered(a, b, [](int order) { return order > 0; });
+            });
+            break;
+        case FILTER_OP::FILTER_OP_GREATER_EQUAL:
+            CompareColumns(lhs, lhsStep, rhs, rhsStep, count, mask, [](const FilterValue& a, const FilterValue& b)
+            {
+                return Ordered(a, b, [](int order) { return order >= 0; });
+            });
+            break;
+        default:
+            break;
+        }
+    }
+
+    matches = std::move(stack.back());
+}
@@ -0,0 +1,171 @@
+//          path_index.cpp
+//
+//  Provides the index of the nodes of a tree by their path hashes.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "path_index.h"
+
+#include <vector>
+#include <utility>
+
+JSONPathIndex::JSONPathIndex(JSON::JSONObject* root)
+{
+    Add(root, JSONPathHash());
+}
+
+void JSONPathIndex::Add(JSON::JSONNode* node, const JSONPathHash& path)
+{
+    // Depth-first, without recursion, as the trees may be deep
+    std::vector<std::pair<JSON::JSONNode*, JSONPathHash>> stack = { { node, path } };
+    while (!stack.empty())
+    {
+        auto [node, path] = stack.back();
+        stack.pop_back();
+
+        auto inserted = nodes.insert({ path.hash, { node, path.check } });
+        if (!inserted.second) inserted.first->second.node = nullptr;
+
+        if (!JSON::isContainer(node->GetType())) continue;
+        containerHashes[node] = path;
+
+        if (node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+        {
+            for (const auto& member : ((JSON::JSONObject*)node)->Members())
+            {
+                // Such members are not reachable by a query in the same way, see the header
+                if (member.first.find_first_of(".[") != std::string::npos) continue;
+
+                stack.push_back({ member.second, HashMember(path, member.first.data(), member.first.size()) });
+            }
+        }
+        else
+        {
+            const std::vector<JSON::JSONNode*>& elements = ((JSON::JSONList*)node)->Elements();
+            for (size_t i = 0; i < elements.size(); i++)
+            {
+                stack.push_back({ elements[i], HashElement(path, i) });
+            }
+        }
+    }
+}
+
+void JSONPathIndex::Remove(JSON::JSONNode* node, const JSONPathHash& path)
+{
+    std::vector<std::pair<JSON::JSONNode*, JSONPathHash>> stack = { { node, path } };
+    while (!stack.empty())
+    {
+        auto [node, path] = stack.back();
+        stack.pop_back();
+
+        // A hash of several nodes stays so, and is left to the usual lookup
+        auto entry = nodes.find(path.hash);
+        if (entry != nodes.end() && entry->second.node == node) nodes.erase(entry);
+
+        if (!JSON::isContainer(node->GetType())) continue;
+        containerHashes.erase(node);
+
+        if (node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+        {
+            for (const auto& member : ((JSON::JSONObject*)node)->Members())
+            {
+                if (member.first.find_first_of(".[") != std::string::npos) continue;
+                stack.push_back({ member.second, HashMember(path, member.first.data(), member.first.size()) });
+            }
+        }
+        else
+        {
+            const std::vector<JSON::JSONNode*>& elements = ((JSON::JSONList*)node)->Elements();
+            for (size_t i = 0; i < elements.size(); i++)
+            {
+                stack.push_back({ elements[i], HashElement(path, i) });
+            }
+        }
+    }
+}
+
+template <class Visit>
+void JSONPathIndex::ForChildren(JSON::JSONContainer* container, const JSONPathStep& step, const Visit& visit)
+{
+    // Containers left out of the index have no children in it
+    JSONPathHash path;
+    if (!HashOf(container, path)) return;
+
+    if (step.isIndex)
+    {
+        const std::vector<JSON::JSONNode*>& elements = ((JSON::JSONList*)container)->Elements();
+        for (size_t i = step.index; i < elements.size(); i++) visit(elements[i], HashElement(path, i));
+    }
+    else if (step.identifier.find_first_of(".[") == std::string::npos)
+    {
+        JSON::JSONNode* member = ((JSON::JSONObject*)container)->FindLoaded(step.identifier);
+        if (member) visit(member, HashMember(path, step.identifier.data(), step.identifier.size()));
+    }
+}
+
+void JSONPathIndex::RemoveChildren(JSON::JSONContainer* container, const JSONPathStep& step)
+{
+    ForChildren(container, step, [this](JSON::JSONNode* node, const JSONPathHash& path) { Remove(node, path); });
+}
+
+void JSONPathIndex::AddChildren(JSON::JSONContainer* container, const JSONPathStep& step)
+{
+    ForChildren(container, step, [this](JSON::JSONNode* node, const JSONPathHash& path) { Add(node, path); });
+}
+
+bool JSONPathIndex::HashQuery(const std::string& query, JSONPathHash& path)
+{
+    size_t pos = 0;
+    while (pos < query.size())
+    {
+        if (query[pos] == '[')
+        {
+            size_t close = query.find(']', pos);
+            if (close == std::string::npos || close == pos + 1) return false;
+
+            // Only canonical numbers, as "03" is the same index as "3"
+            if (query[pos + 1] == '0' && close > pos + 2) return false;
+            for (size_t i = pos + 1; i < close; i++)
+            {
+                if (query[i] < '0' || query[i] > '9') return false;
+            }
+
+            path.Continue(query.data() + pos, close - pos + 1);
+            pos = close + 1;
+            continue;
+        }
+
+        // Identifier, after a dot unless it is the first one
+        if (query[pos] == '.')
+        {
+            if (pos == 0) return false;
+            pos++;
+        }
+
+        size_t end = query.find_first_of(".[", pos);
+        if (end == std::string::npos) end = query.size();
+        if (end == pos) return false;
+
+        path = HashMember(path, query.data() + pos, end - pos);
+        pos = end;
+    }
+    return true;
+}
+
+bool JSONPathIndex::HashOf(const JSON::JSONNode* container, JSONPathHash& path) const
+{
+    auto entry = containerHashes.find(container);
+    if (entry == containerHashes.end()) return false;
+
+    path = entry->second;
+    return true;
+}
+
+bool JSONPathIndex::Find(const JSONPathHash& path, JSON::JSONNode*& node) const
+{
+    auto entry = nodes.find(path.hash);
+    if (entry == nodes.end() || !entry->second.node || entry->second.check != path.check) return false;
+
+    node = entry->second.node;
+    return true;
+}
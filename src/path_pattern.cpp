@@ -0,0 +1,345 @@
+//          path_pattern.cpp
+//
+//  Provides matching of queries with wildcard and recursive descent steps.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "path_pattern.h"
+#include "utilstr.h"
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+struct JSONPathPattern::Traversal
+{
+    const Visitor& visit;
+    WorkerPool* pool;
+
+    size_t part = 0;            // Part visited by the calling thread
+
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t pending = 0;         // Tasks not finished yet
+    std::string error;          // First error of the tasks
+
+    Traversal(const Visitor& visit, WorkerPool* pool) : visit(visit), pool(pool) { }
+
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return pending == 0; });
+    }
+};
+
+bool JSONPathPattern::IsWildcard(const std::string& source, size_t pos)
+{
+    // Otherwise, it follows an operand
+    return pos == 0 || std::string(".[(,+-*/").find(source[pos - 1]) != std::string::npos;
+}
+
+bool JSONPathPattern::IsPattern(const std::string& query)
+{
+    if (query.find("..") != std::string::npos || query.find("[?(") != std::string::npos) return true;
+
+    for (size_t pos = query.find('*'); pos != std::string::npos; pos = query.find('*', pos + 1))
+    {
+        if (IsWildcard(query, pos)) return true;
+    }
+    return false;
+}
+
+bool JSONPathPattern::Parse(const std::string& query, const IndexResolver& resolveIndex)
+{
+    steps.clear();
+
+    size_t pos = 0;
+    while (pos < query.size())
+    {
+        JSONPatternStep step;
+
+        if (query.compare(pos, 2, "..") == 0)
+        {
+            pos += 2;
+            size_t end = std::min(query.find_first_of(".[", pos), query.size());
+            step.identifier = query.substr(pos, end - pos);
+            pos = end;
+
+            if (step.identifier.empty())
+            {
+                QueryOutput() << "[ERROR] Expected a member name after \"..\"." << std::endl;
+                return false;
+            }
+            step.type = step.identifier == "*" ? PATTERN_STEP::PATTERN_STEP_ANY_DESCENDANT
+                : PATTERN_STEP::PATTERN_STEP_DESCENDANT;
+        }
+        else if (query.compare(pos, 3, "[?(") == 0)
+        {
+            size_t end = JSONFilter::FindEnd(query, pos + 2);
+            if (end == std::string::npos || query.compare(end, 2, ")]") != 0)
+            {
+                QueryOutput() << "[ERROR] Expected \")]\" after the filter." << std::endl;
+                return false;
+            }
+
+            std::shared_ptr<JSONFilter> filter = std::make_shared<JSONFilter>();
+            if (!filter->Parse(query.substr(pos + 3, end - pos - 3))) return false;
+
+            step.type = PATTERN_STEP::PATTERN_STEP_FILTER;
+            step.filter = filter;
+            pos = end + 2;
+        }
+        else if (query[pos] == '[')
+        {
+            std::string index = utilstr::ScanIndex(query, pos);
+            if (index.empty()) return false;
+
+            if (index == "*")
+            {
+                step.type = PATTERN_STEP::PATTERN_STEP_ANY;
+            }
+            else
+            {
+                step.type = PATTERN_STEP::PATTERN_STEP_INDEX;
+                if (std::all_of(index.begin(), index.end(), ::isdigit)) step.index = std::stoull(index);
+                else if (!resolveIndex(index, step.index)) return false;
+            }
+        }
+        else
+        {
+            // Identifiers follow a dot, except for the first one
+            if (query[pos] == '.' && pos != 0) pos++;
+
+            size_t end = std::min(query.find_first_of(".[", pos), query.size());
+            step.identifier = query.substr(pos, end - pos);
+            pos = end;
+
+            if (step.identifier.empty())
+            {
+                QueryOutput() << "[ERROR] Expected a member name." << std::endl;
+                return false;
+            }
+            step.type = step.identifier == "*" ? PATTERN_STEP::PATTERN_STEP_ANY
+                : PATTERN_STEP::PATTERN_STEP_MEMBER;
+        }
+
+        steps.push_back(step);
+    }
+    return true;
+}
+
+size_t JSONPathPattern::ForEach(JSON::JSONNode* from, const Visitor& visit, WorkerPool* pool) const
+{
+    Traversal traversal(visit, pool);
+
+    // Tasks refer to the traversal, so they are waited for in any case
+    try
+    {
+        Visit(from, 0, 0, traversal, true);
+    }
+    catch (...)
+    {
+        traversal.Wait();
+        throw;
+    }
+    traversal.Wait();
+
+    if (!traversal.error.empty()) throw JSONLoadError(traversal.error);
+    return traversal.part + 1;
+}
+
+void JSONPathPattern::Visit(JSON::JSONNode* node, size_t step, size_t part, Traversal& traversal, bool split) const
+{
+    if (split) part = traversal.part;
+
+    if (step == steps.size())
+    {
+        traversal.visit(part, node);
+        return;
+    }
+
+    const JSONPatternStep& current = steps[step];
+    JSON::JSON_NODE_TYPE type = node->GetType();
+    if (JSON::isLiteral(type)) return;
+
+    // Single steps do not print errors for missing children, as many nodes may lack them
+    if (current.type == PATTERN_STEP::PATTERN_STEP_MEMBER)
+    {
+        if (type != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT) return;
+
+        JSON::JSONObject* object = (JSON::JSONObject*)node;
+        object->Expand();
+        if (JSON::JSONNode* child = object->FindLoaded(current.identifier, current.cache)) Visit(child, step + 1, part, traversal, split);
+        return;
+    }
+
+    if (current.type == PATTERN_STEP::PATTERN_STEP_INDEX)
+    {
+        if (type != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST) return;
+
+        JSON::JSONList* list = (JSON::JSONList*)node;
+        if (current.index < list->Size()) Visit(list->FindLoaded(current.index), step + 1, part, traversal, split);
+        return;
+    }
+
+    // Every child is matched against the step
+    JSON::JSONNode* const* children = nullptr;
+    const std::string* const* keys = nullptr;
+    size_t count = 0;
+
+    // Children of objects are gathered only if they are filtered or split between threads
+    struct Members
+    {
+        std::vector<JSON::JSONNode*> children;
+        std::vector<const std::string*> keys;
+    };
+    std::shared_ptr<Members> members;
+
+    if (type == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+    {
+        JSON::JSONObject* object = (JSON::JSONObject*)node;
+        if (current.type != PATTERN_STEP::PATTERN_STEP_FILTER && (!split || object->Size() < ParallelChildren))
+        {
+            for (const auto& member : object->Members())
+            {
+                VisitChild(member.second, &member.first, step, part, traversal, split);
+            }
+            return;
+        }
+
+        members = std::make_shared<Members>();
+        for (const auto& member : object->Members())
+        {
+            members->children.push_back(member.second);
+            members->keys.push_back(&member.first);
+        }
+        children = members->children.data();
+        keys = members->keys.data();
+        count = members->children.size();
+    }
+    else
+    {
+        const std::vector<JSON::JSONNode*>& elements = ((JSON::JSONList*)node)->Elements();
+        children = elements.data();
+        count = elements.size();
+    }
+
+    WorkerPool* pool = traversal.pool;
+    size_t chunks = 0;
+    if (split && pool && pool->Size() > 1 && count >= ParallelChildren && traversal.part + 2 < MaxParts)
+    {
+        // One part is left for the matches that follow
+        chunks = std::min(pool->Size() * 4, MaxParts - traversal.part - 2);
+    }
+
+    if (chunks == 0)
+    {
+        VisitChildren(children, keys, count, step, part, traversal, split);
+        return;
+    }
+
+    // Consecutive children go to consecutive parts, so the order is kept
+    size_t firstPart = traversal.part + 1;
+    traversal.part += chunks + 1;
+    {
+        std::lock_guard<std::mutex> lock(traversal.mutex);
+        traversal.pending += chunks;
+    }
+
+    for (size_t chunk = 0; chunk < chunks; chunk++)
+    {
+        size_t begin = count * chunk / chunks;
+        size_t end = count * (chunk + 1) / chunks;
+
+        pool->Submit([this, &traversal, members, children, keys, begin, end, step, part = firstPart + chunk]()
+        {
+            std::string error;
+            try
+            {
+                VisitChildren(children + begin, keys ? keys + begin : nullptr, end - begin, step, part, traversal, false);
+            }
+            catch (const std::exception& e)
+            {
+                error = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(traversal.mutex);
+            if (traversal.error.empty()) traversal.error = error;
+            if (--traversal.pending == 0) traversal.done.notify_all();
+        });
+    }
+}
+
+void JSONPathPattern::VisitChildren(JSON::JSONNode* const* children, const std::string* const* keys, size_t count,
+    size_t step, size_t part, Traversal& traversal, bool split) const
+{
+    const JSONPatternStep& current = steps[step];
+    if (current.type != PATTERN_STEP::PATTERN_STEP_FILTER)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            VisitChild(children[i], keys ? keys[i] : nullptr, step, part, traversal, split);
+        }
+        return;
+    }
+
+    // The predicate is evaluated for whole batches of children
+    std::vector<uint8_t> matches;
+    for (size_t begin = 0; begin < count; begin += JSONFilter::BatchSize)
+    {
+        size_t size = std::min(JSONFilter::BatchSize, count - begin);
+        current.filter->Evaluate(children + begin, size, matches);
+
+        for (size_t i = 0; i < size; i++)
+        {
+            if (matches[i]) Visit(children[begin + i], step + 1, part, traversal, split);
+        }
+    }
+}
+
+void JSONPathPattern::VisitChild(JSON::JSONNode* child, const std::string* key, size_t step, size_t part,
+    Traversal& traversal, bool split) const
+{
+    const JSONPatternStep& current = steps[step];
+
+    switch (current.type)
+    {
+    case PATTERN_STEP::PATTERN_STEP_ANY:
+        Visit(child, step + 1, part, traversal, split);
+        break;
+    case PATTERN_STEP::PATTERN_STEP_ANY_DESCENDANT:
+        Visit(child, step + 1, part, traversal, split);
+        Visit(child, step, part, traversal, split);
+        break;
+    case PATTERN_STEP::PATTERN_STEP_DESCENDANT:
+        if (key && *key == current.identifier) Visit(child, step + 1, part, traversal, split);
+        Visit(child, step, part, traversal, split);
+        break;
+    default:
+        break;
+    }
+}
+
+WorkerPool& QueryPool()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+bool MatchPattern(const std::string& query, JSONInterface& jsonInterface, const JSONPathPattern::Visitor& visit)
+{
+    JSONPathPattern pattern;
+    bool valid = pattern.Parse(query, [&jsonInterface](const std::string& indexQuery, size_t& index)
+    {
+        return jsonInterface.EvaluateIndex(indexQuery, index);
+    });
+    if (!valid) return false;
+
+    // Any change under the selected object may change the matches
+    if (jsonInterface.accessed) jsonInterface.accessed->push_back(jsonInterface.currentObject);
+
+    pattern.ForEach(jsonInterface.currentObject, visit, &QueryPool());
+    return true;
+}
@@ -0,0 +1,183 @@
+//          progressive.cpp
+//
+//  Provides progressive parsing, with large containers parsed in the background.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "progressive.h"
+#include "worker_pool.h"
+#include "utilstr.h"
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+
+namespace
+{
+    // Parses deferred containers, either on its threads or on the first access.
+    // Their expansion goes through call_once, so a container is parsed only once, and a query
+    // reaching a container that is being parsed in the background waits for it.
+    class ProgressiveLoader : public JSONNodeLoader
+    {
+        const uint64_t threshold;
+
+        std::mutex mutex;
+        std::deque<JSONString> bodies;  // Bodies of deferred containers, with the parentheses
+        std::string error;              // First syntax error, after which nothing is parsed
+
+        std::atomic<bool> cancelled = false;
+
+        WorkerPool pool;
+
+        // Resolve a member or an element, deferring it if it is a large container.
+        JSON::JSONNode* Resolve(JSONString body, JSON::JSONNode* parent);
+
+        // Defer the contents of the container to the given body.
+        void Defer(JSON::JSONContainer* container, JSONString body)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            container->SetLoader(this, bodies.size());
+            bodies.push_back(body);
+        }
+
+        // Keep the first error, and throw it as the error of the container being expanded.
+        [[noreturn]] void Fail(std::unique_lock<std::mutex>& lock, const std::string& message)
+        {
+            lock.lock();
+            if (error.empty()) error = message;
+            throw JSONLoadError(error);
+        }
+
+    public:
+        ProgressiveLoader(uint64_t threshold) : threshold(threshold) { }
+
+        // Resolve the members of the root object right away.
+        JSON::JSONObject* ParseRoot(JSONString body);
+
+        void Expand(JSON::JSONContainer* container, uint64_t ref) override;
+
+        void Cancel() override
+        {
+            cancelled.store(true);
+            pool.Wait();
+        }
+    };
+
+    JSON::JSONNode* ProgressiveLoader::Resolve(JSONString body, JSON::JSONNode* parent)
+    {
+        if (cancelled.load(std::memory_order_relaxed)) throw JSONLoadError("Loading cancelled.");
+
+        bool isObject = utilstr::BeginsAndEndsWith(body, '{', '}');
+        bool isList = utilstr::BeginsAndEndsWith(body, '[', ']');
+
+        if ((!isObject && !isList) || body.Size() < threshold)
+        {
+            return resolve_json(body, parent);
+        }
+
+        JSON::JSONContainer* container;
+        if (isObject) container = new JSON::JSONObject(parent);
+        else container = new JSON::JSONList(parent);
+        set_span(container, body);
+
+        Defer(container, body);
+
+        // Containers are never deleted while the loader is working, see Cancel()
+        pool.Submit([this, container]()
+        {
+            if (cancelled.load(std::memory_order_relaxed)) return;
+
+            // An error is kept by Expand(..), and reported when the container is accessed.
+            try
+            {
+                container->Expand();
+            }
+            catch (...) { }
+        });
+        return container;
+    }
+
+    JSON::JSONObject* ProgressiveLoader::ParseRoot(JSONString body)
+    {
+        JSON::JSONObject* root = new JSON::JSONObject(nullptr);
+        set_span(root, body);
+        Defer(root, body);
+
+        try
+        {
+            root->Expand();
+        }
+        catch (...)
+        {
+            Cancel();
+            delete root;
+            throw;
+        }
+        return root;
+    }
+
+    void ProgressiveLoader::Expand(JSON::JSONContainer* container, uint64_t ref)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!error.empty()) throw JSONLoadError(error);
+
+        JSONString body = bodies[ref];
+        lock.unlock();
+
+        body = body.substr(1, body.Size() - 2);
+
+        ValueResolver resolve = [this](JSONString value, JSON::JSONNode* parent)
+        {
+            return Resolve(value, parent);
+        };
+
+        try
+        {
+            if (container->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+            {
+                if (body.Size() == 0)
+                {
+                    body.PrintSyntaxMsg("Expected an expression.");
+                }
+                resolve_members(body, (JSON::JSONObject*)container, resolve);
+            }
+            else if (body.Size() > 0)
+            {
+                // Elements resolved before an error still belong to the list,
+                // as deferred ones may be in use by the threads.
+                std::vector<JSON::JSONNode*> elements;
+                try
+                {
+                    resolve_elements(body, container, elements, resolve);
+                }
+                catch (...)
+                {
+                    for (JSON::JSONNode* element : elements) ((JSON::JSONList*)container)->Append(element);
+                    throw;
+                }
+
+                for (JSON::JSONNode* element : elements) ((JSON::JSONList*)container)->Append(element);
+            }
+        }
+        catch (const JSONLoadError& e)
+        {
+            Fail(lock, e.what());
+        }
+        catch (const std::exception& e)
+        {
+            Fail(lock, std::string("[ERROR] ") + e.what());
+        }
+        catch (...)
+        {
+            Fail(lock, "[ERROR] Unknown error while parsing.");
+        }
+    }
+}
+
+JSON::JSONObject* progressive::Parse(JSONSource& source, uint64_t threshold, std::unique_ptr<JSONNodeLoader>& loader)
+{
+    ProgressiveLoader* progressiveLoader = new ProgressiveLoader(threshold);
+    loader.reset(progressiveLoader);
+
+    return progressiveLoader->ParseRoot(source.GetString());
+}
@@ -0,0 +1,333 @@
+//          projection.cpp
+//
+//  Provides projected parsing, which builds only the nodes on given paths.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "projection.h"
+#include "path_pattern.h"
+
+#include <algorithm>
+#include <cstring>
+
+bool JSONProjection::Add(const std::string& path)
+{
+    JSONPathPattern pattern;
+    auto resolveIndex = [](const std::string& query, size_t&)
+    {
+        QueryOutput() << "[ERROR] Indices of projected paths must be numbers, not \"" << query << "\"." << std::endl;
+        return false;
+    };
+    if (!pattern.Parse(path, resolveIndex)) return false;
+
+    Step* step = &root;
+    for (const JSONPatternStep& patternStep : pattern.Steps())
+    {
+        switch (patternStep.type)
+        {
+        case PATTERN_STEP::PATTERN_STEP_MEMBER:
+        {
+            auto found = std::find_if(step->members.begin(), step->members.end(),
+                [&patternStep](const auto& member) { return member.first == patternStep.identifier; });
+            if (found == step->members.end())
+            {
+                step->members.emplace_back(patternStep.identifier, std::make_unique<Step>());
+                found = step->members.end() - 1;
+            }
+            step = found->second.get();
+            break;
+        }
+        case PATTERN_STEP::PATTERN_STEP_INDEX:
+        {
+            auto found = std::find_if(step->indices.begin(), step->indices.end(),
+                [&patternStep](const auto& element) { return element.first == patternStep.index; });
+            if (found == step->indices.end())
+            {
+                step->indices.emplace_back(patternStep.index, std::make_unique<Step>());
+                found = step->indices.end() - 1;
+            }
+            step = found->second.get();
+            break;
+        }
+        case PATTERN_STEP::PATTERN_STEP_ANY:
+            if (!step->any) step->any = std::make_unique<Step>();
+            step = step->any.get();
+            break;
+        default:
+            QueryOutput() << "[ERROR] Only member names, indices and wildcards can be projected." << std::endl;
+            return false;
+        }
+    }
+
+    step->whole = true;
+    return true;
+}
+
+namespace
+{
+    // Steps of the projection that a value is reached by. It may be on several paths at once,
+    // e.g. "a.*.x" and "a.b.y" both go through "a.b".
+    using Steps = std::vector<const JSONProjection::Step*>;
+
+    bool IsWhole(const Steps& steps)
+    {
+        return std::any_of(steps.begin(), steps.end(), [](const JSONProjection::Step* step) { return step->whole; });
+    }
+
+    // Position after the string whose opening quote is at pos, or npos if it is not closed.
+    size_t SkipString(std::string_view text, size_t pos)
+    {
+        while (true)
+        {
+            const void* found = std::memchr(text.data() + pos + 1, '"', text.size() - pos - 1);
+            if (!found) return std::string::npos;
+            pos = (const char*)found - text.data();
+
+            // The quote is not escaped, i.e. preceded by an even number of backslashes
+            size_t backslashes = 0;
+            while (text[pos - 1 - backslashes] == '\\') backslashes++;
+            if (backslashes % 2 == 0) return pos + 1;
+        }
+    }
+
+    // Length of the value at the start of the body: up to the closing parenthesis of an object or a list,
+    // or up to the next ',' outside a string, as ScanListObjectBody(..) and ScanLiteral(..) find it.
+    // Strings are skipped by looking for their closing quote only.
+    size_t ScanValue(JSONString body)
+    {
+        std::string_view text = body.View();
+        if (text.empty()) return 0;
+
+        const char opening = text.front();
+        if (opening != '{' && opening != '[')
+        {
+            size_t i = 0;
+            while (i < text.size() && text[i] != ',')
+            {
+                if (text[i] != '"') i++;
+                else if ((i = SkipString(text, i)) == std::string::npos) return text.size();
+            }
+            return i;
+        }
+
+        size_t depth = 0;
+        size_t i = 0;
+        while (i < text.size())
+        {
+            const char c = text[i];
+            if (c == '"')
+            {
+                i = SkipString(text, i);
+                if (i == std::string::npos) break;
+                continue;
+            }
+
+            if (c == '{' || c == '[') depth++;
+            else if ((c == '}' || c == ']') && --depth == 0)
+            {
+                if (c != (opening == '{' ? '}' : ']'))
+                {
+                    body.PrintSyntaxMsg("Parentheses mismatch.", SYNTAX_MSG_TYPE_ERROR, i);
+                }
+                return i + 1;
+            }
+            i++;
+        }
+
+        body.PrintSyntaxMsg("No closing parentheses found.", SYNTAX_MSG_TYPE_ERROR, text.size() - 1);
+        return text.size();
+    }
+
+    // Whether the value is built: it is on a path, and is either a container or the end of a path.
+    bool IsBuilt(const Steps& steps, JSONString value)
+    {
+        return !steps.empty() && (value.front() == '{' || value.front() == '[' || IsWhole(steps));
+    }
+
+    JSON::JSONNode* Resolve(JSONString body, JSON::JSONNode* parent, const Steps& steps);
+
+    void ResolveMembers(JSONString body, JSON::JSONObject* object, const Steps& steps)
+    {
+        const bool keepsLastDuplicate = KeepsLastDuplicate(body.GetSource()->GetPolicy());
+        Steps matched;
+
+        do
+        {
+            body.GetSource()->ReportProgress(body.GetOffset());
+            JSONString member = body;
+
+            std::string_view text = body.View();
+            size_t keyEnd = text.empty() || text.front() != '"' ? std::string::npos : SkipString(text, 0);
+            if (keyEnd == std::string::npos || keyEnd == 2)
+            {
+                body.PrintSyntaxMsg("Expected valid identifier.");
+                return;
+            }
+
+            // Keys without escape sequences are compared as they are in the text
+            std::string_view key = text.substr(1, keyEnd - 2);
+            std::string decoded;
+            if (key.find('\\') != std::string_view::npos)
+            {
+                size_t pos = 0;
+                decoded = body.ScanString(pos);
+                key = decoded;
+            }
+
+            matched.clear();
+            for (const JSONProjection::Step* step : steps)
+            {
+                for (const auto& projected : step->members)
+                {
+                    if (projected.first == key) matched.push_back(projected.second.get());
+                }
+                if (step->any) matched.push_back(step->any.get());
+            }
+
+            body = body.substr(keyEnd);
+            if (body.Size() == 0 || body.front() != ':')
+            {
+                body.PrintSyntaxMsg("Expected ':'.");
+                return;
+            }
+            body = body.substr(1);
+
+            size_t end = ScanValue(body);
+            if (end == 0)
+            {
+                body.PrintSyntaxMsg("Expected a value.");
+                return;
+            }
+
+            // Members off the paths are not added at all, so only the projected ones are checked for uniqueness
+            JSONString value = body.substr(0, end);
+            if (IsBuilt(matched, value))
+            {
+                std::string id(key);
+                bool duplicate = !object->Insert(id, nullptr);
+                if (duplicate && !keepsLastDuplicate)
+                {
+                    member.PrintSyntaxMsg("Identifier is not unique.");
+                    return;
+                }
+
+                JSON::JSONNode* node = Resolve(value, object, matched);
+                if (duplicate) delete object->Replace(id, node);
+                else object->LastMember() = node;
+            }
+
+            body = body.substr(end);
+            if (body.Size() == 0) break;
+
+            if (body.front() != ',')
+            {
+                body.PrintSyntaxMsg("Expected ','.");
+                break;
+            }
+            body = body.substr(1);
+
+        } while (true);
+    }
+
+    void ResolveElements(JSONString body, JSON::JSONNode* parent, std::vector<JSON::JSONNode*>& elements, const Steps& steps)
+    {
+        // Elements past the last projected index are not even scanned, unless all of them are projected
+        bool all = false;
+        size_t count = 0;
+        for (const JSONProjection::Step* step : steps)
+        {
+            if (step->any) all = true;
+            for (const auto& projected : step->indices) count = std::max(count, projected.first + 1);
+        }
+
+        Steps matched;
+        for (size_t index = 0; all || index < count; index++)
+        {
+            body.GetSource()->ReportProgress(body.GetOffset());
+
+            size_t end = ScanValue(body);
+            if (end == 0)
+            {
+                body.PrintSyntaxMsg("Expected a value.");
+                return;
+            }
+
+            matched.clear();
+            for (const JSONProjection::Step* step : steps)
+            {
+                for (const auto& projected : step->indices)
+                {
+                    if (projected.first == index) matched.push_back(projected.second.get());
+                }
+                if (step->any) matched.push_back(step->any.get());
+            }
+
+            JSONString value = body.substr(0, end);
+            if (IsBuilt(matched, value)) elements.push_back(Resolve(value, parent, matched));
+            else elements.push_back(new JSON::JSONNull(parent));
+
+            body = body.substr(end);
+            if (body.Size() == 0) break;
+
+            if (body.front() != ',')
+            {
+                body.PrintSyntaxMsg("Expected ','.");
+                break;
+            }
+            body = body.substr(1);
+        }
+    }
+
+    // Resolve a value that is on the paths of the steps. Containers that are only partly built have
+    // no span, so that they are written from the tree rather than copied from the file (see json_writer.h).
+    JSON::JSONNode* Resolve(JSONString body, JSON::JSONNode* parent, const Steps& steps)
+    {
+        if (IsWhole(steps)) return resolve_json(body, parent);
+
+        if (body.front() == '{')
+        {
+            JSON::JSONObject* object = new JSON::JSONObject(parent);
+            body = body.substr(1, body.Size() - 2);
+
+            if (body.Size() == 0)
+            {
+                body.PrintSyntaxMsg("Expected an expression.");
+            }
+
+            try
+            {
+                ResolveMembers(body, object, steps);
+            }
+            catch (...)
+            {
+                delete object;
+                throw;
+            }
+            return object;
+        }
+
+        JSON::JSONList* list = new JSON::JSONList(parent);
+        body = body.substr(1, body.Size() - 2);
+        if (body.Size() == 0) return list;
+
+        std::vector<JSON::JSONNode*> elements;
+        try
+        {
+            ResolveElements(body, list, elements, steps);
+        }
+        catch (...)
+        {
+            for (JSON::JSONNode* element : elements) delete element;
+            delete list;
+            throw;
+        }
+
+        for (JSON::JSONNode* element : elements) list->Append(element);
+        return list;
+    }
+}
+
+JSON::JSONObject* projection::Parse(JSONSource& source, const JSONProjection& projection)
+{
+    return static_cast<JSON::JSONObject*>(Resolve(source.GetString(), nullptr, { &projection.Root() }));
+}
@@ -4,6 +4,7 @@
 #include "query.h"
 #include "utilstr.h"
 #include "json_parser.h"
+#include "path_pattern.h"
 
 // Input: expression of the form "(A.B[2] - 1.65) * 6 + C.D[A.B[3]]"
 // Tokenization:	1) "(A.B[2] - 1.65) * (6)" ++ "..."
@@ -28,7 +29,8 @@ bool Tokenize(std::string source, std::string& token, size_t& pos)
 		// to the caller
 		if (depth == 0 && i > pos)
 		{
-			if (c == '+' || c == '-' || c == '/' || c == '*')
+			// Wildcards of queries are not operators
+			if (c == '+' || c == '-' || c == '/' || (c == '*' && !JSONPathPattern::IsWildcard(source, i)))
 			{
 				token = source.substr(pos, i - pos);
 				pos = i;
@@ -41,7 +43,7 @@ bool Tokenize(std::string source, std::string& token, size_t& pos)
 	
 	if (depth != 0)
 	{
-		std::cout << "Missing parentheses." << std::endl;
+		QueryOutput() << "Missing parentheses." << std::endl;
 		token = "";
 	}
 
@@ -49,6 +51,88 @@ bool Tokenize(std::string source, std::string& token, size_t& pos)
 	return false;
 }
 
+bool IsExpression(const std::string& input)
+{
+	if (input.empty()) return false;
+	if (isdigit(input[0])) return true;
+
+	size_t depth = 0;
+	bool inString = false;
+	for (size_t i = 0; i < input.size(); i++)
+	{
+		const char c = input.at(i);
+
+		if (inString)
+		{
+			if (c == '\\') i++;
+			else if (c == '"') inString = false;
+			continue;
+		}
+
+		if (c == '"') inString = true;
+		if (c == '[') depth++;
+		if (c == ']') depth--;
+
+		// Operators and functions outside of indices and filters
+		if (depth == 0 && (c == '+' || c == '-' || c == '/' || c == '('
+			|| (c == '*' && !JSONPathPattern::IsWildcard(input, i))))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void ProcessQuery(std::string input, JSONInterface& jsonInterface)
+{
+	// Spaces are kept in the strings of filters
+	utilstr::RemoveCharsOutsideString(input, " \t\n");
+
+	if (IsExpression(input))
+	{
+		Expr expr = Expr(input, jsonInterface);
+		QueryOutput() << expr.Eval().ToString() << std::endl;
+	}
+	// Patterns print every node they match, in the order of the tree
+	else if (JSONPathPattern::IsPattern(input))
+	{
+		std::vector<std::vector<JSON::JSONNode*>> parts(JSONPathPattern::MaxParts);
+		bool valid = MatchPattern(input, jsonInterface, [&parts](size_t part, JSON::JSONNode* node)
+		{
+			parts[part].push_back(node);
+		});
+		if (!valid) return;
+
+		size_t matched = 0;
+		for (const std::vector<JSON::JSONNode*>& part : parts)
+		{
+			for (JSON::JSONNode* node : part)
+			{
+				if (JSON::isLiteral(node->GetType())) QueryOutput() << getLiteralValue(node) << std::endl;
+				else if (node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT) QueryOutput() << "{...}" << std::endl;
+				else QueryOutput() << "[...]" << std::endl;
+			}
+			matched += part.size();
+		}
+		if (matched == 0) QueryOutput() << "No nodes matched." << std::endl;
+	}
+	// If arithmetic is not used, simple data query can be used.
+	else
+	{
+		JSON::JSONNode* node = jsonInterface.tree_walk(input);
+		if (!node) return;
+
+		if (!JSON::isLiteral(node->GetType()))
+		{
+			QueryOutput() << "To view an object or a list, use :current." << std::endl;
+			return;
+		}
+
+		QueryOutput() << getLiteralValue(node) << std::endl;
+		return;
+	}
+}
+
 bool ScanFunction(std::string src, std::string& functionName, std::vector<std::string>& args)
 {
 	size_t argsBegin = 0;
@@ -63,7 +147,7 @@ bool ScanFunction(std::string src, std::string& functionName, std::vector<std::s
 
 	if (src.at(src.size() - 1) != ')')
 	{
-		std::cout << "Invalid function syntax." << std::endl;
+		QueryOutput() << "Invalid function syntax." << std::endl;
 		return false;
 	}
 
@@ -81,13 +165,78 @@ bool ScanFunction(std::string src, std::string& functionName, std::vector<std::s
 	return true;
 }
 
+// Running aggregates of numeric values. A traversal keeps one for each of its parts,
+// which are merged in the end, so the values are never gathered.
+struct alignas(64) NumericAggregate
+{
+	size_t nodes = 0;	// Nodes seen, numeric or not
+	size_t count = 0;	// Numeric values
+	Either min, max, sum;
+
+	void Add(const Either& value)
+	{
+		if (count == 0)
+		{
+			min = value;
+			max = value;
+			sum = value;
+		}
+		else
+		{
+			if (value < min) min = value;
+			if (value > max) max = value;
+			sum = Plus(sum, value);
+		}
+		count++;
+	}
+
+	void Merge(const NumericAggregate& other)
+	{
+		nodes += other.nodes;
+		if (other.count == 0) return;
+
+		if (count == 0)
+		{
+			min = other.min;
+			max = other.max;
+			sum = other.sum;
+		}
+		else
+		{
+			if (other.min < min) min = other.min;
+			if (other.max > max) max = other.max;
+			sum = Plus(sum, other.sum);
+		}
+		count += other.count;
+	}
+};
+
+// Aggregate the values matched by a pattern. Returns false if the pattern is invalid.
+static bool AggregatePattern(const std::string& query, JSONInterface& jsonInterface, NumericAggregate& aggregate)
+{
+	std::vector<NumericAggregate> parts(JSONPathPattern::MaxParts);
+
+	bool valid = MatchPattern(query, jsonInterface, [&parts, &jsonInterface](size_t part, JSON::JSONNode* node)
+	{
+		parts[part].nodes++;
+
+		Either value;
+		if (JSON::isNumericLiteral(node->GetType()) && jsonInterface.GetValue(node, value)) parts[part].Add(value);
+	});
+	if (!valid) return false;
+
+	for (const NumericAggregate& part : parts) aggregate.Merge(part);
+	return true;
+}
+
 bool ProcessFunctions(std::string src, JSONInterface& jsonInterface, Either& output)
 {
 	std::vector<std::string> args;
 	std::string function;
 
-	// Not a function
-	if (src.find_first_of('(') == src.npos)
+	// Not a function, also if the parentheses belong to a filter
+	size_t argsBegin = src.find_first_of("([");
+	if (argsBegin == src.npos || src.at(argsBegin) != '(')
 	{
 		return false;
 	}
@@ -96,97 +245,64 @@ bool ProcessFunctions(std::string src, JSONInterface& jsonInterface, Either& out
 
 	// Now, we have a vector with arguments and are ready to process functions.
 
-	if (function == "min" || function == "max")
+	if (function == "min" || function == "max" || function == "sum")
 	{
-		// With one argument, we are processing a list.
+		// With one argument, we are processing a list, or the values matched by a pattern.
 		if (args.size() == 1)
 		{
-			JSON::JSONNode* node = jsonInterface.tree_walk(args[0]);
-			if (!node) return true;
-			if (node->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST)
-			{
-				std::cout << "Expected a list." << std::endl;
-				return true;
-			}
-			JSON::JSONList* list = (JSON::JSONList*)node;
+			NumericAggregate aggregate;
 
-			std::vector<Either> numericElements;
-
-			for (JSON::JSONNode* e : list->elements)
+			if (JSONPathPattern::IsPattern(args[0]))
 			{
-				if (!JSON::isNumericLiteral(e->GetType())) continue;
-
-				Either val;
-				jsonInterface.GetValue(e, val);
-				numericElements.push_back(val);
+				if (!AggregatePattern(args[0], jsonInterface, aggregate)) return true;
 			}
-
-			if (numericElements.size() == 0)
+			else
 			{
-				std::cout << "List empty or does not contain any numeric values." << std::endl;
-				return true;
-			}
+				JSON::JSONNode* node = jsonInterface.tree_walk(args[0]);
+				if (!node) return true;
+				if (node->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST)
+				{
+					QueryOutput() << "Expected a list." << std::endl;
+					return true;
+				}
+				JSON::JSONList* list = (JSON::JSONList*)node;
 
-			if (function == "min")
-			{
-				Either minElement = numericElements[0];
-				for (Either val : numericElements)
+				for (JSON::JSONNode* e : list->Elements())
 				{
-					if (val < minElement) minElement = val;
+					if (!JSON::isNumericLiteral(e->GetType())) continue;
+
+					Either val;
+					jsonInterface.GetValue(e, val);
+					aggregate.Add(val);
 				}
-				output = minElement;
-				return true;
 			}
 
-			if (function == "max")
+			if (aggregate.count == 0)
 			{
-				Either maxElement = numericElements[0];
-				for (Either val : numericElements)
-				{
-					if (val > maxElement) maxElement = val;
-				}
-				output = maxElement;
+				QueryOutput() << "List empty or does not contain any numeric values." << std::endl;
 				return true;
 			}
 
+			if (function == "min") output = aggregate.min;
+			if (function == "max") output = aggregate.max;
+			if (function == "sum") output = aggregate.sum;
 			return true;
 		}
 
 		// With more arguments, we are processing literals
 		else
 		{
-			std::vector<Either> elements;
+			NumericAggregate aggregate;
 
 			for (std::string arg : args)
 			{
 				Expr expr(arg, jsonInterface);
-				elements.push_back(expr.Eval());
-			}
-
-			if (function == "min")
-			{
-				Either minValue = elements[0];
-
-				for (Either e : elements)
-				{
-					if (e < minValue) minValue = e;
-				}
-				output = minValue;
-				return true;
-			}
-
-			if (function == "max")
-			{
-				Either maxValue = elements[0];
-
-				for (Either e : elements)
-				{
-					if (e > maxValue) maxValue = e;
-				}
-				output = maxValue;
-				return true;
+				aggregate.Add(expr.Eval());
 			}
 
+			if (function == "min") output = aggregate.min;
+			if (function == "max") output = aggregate.max;
+			if (function == "sum") output = aggregate.sum;
 			return true;
 		}
 	}
@@ -194,7 +310,15 @@ bool ProcessFunctions(std::string src, JSONInterface& jsonInterface, Either& out
 	{
 		if (args.size() < 1)
 		{
-			std::cout << "Provide an object, list or string." << std::endl;
+			QueryOutput() << "Provide an object, list or string." << std::endl;
+			return true;
+		}
+
+		// Number of nodes matched by a pattern
+		if (JSONPathPattern::IsPattern(args[0]))
+		{
+			NumericAggregate aggregate;
+			if (AggregatePattern(args[0], jsonInterface, aggregate)) output = Either((int)aggregate.nodes);
 			return true;
 		}
 
@@ -212,18 +336,18 @@ bool ProcessFunctions(std::string src, JSONInterface& jsonInterface, Either& out
 		if (node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
 		{
 			JSON::JSONObject* obj = (JSON::JSONObject*)node;
-			output = Either((int)obj->members.size());
+			output = Either((int)obj->Size());
 			return true;
 		}
 		if (node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST)
 		{
 			JSON::JSONList* list = (JSON::JSONList*)node;
-			output = Either((int)list->elements.size());
+			output = Either((int)list->Size());
 			return true;
 		}
 		else
 		{
-			std::cout << "Expected an object, list or string." << std::endl;
+			QueryOutput() << "Expected an object, list or string." << std::endl;
 			return true;
 		}
 
@@ -248,7 +372,7 @@ Expr::Expr(std::string body, JSONInterface& jsonInterface)
 	
 	if (token == "")
 	{
-		std::cout << "Invalid token." << std::endl;
+		QueryOutput() << "Invalid token." << std::endl;
 		return;
 	}
 
@@ -268,7 +392,7 @@ Expr::Expr(std::string body, JSONInterface& jsonInterface)
 		{
 			if (!utilstr::GetNumLiteralValue(token, value))
 			{
-				std::cout << "Invalid numeric literal." << std::endl;
+				QueryOutput() << "Invalid numeric literal." << std::endl;
 				return;
 			}
 			OpCode = EXPR_OP_CONST;
@@ -286,11 +410,17 @@ Expr::Expr(std::string body, JSONInterface& jsonInterface)
 		// Process numeric JSON queries
 		else
 		{
+			if (JSONPathPattern::IsPattern(token))
+			{
+				QueryOutput() << "\"" << token << "\" may match several values. Use min, max, sum or size." << std::endl;
+				return;
+			}
+
 			JSON::JSONNode* node = jsonInterface.tree_walk(token);
 
 			if (!node)
 			{
-				std::cout << "Element not found." << std::endl;
+				QueryOutput() << "Element not found." << std::endl;
 				return;
 			}
 
@@ -312,7 +442,7 @@ Expr::Expr(std::string body, JSONInterface& jsonInterface)
 			}
 			else
 			{
-				std::cout << "Cannot perform operations on non-numeric literals." << std::endl;
+				QueryOutput() << "Cannot perform operations on non-numeric literals." << std::endl;
 				return;
 			}
 		}
@@ -409,7 +539,7 @@ Expr::Expr(std::string body, JSONInterface& jsonInterface)
 		return;
 	}
 
-	std::cout << "Invalid operator \"" << op << "\"." << std::endl;
+	QueryOutput() << "Invalid operator \"" << op << "\"." << std::endl;
 	OpCode = EXPR_OP_INVALID;
 	return;
 }
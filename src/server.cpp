@@ -0,0 +1,438 @@
+//          server.cpp
+//
+//  Provides the query server answering requests over a Unix domain socket.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "server.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+// Events handled by one call to epoll_wait
+static constexpr int MaxEvents = 64;
+
+// Size of the reads from a connection
+static constexpr size_t ReadSize = 64 * 1024;
+
+static void AppendFrame(std::string& output, const std::string& payload)
+{
+    uint32_t size = (uint32_t)payload.size();
+    char header[4] = { (char)(size >> 24), (char)(size >> 16), (char)(size >> 8), (char)size };
+    output.append(header, 4);
+    output += payload;
+}
+
+std::string QueryServerStats::Describe() const
+{
+    char line[160];
+    std::string description;
+
+    std::snprintf(line, sizeof(line), "connections: %zu (%zu open)\n", connections, openConnections);
+    description += line;
+
+    std::snprintf(line, sizeof(line), "requests: %zu (%zu errors, %.1f/s)\n", requests, errors,
+        seconds > 0 ? requests / seconds : 0.0);
+    description += line;
+
+    std::snprintf(line, sizeof(line), "latency: %.1f us average, %.1f us max\n",
+        requests ? totalLatencyMicroseconds / requests : 0.0, maxLatencyMicroseconds);
+    description += line;
+
+    std::snprintf(line, sizeof(line), "bytes: %zu received, %zu sent\n", bytesReceived, bytesSent);
+    description += line;
+    return description;
+}
+
+QueryServer::QueryServer(DocumentRegistry& documents, size_t threadCount)
+    : documents(documents), executor(threadCount)
+{
+}
+
+QueryServer::~QueryServer()
+{
+#if defined(__linux__)
+    for (const auto& connection : connections) close(connection.first);
+    if (listenFd >= 0)
+    {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    if (epollFd >= 0) close(epollFd);
+    if (wakeFd >= 0) close(wakeFd);
+#endif
+}
+
+bool QueryServer::Listen(const std::string& path, std::string& error)
+{
+#if defined(__linux__)
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+    {
+        error = "Invalid socket path \"" + path + "\".";
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // A socket left by a server that did not exit cleanly is replaced, but no other file
+    struct stat status;
+    if (stat(path.c_str(), &status) == 0)
+    {
+        if (!S_ISSOCK(status.st_mode))
+        {
+            error = "\"" + path + "\" exists and is not a socket.";
+            return false;
+        }
+        unlink(path.c_str());
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0 || bind(listenFd, (sockaddr*)&address, sizeof(address)) < 0 || listen(listenFd, SOMAXCONN) < 0)
+    {
+        error = "Cannot listen on \"" + path + "\": " + std::strerror(errno) + ".";
+        if (listenFd >= 0) close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    socketPath = path;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0)
+    {
+        error = std::string("Cannot create the event loop: ") + std::strerror(errno) + ".";
+        return false;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    started = std::chrono::steady_clock::now();
+    return true;
+#else
+    error = "The query server is only available on Linux.";
+    return false;
+#endif
+}
+
+void QueryServer::Run()
+{
+#if defined(__linux__)
+    if (epollFd < 0) return;
+
+    epoll_event events[MaxEvents];
+    std::vector<Request> requests;
+
+    while (!stopping.load())
+    {
+        int count = epoll_wait(epollFd, events, MaxEvents, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == listenFd)
+            {
+                Accept();
+                continue;
+            }
+            if (fd == wakeFd) continue;
+
+            auto found = connections.find(fd);
+            if (found == connections.end()) continue;
+            Connection& connection = found->second;
+
+            bool open = !(events[i].events & EPOLLERR);
+            if (open && (events[i].events & (EPOLLIN | EPOLLHUP))) open = Receive(fd, connection, requests);
+            if (open && (events[i].events & EPOLLOUT)) open = Send(fd, connection);
+
+            // A connection closed by the peer stays until the responses to its requests are sent
+            if (open && connection.closing && connection.waiting == 0 && connection.output.empty()) open = false;
+
+            if (!open)
+            {
+                // Its requests are dropped, as the descriptor may be reused by the next connection
+                requests.erase(std::remove_if(requests.begin(), requests.end(),
+                    [fd](const Request& request) { return request.fd == fd; }), requests.end());
+                CloseConnection(fd);
+            }
+            else if (connection.closing || (events[i].events & EPOLLOUT)) UpdateEvents(fd, connection);
+        }
+
+        if (requests.empty()) continue;
+        Answer(requests);
+
+        // Responses are sent right away, the rest once the sockets accept it.
+        // Requests of a connection are next to each other, as it is read once per pass.
+        for (size_t i = 0; i < requests.size(); i++)
+        {
+            int fd = requests[i].fd;
+            if (i > 0 && requests[i - 1].fd == fd) continue;
+
+            auto found = connections.find(fd);
+            if (found == connections.end()) continue;
+            Connection& connection = found->second;
+
+            if (!Send(fd, connection) || (connection.closing && connection.output.empty())) CloseConnection(fd);
+            else UpdateEvents(fd, connection);
+        }
+        requests.clear();
+    }
+#endif
+}
+
+void QueryServer::Stop()
+{
+    stopping.store(true);
+
+#if defined(__linux__)
+    if (wakeFd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+#endif
+}
+
+QueryServerStats QueryServer::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+
+    QueryServerStats current = stats;
+    current.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return current;
+}
+
+void QueryServer::Accept()
+{
+#if defined(__linux__)
+    while (true)
+    {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        connections[fd] = Connection();
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.connections++;
+        stats.openConnections++;
+    }
+#endif
+}
+
+bool QueryServer::Receive(int fd, Connection& connection, std::vector<Request>& requests)
+{
+#if defined(__linux__)
+    auto now = std::chrono::steady_clock::now();
+
+    // Whole requests are taken as soon as they are read, so that only the last one, if partial, is kept
+    auto take = [&]()
+    {
+        size_t pos = 0;
+        while (connection.input.size() - pos >= 4)
+        {
+            const unsigned char* header = (const unsigned char*)connection.input.data() + pos;
+            uint32_t size = ((uint32_t)header[0] << 24) | ((uint32_t)header[1] << 16) | ((uint32_t)header[2] << 8) | header[3];
+            if (size > MaxRequestSize) return false;
+            if (connection.input.size() - pos - 4 < size) break;
+
+            requests.push_back({ fd, connection.input.substr(pos + 4, size), now });
+            connection.waiting++;
+            pos += 4 + size;
+        }
+        if (pos > 0) connection.input.erase(0, pos);
+        return true;
+    };
+
+    size_t received = 0;
+    bool valid = true;
+    while (valid && !connection.closing)
+    {
+        size_t size = connection.input.size();
+        connection.input.resize(size + ReadSize);
+
+        ssize_t length = read(fd, &connection.input[size], ReadSize);
+        connection.input.resize(size + (length > 0 ? length : 0));
+
+        if (length > 0)
+        {
+            // A request longer than allowed is not read any further, however much the peer sends
+            received += length;
+            valid = take() && connection.input.size() <= MaxRequestSize + 4;
+            continue;
+        }
+        if (length < 0 && errno == EINTR) continue;
+
+        // Requests already read are still answered when the peer stops sending
+        if (length == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) connection.closing = true;
+        break;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.bytesReceived += received;
+    }
+    return valid;
+#else
+    return false;
+#endif
+}
+
+bool QueryServer::Send(int fd, Connection& connection)
+{
+#if defined(__linux__)
+    size_t sent = 0;
+    while (connection.sent < connection.output.size())
+    {
+        ssize_t length = send(fd, connection.output.data() + connection.sent,
+            connection.output.size() - connection.sent, MSG_NOSIGNAL);
+
+        if (length > 0)
+        {
+            connection.sent += length;
+            sent += length;
+            continue;
+        }
+        if (length < 0 && errno == EINTR) continue;
+        if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return false;
+    }
+
+    if (connection.sent == connection.output.size())
+    {
+        connection.output.clear();
+        connection.sent = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.bytesSent += sent;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void QueryServer::UpdateEvents(int fd, const Connection& connection)
+{
+#if defined(__linux__)
+    epoll_event event = {};
+    event.data.fd = fd;
+    if (!connection.closing && connection.output.size() - connection.sent < MaxPendingOutput) event.events |= EPOLLIN;
+    if (!connection.output.empty()) event.events |= EPOLLOUT;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+#endif
+}
+
+void QueryServer::CloseConnection(int fd)
+{
+#if defined(__linux__)
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.openConnections--;
+#endif
+}
+
+void QueryServer::Answer(std::vector<Request>& requests)
+{
+    std::vector<std::string> responses(requests.size());
+
+    // Requests of each document are evaluated together, relative to the object selected in it
+    std::map<JSONInterface*, std::vector<size_t>> byDocument;
+    {
+        std::lock_guard<std::timed_mutex> lock(documents.GetMutex());
+
+        for (size_t i = 0; i < requests.size(); i++)
+        {
+            std::string& query = requests[i].query;
+            if (query == ":stats")
+            {
+                responses[i] = GetStats().Describe();
+                continue;
+            }
+
+            JSONDocument* document = documents.Current();
+            if (!query.empty() && query[0] == '@')
+            {
+                size_t end = std::min(query.find(' '), query.size());
+                std::string name = query.substr(1, end - 1);
+                query.erase(0, end);
+
+                document = documents.Find(name);
+                if (!document)
+                {
+                    responses[i] = "[ERROR] No document named \"" + name + "\".\n";
+                    continue;
+                }
+            }
+            if (!document)
+            {
+                responses[i] = "[ERROR] No document is open.\n";
+                continue;
+            }
+
+            JSONInterface* jsonInterface = document->GetInterface();
+            if (!jsonInterface)
+            {
+                responses[i] = "[ERROR] Document \"" + document->GetName() + "\" is " + document->Describe() + ".\n";
+                continue;
+            }
+            byDocument[jsonInterface].push_back(i);
+        }
+
+        for (const auto& group : byDocument)
+        {
+            std::vector<std::string> queries;
+            for (size_t i : group.second) queries.push_back(std::move(requests[i].query));
+
+            std::vector<std::string> results = executor.Run(*group.first, queries);
+            for (size_t j = 0; j < group.second.size(); j++) responses[group.second[j]] = std::move(results[j]);
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(statsMutex);
+
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        auto found = connections.find(requests[i].fd);
+        if (found != connections.end())
+        {
+            AppendFrame(found->second.output, responses[i]);
+            found->second.waiting--;
+        }
+
+        double latency = std::chrono::duration<double, std::micro>(now - requests[i].received).count();
+        stats.requests++;
+        stats.totalLatencyMicroseconds += latency;
+        if (latency > stats.maxLatencyMicroseconds) stats.maxLatencyMicroseconds = latency;
+        if (responses[i].compare(0, 7, "[ERROR]") == 0) stats.errors++;
+    }
+}
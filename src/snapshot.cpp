@@ -0,0 +1,561 @@
+//          snapshot.cpp
+//
+//  Provides writing and lazy loading of binary JSON snapshots.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "snapshot.h"
+#include "utilstr.h"
+
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <atomic>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(_WIN32)
+
+// No mapping on this platform, the file is read as a whole.
+MappedFile::MappedFile(const std::string& filename, bool sharedMemory)
+{
+    if (sharedMemory) return;
+
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return;
+
+    buffer.resize((size_t)file.tellg());
+    file.seekg(0);
+    file.read(&buffer[0], buffer.size());
+
+    if (!buffer.empty())
+    {
+        data = buffer.data();
+        size = buffer.size();
+    }
+}
+
+MappedFile::~MappedFile() { }
+
+#else
+
+MappedFile::MappedFile(const std::string& filename, bool sharedMemory)
+{
+    int fd = sharedMemory ? shm_open(filename.c_str(), O_RDONLY, 0) : open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* address = mmap(nullptr, (size_t)st.st_size, PROT_READ, sharedMemory ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED)
+        {
+            data = (const char*)address;
+            size = (size_t)st.st_size;
+        }
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data) munmap((void*)data, size);
+}
+
+#endif
+
+std::string snapshot::SidecarPath(const std::string& filename)
+{
+    return filename + ".snap";
+}
+
+bool snapshot::GetSourceKey(const std::string& filename, SourceKey& key)
+{
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(filename, error);
+    if (error) return false;
+
+    auto mtime = std::filesystem::last_write_time(filename, error);
+    if (error) return false;
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    // Hash the beginning and the end of the file. For small files they overlap,
+    // and the whole file is hashed.
+    std::string sample(std::min<uint64_t>(size, SampleSize), '\0');
+    file.read(&sample[0], sample.size());
+    uint64_t hash = utilstr::Hash(sample.data(), sample.size());
+
+    if (size > SampleSize)
+    {
+        file.seekg(size - sample.size());
+        file.read(&sample[0], sample.size());
+        hash = utilstr::Hash(sample.data(), sample.size(), hash);
+    }
+
+    if (!file) return false;
+
+    key.size = size;
+    key.mtime = (int64_t)mtime.time_since_epoch().count();
+    key.hash = hash;
+    return true;
+}
+
+// Streams the tree to the file in post-order: children are written before
+// their parent, so that the parent record can refer to their offsets.
+class SnapshotWriter
+{
+    std::ostream& out;
+    uint64_t offset = 0;
+
+    void Put(const void* bytes, size_t count)
+    {
+        out.write((const char*)bytes, count);
+        offset += count;
+    }
+
+    uint64_t PutRecord(const snapshot::NodeRecord& record)
+    {
+        static const char padding[8] = { };
+        Put(padding, (8 - offset % 8) % 8);
+
+        uint64_t recordOffset = offset;
+        Put(&record, sizeof(record));
+        return recordOffset;
+    }
+
+    uint64_t PutString(const std::string& str)
+    {
+        snapshot::NodeRecord record = { };
+        record.type = (int32_t)JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING;
+        record.count = str.size();
+
+        uint64_t recordOffset = PutRecord(record);
+        Put(str.data(), str.size());
+        return recordOffset;
+    }
+
+public:
+    SnapshotWriter(std::ostream& out) : out(out) { }
+
+    uint64_t WriteNode(JSON::JSONNode* node);
+
+    // Write the image, starting with the header. Returns true on success.
+    bool WriteImage(JSON::JSONObject* root, const snapshot::SourceKey& key)
+    {
+        snapshot::Header header = { };
+        std::memcpy(header.magic, snapshot::Magic, sizeof(header.magic));
+        header.version = snapshot::Version;
+        header.key = key;
+
+        // The header is rewritten once offsets are known.
+        Put(&header, sizeof(header));
+        header.rootOffset = WriteNode(root);
+        header.imageSize = offset;
+
+        out.seekp(0);
+        out.write((const char*)&header, sizeof(header));
+        out.flush();
+
+        return !out.fail();
+    }
+};
+
+uint64_t SnapshotWriter::WriteNode(JSON::JSONNode* node)
+{
+    snapshot::NodeRecord record = { };
+    record.type = (int32_t)node->GetType();
+
+    switch (node->GetType())
+    {
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT:
+    {
+        // Members keep the order of the file, and are followed by their slots sorted by key,
+        // so that a key can be found without reading all of them.
+        std::vector<const std::string*> keys;
+        std::vector<snapshot::MemberEntry> entries;
+        for (const auto& member : ((JSON::JSONObject*)node)->Members())
+        {
+            snapshot::MemberEntry entry;
+            entry.valueOffset = WriteNode(member.second);
+            entry.keyOffset = PutString(member.first);
+            entries.push_back(entry);
+            keys.push_back(&member.first);
+        }
+
+        std::vector<uint64_t> sorted(entries.size());
+        for (size_t i = 0; i < sorted.size(); i++) sorted[i] = i;
+        std::sort(sorted.begin(), sorted.end(), [&keys](uint64_t a, uint64_t b)
+        {
+            return *keys[a] < *keys[b];
+        });
+
+        record.count = entries.size();
+        uint64_t recordOffset = PutRecord(record);
+        Put(entries.data(), entries.size() * sizeof(snapshot::MemberEntry));
+        Put(sorted.data(), sorted.size() * sizeof(uint64_t));
+        return recordOffset;
+    }
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST:
+    {
+        std::vector<uint64_t> elements;
+        for (JSON::JSONNode* element : ((JSON::JSONList*)node)->Elements())
+        {
+            elements.push_back(WriteNode(element));
+        }
+
+        record.count = elements.size();
+        uint64_t recordOffset = PutRecord(record);
+        Put(elements.data(), elements.size() * sizeof(uint64_t));
+        return recordOffset;
+    }
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING:
+        return PutString(((JSON::JSONLiteral<std::string>*)node)->GetValue());
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT:
+        record.intValue = ((JSON::JSONLiteral<int>*)node)->GetValue();
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_DOUBLE:
+        record.doubleValue = ((JSON::JSONLiteral<double>*)node)->GetValue();
+        break;
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_BOOL:
+        record.intValue = ((JSON::JSONLiteral<bool>*)node)->GetValue();
+        break;
+    default:
+        break;
+    }
+
+    return PutRecord(record);
+}
+
+bool snapshot::Write(JSON::JSONObject* root, const std::string& filename)
+{
+    SourceKey key;
+    if (!root || !GetSourceKey(filename, key)) return false;
+
+    std::string path = SidecarPath(filename);
+    std::string tempPath = path + ".tmp";
+
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+
+    SnapshotWriter writer(out);
+    bool written = writer.WriteImage(root, key);
+    out.close();
+
+    if (!written || out.fail())
+    {
+        std::error_code error;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    return !error;
+}
+
+// Creates nodes from a mapped snapshot. Containers are created empty
+// and refer back to the loader, so only the visited part of the tree is built.
+// Offsets and counts are checked against the image where they are read, so a damaged
+// image is found on the access to the damaged part, without reading the rest of it.
+class SnapshotLoader : public JSONNodeLoader
+{
+    MappedFile image;
+    const std::string name;     // Of the file or the segment, for errors
+
+    // Guards the contents of containers which are not expanded yet.
+    // Creating nodes from the image is cheap, so one lock is enough.
+    std::mutex mutex;
+
+    // Bytes of the children of an object: a member entry, and its slot in the order of the keys.
+    static constexpr uint64_t MemberSize = sizeof(snapshot::MemberEntry) + sizeof(uint64_t);
+
+    [[noreturn]] void Damaged() const
+    {
+        throw JSONLoadError("[ERROR] " + name + " - Snapshot is damaged.");
+    }
+
+    // Record at the offset, after the header and within the image. Children are written before
+    // their parent, so they are below its offset, which is the limit, and there are no cycles.
+    const snapshot::NodeRecord* Record(uint64_t offset, uint64_t limit) const
+    {
+        if (offset % 8 != 0 || offset < sizeof(snapshot::Header) || offset >= limit
+            || offset > image.Size() - sizeof(snapshot::NodeRecord))
+        {
+            Damaged();
+        }
+        return (const snapshot::NodeRecord*)(image.Data() + offset);
+    }
+
+    // Record of a container, whose children of the size lie within the image.
+    const snapshot::NodeRecord* Container(uint64_t offset, uint64_t childSize) const
+    {
+        const snapshot::NodeRecord* record = Record(offset, image.Size());
+        if (record->count > (image.Size() - offset - sizeof(snapshot::NodeRecord)) / childSize) Damaged();
+        return record;
+    }
+
+    std::string_view StringAt(uint64_t offset, uint64_t limit) const
+    {
+        const snapshot::NodeRecord* record = Record(offset, limit);
+        if (record->type != (int32_t)JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING
+            || record->count > image.Size() - offset - sizeof(snapshot::NodeRecord))
+        {
+            Damaged();
+        }
+        return std::string_view((const char*)(record + 1), record->count);
+    }
+
+public:
+    SnapshotLoader(const std::string& path, bool sharedMemory = false) : image(path, sharedMemory), name(path) { }
+
+    const MappedFile& Image() const { return image; }
+
+    // Node of the record at the offset, which is below the limit. Throws JSONLoadError if the
+    // record lies outside of the image.
+    JSON::JSONNode* Create(uint64_t offset, uint64_t limit, JSON::JSONNode* parent);
+
+    void Expand(JSON::JSONContainer* container, uint64_t ref) override;
+    JSON::JSONNode* FindMember(JSON::JSONObject* object, uint64_t ref, const std::string& identifier) override;
+    JSON::JSONNode* FindElement(JSON::JSONList* list, uint64_t ref, size_t index) override;
+};
+
+JSON::JSONNode* SnapshotLoader::Create(uint64_t offset, uint64_t limit, JSON::JSONNode* parent)
+{
+    const snapshot::NodeRecord* record = Record(offset, limit);
+
+    switch ((JSON::JSON_NODE_TYPE)record->type)
+    {
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT:
+    {
+        JSON::JSONObject* object = new JSON::JSONObject(parent);
+        object->SetLoader(this, offset);
+        return object;
+    }
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST:
+    {
+        JSON::JSONList* list = new JSON::JSONList(parent);
+        list->SetLoader(this, offset);
+        return list;
+    }
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING:
+        return new JSON::JSONLiteral<std::string>(std::string(StringAt(offset, limit)),
+            JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_STRING, parent);
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT:
+        return new JSON::JSONLiteral<int>((int)record->intValue,
+            JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT, parent);
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_DOUBLE:
+        return new JSON::JSONLiteral<double>(record->doubleValue,
+            JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_DOUBLE, parent);
+    case JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_BOOL:
+        return new JSON::JSONLiteral<bool>(record->intValue != 0,
+            JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_BOOL, parent);
+    default:
+        return new JSON::JSONNull(parent);
+    }
+}
+
+// Children that were found before the expansion are already in the container and are kept.
+void SnapshotLoader::Expand(JSON::JSONContainer* container, uint64_t ref)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (container->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+    {
+        JSON::JSONObject* object = (JSON::JSONObject*)container;
+        const snapshot::NodeRecord* record = Container(ref, MemberSize);
+        const snapshot::MemberEntry* entries = (const snapshot::MemberEntry*)(record + 1);
+
+        // Members found before are taken out, and put back in the order of the file with the others,
+        // so the order of the keys and the shape do not depend on the order of the accesses
+        std::vector<std::string_view> keys(record->count);
+        std::vector<JSON::JSONNode*> nodes(record->count, nullptr);
+        for (uint64_t i = 0; i < record->count; i++)
+        {
+            keys[i] = StringAt(entries[i].keyOffset, ref);
+            if (object->FindLoaded(std::string(keys[i]))) nodes[i] = object->Erase(std::string(keys[i]));
+        }
+
+        for (uint64_t i = 0; i < record->count; i++)
+        {
+            JSON::JSONNode* node = nodes[i] ? nodes[i] : Create(entries[i].valueOffset, ref, object);
+            if (!object->Insert(std::string(keys[i]), node)) delete node;
+        }
+    }
+    else
+    {
+        JSON::JSONList* list = (JSON::JSONList*)container;
+        const snapshot::NodeRecord* record = Container(ref, sizeof(uint64_t));
+        const uint64_t* elements = (const uint64_t*)(record + 1);
+
+        for (uint64_t i = 0; i < record->count; i++)
+        {
+            if (list->FindLoaded(i)) continue;
+            list->SetElement(i, Create(elements[i], ref, list), record->count);
+        }
+    }
+}
+
+// Slots of the members sorted by key follow them, so a single member is found by binary search.
+JSON::JSONNode* SnapshotLoader::FindMember(JSON::JSONObject* object, uint64_t ref, const std::string& identifier)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (JSON::JSONNode* node = object->FindLoaded(identifier)) return node;
+
+    const snapshot::NodeRecord* record = Container(ref, MemberSize);
+    const snapshot::MemberEntry* entries = (const snapshot::MemberEntry*)(record + 1);
+    const uint64_t* begin = (const uint64_t*)(entries + record->count);
+    const uint64_t* end = begin + record->count;
+
+    auto keyOf = [this, entries, record, ref](uint64_t slot)
+    {
+        if (slot >= record->count) Damaged();
+        return StringAt(entries[slot].keyOffset, ref);
+    };
+
+    const uint64_t* slot = std::lower_bound(begin, end, identifier,
+        [&keyOf](uint64_t slot, const std::string& key)
+        {
+            return keyOf(slot) < key;
+        });
+
+    if (slot == end || keyOf(*slot) != identifier) return nullptr;
+
+    JSON::JSONNode* node = Create(entries[*slot].valueOffset, ref, object);
+    object->Insert(identifier, node);
+    return node;
+}
+
+JSON::JSONNode* SnapshotLoader::FindElement(JSON::JSONList* list, uint64_t ref, size_t index)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (JSON::JSONNode* node = list->FindLoaded(index)) return node;
+
+    const snapshot::NodeRecord* record = Container(ref, sizeof(uint64_t));
+    if (index >= record->count) return nullptr;
+
+    const uint64_t* elements = (const uint64_t*)(record + 1);
+    JSON::JSONNode* node = Create(elements[index], ref, list);
+    list->SetElement(index, node, record->count);
+    return node;
+}
+
+// Check the header of the image and create its root object. The source key is only checked if given.
+// The rest of the image is checked as it is read.
+static JSON::JSONObject* OpenImage(std::unique_ptr<SnapshotLoader> snapshotLoader, const snapshot::SourceKey* key,
+    std::unique_ptr<JSONNodeLoader>& loader)
+{
+    using namespace snapshot;
+    const MappedFile& image = snapshotLoader->Image();
+
+    if (!image.IsOpen() || image.Size() < sizeof(Header)) return nullptr;
+
+    // Any mismatch means that the snapshot is stale or was not written by this version.
+    const Header* header = (const Header*)image.Data();
+    if (std::memcmp(header->magic, Magic, sizeof(header->magic)) != 0
+        || header->version != Version
+        || (key && !(header->key == *key))
+        || header->imageSize != image.Size())
+    {
+        return nullptr;
+    }
+
+    // A root out of the image is found before anything is read, so a truncated snapshot is stale as well
+    try
+    {
+        JSON::JSONNode* root = snapshotLoader->Create(header->rootOffset, image.Size(), nullptr);
+        if (root->GetType() != JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_OBJECT)
+        {
+            delete root;
+            return nullptr;
+        }
+        loader = std::move(snapshotLoader);
+        return (JSON::JSONObject*)root;
+    }
+    catch (const JSONLoadError&)
+    {
+        return nullptr;
+    }
+}
+
+JSON::JSONObject* snapshot::Open(const std::string& filename, std::unique_ptr<JSONNodeLoader>& loader)
+{
+    SourceKey key;
+    if (!GetSourceKey(filename, key)) return nullptr;
+
+    return OpenImage(std::make_unique<SnapshotLoader>(SidecarPath(filename)), &key, loader);
+}
+
+std::string snapshot::SegmentName(const std::string& name)
+{
+    return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+
+bool snapshot::Publish(JSON::JSONObject* root, const std::string& name)
+{
+#if defined(_WIN32)
+    return false;
+#else
+    if (!root) return false;
+
+    std::ostringstream out;
+    SnapshotWriter writer(out);
+    if (!writer.WriteImage(root, SourceKey())) return false;
+    std::string image = out.str();
+
+    // A new segment is created rather than overwriting the old one, which may be in use
+    std::string segment = SegmentName(name);
+    shm_unlink(segment.c_str());
+
+    int fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return false;
+
+    void* address = MAP_FAILED;
+    if (ftruncate(fd, (off_t)image.size()) == 0)
+    {
+        address = mmap(nullptr, image.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (address == MAP_FAILED)
+    {
+        shm_unlink(segment.c_str());
+        return false;
+    }
+
+    // The magic is written last, so that a process attaching meanwhile rejects the image
+    char* data = (char*)address;
+    std::memcpy(data + sizeof(Magic), image.data() + sizeof(Magic), image.size() - sizeof(Magic));
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(data, image.data(), sizeof(Magic));
+
+    munmap(address, image.size());
+    return true;
+#endif
+}
+
+bool snapshot::Unpublish(const std::string& name)
+{
+#if defined(_WIN32)
+    return false;
+#else
+    return shm_unlink(SegmentName(name).c_str()) == 0;
+#endif
+}
+
+JSON::JSONObject* snapshot::Attach(const std::string& name, std::unique_ptr<JSONNodeLoader>& loader)
+{
+    return OpenImage(std::make_unique<SnapshotLoader>(SegmentName(name), true), nullptr, loader);
+}
@@ -11,6 +11,8 @@
 #include <fstream>
 #include <iostream>
 #include <math.h>
+#include <climits>
+#include <cstdlib>
 
 //  Replaces all given substrings
 std::string utilstr::ReplaceAll(std::string& str, const std::string& from, const std::string& to)
@@ -74,7 +76,18 @@ std::string utilstr::ReadFromFile(const std::string& filename)
 
     // Get file size
     t.seekg(0, std::ios::end);
-    size_t size = t.tellg();
+    std::streampos end = t.tellg();
+
+    // Pipes have none, and are read in blocks until they end
+    if (end == std::streampos(-1))
+    {
+        t.clear();
+        std::string buffer;
+        char block[64 * 1024];
+        while (t.read(block, sizeof(block)) || t.gcount() > 0) buffer.append(block, (size_t)t.gcount());
+        return buffer;
+    }
+    size_t size = (size_t)end;
 
     // Allocate and read to a string
     std::string buffer(size, ' ');
@@ -100,7 +113,7 @@ bool utilstr::BeginsAndEndsWith(const std::string& str, const char c)
 bool utilstr::BeginsAndEndsWith(JSONString str, const char begins, const char ends)
 {
     if (str.Size() < 2) return false;
-    return (str.at(0) == begins && str.at(str.Size() - 1));
+    return (str.at(0) == begins && str.at(str.Size() - 1) == ends);
 }
 
 bool utilstr::BeginsAndEndsWith(JSONString str, const char c)
@@ -136,7 +149,7 @@ std::string utilstr::ScanIndex(std::string source, size_t& pos)
     if (pos == source.npos)
     {
         std::string errorMsg = "[ERROR] No '[' found.\n";
-        std::cout << errorMsg;
+        QueryOutput() << errorMsg;
         return "";
     }
 
@@ -157,13 +170,13 @@ std::string utilstr::ScanIndex(std::string source, size_t& pos)
             std::string result = source.substr(startPos, i - startPos);
             if (result == "")
             {
-                std::cout << "[ERROR] Enter an index." << std::endl;
+                QueryOutput() << "[ERROR] Enter an index." << std::endl;
             }
             return result;
         }
     }
 
-    std::cout << "[ERROR] No closing parenthesis." << std::endl;
+    QueryOutput() << "[ERROR] No closing parenthesis." << std::endl;
     return "";
 }
 
@@ -290,51 +303,35 @@ bool utilstr::GetNumLiteralValue(std::string src, Either& result)
     //  Otherwise -> INT
 
     // DOUBLE
+    // The whole literal is converted at once, so that parts of any length are read
     if (fractional || (exponent && exponentSign == -1))
     {
-        // This is guaranteed to be non-empty
-        double num = std::stoi(number_str[0]);
-
-        // Add the fractional part if there is one.
-        if (fractional)
-        {
-            double frac = std::stoi(number_str[1]);
-            num += frac / (pow(10, (double)number_str[1].size()));
-        }
-
-        // Apply the sign
-        num *= (float)sign;
-
-        // If we use an exponent
-        if (exponent)
-        {
-            double exp = std::stoi(number_str[2]);
-            exp *= (float)exponentSign;
-            num *= pow(10.0, exp);
-        }
-
-        result = Either(num);
+        result = Either(std::strtod(src.c_str(), nullptr));
         return true;
     }
 
     // INT
     else
     {
-        // This is guaranteed to be non-empty.
-        int num = std::stoi(number_str[0]);
-        num *= sign;
+        // Here, exponent sign is guaranteed to be positive, so the value is
+        // the whole part followed by that many zeros.
+        long long num = 0;
+        bool fits = number_str[2].size() < 10;
+        int exp = fits && exponent ? std::stoi(number_str[2]) : 0;
+
+        for (size_t i = 0; fits && i < number_str[0].size() + exp; i++)
+        {
+            num = num * 10 + (i < number_str[0].size() ? number_str[0][i] - '0' : 0);
+            fits = num <= (long long)INT_MAX + (sign == -1);
+        }
 
-        // If we use an exponent
-        if (exponent)
+        // Numbers out of the range of int are read as double instead
+        if (!fits)
         {
-            // Here, exponent sign is guaranteed to be positive,
-            // so the exponent is calculated this way, since we
-            // want to avoid dealing with double in this case.
-            int exp = std::stoi(number_str[2]);
-            for (int i = 0; i < exp; i++)
-                num *= 10;
+            result = Either(std::strtod(src.c_str(), nullptr));
+            return true;
         }
-        result = Either(num);
+        result = Either((int)(sign * num));
         return true;
     }
 }
@@ -362,6 +359,25 @@ size_t utilstr::FindFirstOfOutsideString(std::string str, std::string target, si
     return str.size();
 }
 
+std::string utilstr::RemoveCharsOutsideString(std::string& str, const std::string& chars)
+{
+    bool inString = false;
+    size_t kept = 0;
+
+    for (size_t _pos = 0; _pos < str.size(); _pos++)
+    {
+        char c = str.at(_pos);
+
+        if (c == '"' && (_pos == 0 || str.at(_pos - 1) != '\\')) inString = !inString;
+
+        if (!inString && Contains(chars, c)) continue;
+        str[kept++] = c;
+    }
+
+    str.resize(kept);
+    return str;
+}
+
 bool utilstr::BeginsWith(std::string str, std::string target, size_t pos)
 {
     if ((str.size() - pos) < target.size()) return false;
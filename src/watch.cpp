@@ -0,0 +1,109 @@
+//          watch.cpp
+//
+//  Provides notifications about modifications of watched files.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "watch.h"
+
+#include <filesystem>
+#include <chrono>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// Time the file has to stay unchanged before the handler is called
+static constexpr int QuietMilliseconds = 100;
+
+// Time between checks for the watcher to stop
+static constexpr int StopCheckMilliseconds = 200;
+
+FileWatcher::FileWatcher(const std::string& filename, Handler onChange)
+    : filename(filename), onChange(onChange)
+{
+#if defined(__linux__)
+    thread = std::thread(&FileWatcher::WatchEvents, this);
+#else
+    thread = std::thread(&FileWatcher::WatchModificationTime, this);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+    stopping.store(true);
+    if (thread.joinable()) thread.join();
+}
+
+void FileWatcher::WatchEvents()
+{
+#if defined(__linux__)
+    // The directory is watched, as editors may replace the file with a new one.
+    std::filesystem::path path = std::filesystem::absolute(filename);
+    std::string directory = path.parent_path().string();
+    std::string name = path.filename().string();
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, directory.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        if (fd >= 0) close(fd);
+        WatchModificationTime();
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    bool modified = false;
+
+    while (!stopping.load())
+    {
+        pollfd request = { fd, POLLIN, 0 };
+        int ready = poll(&request, 1, modified ? QuietMilliseconds : StopCheckMilliseconds);
+
+        if (ready > 0)
+        {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            for (ssize_t pos = 0; pos < length; )
+            {
+                const inotify_event* event = (const inotify_event*)(buffer + pos);
+                if (event->len > 0 && name == event->name) modified = true;
+                pos += sizeof(inotify_event) + event->len;
+            }
+            continue;
+        }
+
+        // No events for a while after a modification
+        if (ready == 0 && modified)
+        {
+            modified = false;
+            onChange(*this);
+        }
+    }
+    close(fd);
+#endif
+}
+
+void FileWatcher::WatchModificationTime()
+{
+    std::error_code error;
+    auto lastWrite = std::filesystem::last_write_time(filename, error);
+
+    while (!stopping.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(StopCheckMilliseconds));
+
+        auto write = std::filesystem::last_write_time(filename, error);
+        if (error || write == lastWrite) continue;
+
+        // Wait until the file stops changing
+        do
+        {
+            lastWrite = write;
+            std::this_thread::sleep_for(std::chrono::milliseconds(QuietMilliseconds));
+            write = std::filesystem::last_write_time(filename, error);
+        } while (!error && write != lastWrite && !stopping.load());
+
+        if (!stopping.load()) onChange(*this);
+    }
+}
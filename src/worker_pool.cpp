@@ -0,0 +1,73 @@
+//          worker_pool.cpp
+//
+//  Provides a pool of threads running background tasks.
+//
+//  (c) Mikalai Varapai, 2026
+
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(size_t threadCount)
+{
+    if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back(&WorkerPool::Work, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        tasks.clear();
+    }
+    available.notify_all();
+
+    for (std::thread& thread : threads) thread.join();
+}
+
+void WorkerPool::Work()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping) return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            running++;
+        }
+
+        // An exception must not end the thread, and tasks report their errors themselves
+        try
+        {
+            task();
+        }
+        catch (...) { }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        running--;
+        if (running == 0 && tasks.empty()) idle.notify_all();
+    }
+}
+
+void WorkerPool::Submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    available.notify_one();
+}
+
+void WorkerPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return running == 0 && tasks.empty(); });
+}
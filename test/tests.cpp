@@ -1,7 +1,32 @@
 #include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <fstream>
+#include <cstring>
+#include <thread>
 #include "json_parser.h"
 #include "utilstr.h"
 #include "query.h"
+#include "snapshot.h"
+#include "offset_index.h"
+#include "documents.h"
+#include "progressive.h"
+#include "path_index.h"
+#include "path_literal.h"
+#include "path_pattern.h"
+#include "batch.h"
+#include "server.h"
+#include "json_patch.h"
+#include "json_writer.h"
+#include "json_validator.h"
+#include "json_binding.h"
+#include "byte_stream.h"
+#include <sstream>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 
 TEST_CASE("Correctly find initial symbol position from trimmed string", "[JSONSource]")
 {
@@ -20,6 +45,168 @@ TEST_CASE("Handle out of bounds input", "[JSONSource]")
 	REQUIRE(source.GetSymbolSourcePosition(1000) == JSONSource::Pos(22, 1));	
 }
 
+TEST_CASE("Map trimmed positions to file offsets", "[JSONSource]")
+{
+	JSONSource source("test1.json");
+	REQUIRE(source.GetFileOffset(0) == 0);
+	REQUIRE(source.GetFileOffset(1) == 4);
+	REQUIRE(source.GetFileOffset(8) == 12);
+}
+
+TEST_CASE("Trim large files in chunks on several threads", "[JSONSource]")
+{
+	// Strings with escaped quotes, backslashes, whitespace and brackets, which chunks may start inside of
+	std::string text = "{\"rows\": [";
+	for (int i = 0; i < 4000; i++)
+	{
+		text += i ? ",\n  " : "\n  ";
+		text += "{\"id\": " + std::to_string(i) + ", \"text\": \"a \\\"[{ b\\\\\", \"path\": \"c:\\\\\\\\x\\\\\",\n\t\"name\": \"caf\xC3\xA9 \\u00e9 ]}\"}";
+	}
+	text += "\n]}";
+
+	auto same = [](const std::string& contents, JSON_PARSE_POLICY policy)
+	{
+		std::ofstream("chunks.json", std::ios::binary) << contents;
+		JSONSource one("chunks.json", nullptr, false, policy, 1);
+		for (size_t threads = 2; threads <= 5; threads++)
+		{
+			JSONSource many("chunks.json", nullptr, false, policy, threads);
+			if (many.GetTrimmed() != one.GetTrimmed() || many.GetInvalidPos() != one.GetInvalidPos()
+				|| many.GetInvalidUtf8Pos() != one.GetInvalidUtf8Pos()) return false;
+			for (size_t pos = 0; pos < one.GetTrimmed().size(); pos += 97)
+			{
+				if (many.GetFileOffset(pos) != one.GetFileOffset(pos)) return false;
+			}
+		}
+		return true;
+	};
+
+	REQUIRE(text.size() > 4 * 64 * 1024);
+	REQUIRE(same(text, JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT));
+	REQUIRE(same(text, JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT));
+	REQUIRE(same(text, JSON_PARSE_POLICY::JSON_PARSE_POLICY_LENIENT));
+
+	// Errors of the policy and nesting that gets too deep in a later chunk
+	std::string deep = text;
+	deep.insert(deep.size() * 3 / 4, std::string(1100, '[') + ", nu ll, \"\x01\xC3(\", ");
+	REQUIRE(same(deep, JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT));
+	REQUIRE(same(deep, JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT));
+
+	JSONSource source("chunks.json", nullptr, false, JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT, 4);
+	REQUIRE(source.GetTrimmed()[source.GetInvalidPos()] == '[');
+
+	std::ofstream("chunks.json", std::ios::binary) << text;
+	JSONLoadOptions options;
+	options.trimThreads = 4;
+	JSON json("chunks.json", options);
+	size_t resolved = 0;
+	JSON::JSONNode* name = json.FindPath({ { false, "rows" }, { true, "", 3999 }, { false, "name" } }, resolved);
+	REQUIRE(resolved == 3);
+	REQUIRE(((JSON::JSONLiteral<std::string>*)name)->GetValue() == "caf\xC3\xA9 \xC3\xA9 ]}");
+
+	std::remove("chunks.json");
+}
+
+// Gzip member of the text, in stored deflate blocks, so that no compressor is needed to write it.
+static std::string StoredGzip(const std::string& text)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	for (unsigned char c : text)
+	{
+		crc ^= c;
+		for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+	crc = ~crc;
+
+	std::string member("\x1F\x8B\x08\x00\x00\x00\x00\x00\x00\xFF", 10);
+	size_t pos = 0;
+	do
+	{
+		size_t size = std::min<size_t>(text.size() - pos, 0xFFFF);
+		member += (char)(pos + size == text.size() ? 1 : 0);
+		for (uint32_t value : { (uint32_t)size, (uint32_t)(size ^ 0xFFFF) })
+		{
+			member += (char)(value & 0xFF);
+			member += (char)(value >> 8 & 0xFF);
+		}
+		member.append(text, pos, size);
+		pos += size;
+	} while (pos < text.size());
+
+	for (uint32_t value : { crc, (uint32_t)text.size() })
+	{
+		for (int shift = 0; shift < 32; shift += 8) member += (char)(value >> shift & 0xFF);
+	}
+	return member;
+}
+
+TEST_CASE("Read compressed files in blocks as they are decompressed", "[JSONSource]")
+{
+	// Larger than a block of the reader, so that trimming goes on over blocks
+	std::string text = "{\"rows\": [";
+	for (int i = 0; i < 24000; i++)
+	{
+		text += i ? ",\n  " : "\n  ";
+		text += "{\"id\": " + std::to_string(i) + ", \"text\": \"a \\\"[{ b\\\\\",\n\t\"name\": \"caf\xC3\xA9 ]}\"}";
+	}
+	text += "\n]}";
+	REQUIRE(text.size() > 1024 * 1024);
+
+	REQUIRE(bytestream::Detect("\x1F\x8B\x08", 3) == JSON_COMPRESSION::JSON_COMPRESSION_GZIP);
+	REQUIRE(bytestream::Detect("\x28\xB5\x2F\xFD", 4) == JSON_COMPRESSION::JSON_COMPRESSION_ZSTD);
+	REQUIRE(bytestream::Detect("{}", 2) == JSON_COMPRESSION::JSON_COMPRESSION_NONE);
+
+	auto same = [](const std::string& contents, JSON_PARSE_POLICY policy)
+	{
+		std::ofstream("stream.json", std::ios::binary) << contents;
+		std::ofstream("stream.json.gz", std::ios::binary) << StoredGzip(contents) + StoredGzip("");
+		JSONSource plain("stream.json", nullptr, false, policy);
+		JSONSource streamed("stream.json.gz", nullptr, false, policy);
+		if (streamed.GetText() != contents || streamed.GetTrimmed() != plain.GetTrimmed()
+			|| streamed.GetInvalidPos() != plain.GetInvalidPos() || streamed.GetInvalidUtf8Pos() != plain.GetInvalidUtf8Pos()) return false;
+		for (size_t pos = 0; pos < plain.GetTrimmed().size(); pos += 97)
+		{
+			if (streamed.GetFileOffset(pos) != plain.GetFileOffset(pos)) return false;
+		}
+		return true;
+	};
+
+	// Builds without zlib only tell that they cannot read the file
+	std::ofstream("stream.json.gz", std::ios::binary) << StoredGzip(text);
+	try
+	{
+		JSONSource source("stream.json.gz");
+	}
+	catch (const JSONLoadError& error)
+	{
+		REQUIRE(std::string(error.what()).find("which this build does not read") != std::string::npos);
+		std::remove("stream.json.gz");
+		return;
+	}
+
+	REQUIRE(same(text, JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT));
+	REQUIRE(same(text, JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT));
+
+	std::string invalid = text;
+	invalid.insert(invalid.size() * 3 / 4, "nu ll, \"\x01\xC3(\", ");
+	REQUIRE(same(invalid, JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT));
+
+	std::ofstream("stream.json.gz", std::ios::binary) << StoredGzip(text);
+	JSON json("stream.json.gz", JSONLoadOptions());
+	size_t resolved = 0;
+	JSON::JSONNode* name = json.FindPath({ { false, "rows" }, { true, "", 23999 }, { false, "name" } }, resolved);
+	REQUIRE(resolved == 3);
+	REQUIRE(((JSON::JSONLiteral<std::string>*)name)->GetValue() == "caf\xC3\xA9 ]}");
+
+	// Members cut short are an error rather than the text read so far
+	std::string member = StoredGzip(text);
+	std::ofstream("stream.json.gz", std::ios::binary) << member.substr(0, member.size() / 2);
+	REQUIRE_THROWS_AS(JSONSource("stream.json.gz", nullptr, false), JSONLoadError);
+
+	std::remove("stream.json");
+	std::remove("stream.json.gz");
+}
+
 TEST_CASE("Basic substring functionality", "[JSONString]")
 {
 	JSONSource source("test1.json");
@@ -130,3 +317,1103 @@ TEST_CASE("Test Tokenize(..)", "[Expr]")
 	REQUIRE(token == str);
 	REQUIRE(pos == str.size());
 }
+
+TEST_CASE("Reopen a file from its snapshot", "[Snapshot]")
+{
+	std::remove(snapshot::SidecarPath("test1.json").c_str());
+	{
+		JSONLoadOptions options;
+		options.useSnapshot = true;
+		JSON json("test1.json", options);
+	}
+
+	std::unique_ptr<JSONNodeLoader> loader;
+	JSON::JSONObject* root = snapshot::Open("test1.json", loader);
+	REQUIRE(root);
+
+	JSON::JSONObject* menu = (JSON::JSONObject*)root->Find("menu");
+	REQUIRE(menu->Find("popup"));
+	REQUIRE(menu->Size() == 3);
+
+	// Members keep the order of the file, whichever was found first
+	std::string keys;
+	for (auto member : menu->Members()) keys += member.first + " ";
+	REQUIRE(keys == "id value popup ");
+
+	JSON::JSONList* items = (JSON::JSONList*)((JSON::JSONObject*)menu->Find("popup"))->Find("menuitem");
+	REQUIRE(items->Size() == 3);
+
+	JSON::JSONNode* value = ((JSON::JSONObject*)items->Find(1))->Find("value");
+	REQUIRE(((JSON::JSONLiteral<std::string>*)value)->GetValue() == "Open");
+
+	delete root;
+}
+
+TEST_CASE("Parse the file again if its snapshot is truncated or damaged", "[Snapshot]")
+{
+	const std::string path = snapshot::SidecarPath("test1.json");
+	std::remove(path.c_str());
+	{
+		JSONLoadOptions options;
+		options.useSnapshot = true;
+		JSON json("test1.json", options);
+	}
+
+	// The header is made to agree with the truncated size, so only the records are out of bounds
+	std::string image;
+	{
+		std::ifstream in(path, std::ios::binary);
+		image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+	const std::string intact = image;
+
+	snapshot::Header header;
+	std::memcpy(&header, image.data(), sizeof(header));
+	image.resize(image.size() / 2);
+	header.imageSize = image.size();
+	std::memcpy(&image[0], &header, sizeof(header));
+	std::ofstream(path, std::ios::binary | std::ios::trunc) << image;
+
+	std::unique_ptr<JSONNodeLoader> loader;
+	REQUIRE(!snapshot::Open("test1.json", loader));
+
+	// The file is parsed instead, and the snapshot written again
+	{
+		JSONLoadOptions options;
+		options.useSnapshot = true;
+		JSON json("test1.json", options);
+		size_t resolved = 0;
+		JSON::JSONNode* value = json.FindPath({ { false, "menu" }, { false, "popup" }, { false, "menuitem" }, { true, "", 1 }, { false, "value" } }, resolved);
+		REQUIRE(((JSON::JSONLiteral<std::string>*)value)->GetValue() == "Open");
+	}
+	JSON::JSONObject* root = snapshot::Open("test1.json", loader);
+	REQUIRE(root);
+	delete root;
+
+	// Other records are checked when they are read: a member past the end is an error of its access
+	image = intact;
+	std::memcpy(&header, image.data(), sizeof(header));
+	snapshot::MemberEntry entry;
+	const size_t entryOffset = header.rootOffset + sizeof(snapshot::NodeRecord);
+	std::memcpy(&entry, image.data() + entryOffset, sizeof(entry));
+	entry.valueOffset = image.size() + 64;
+	std::memcpy(&image[entryOffset], &entry, sizeof(entry));
+	std::ofstream(path, std::ios::binary | std::ios::trunc) << image;
+
+	root = snapshot::Open("test1.json", loader);
+	REQUIRE(root);
+	REQUIRE_THROWS_AS(root->Find("menu"), JSONLoadError);
+	delete root;
+	std::remove(path.c_str());
+}
+
+#if !defined(_WIN32)
+TEST_CASE("Attach to a document published in shared memory", "[Snapshot]")
+{
+	JSON published("test1.json");
+	REQUIRE(published.Publish("json_parser_test"));
+
+	JSONLoadOptions options;
+	options.attachShared = true;
+	JSON json("json_parser_test", options);
+	REQUIRE(!json.CanUpdate());
+
+	size_t resolved = 0;
+	JSON::JSONNode* value = json.FindPath({ { false, "menu" }, { false, "popup" }, { false, "menuitem" },
+		{ true, "", 2 }, { false, "onclick" } }, resolved);
+	REQUIRE(resolved == 5);
+	REQUIRE(((JSON::JSONLiteral<std::string>*)value)->GetValue() == "CloseDoc()");
+
+	// Attached documents keep the segment after it is removed
+	REQUIRE(snapshot::Unpublish("json_parser_test"));
+	json.FindPath({ { false, "menu" }, { false, "value" } }, resolved);
+	REQUIRE(resolved == 2);
+	REQUIRE_THROWS_AS(JSON("json_parser_test", options), JSONLoadError);
+}
+#endif
+
+TEST_CASE("Read values through the offset index", "[OffsetIndex]")
+{
+	std::remove(offsetindex::SidecarPath("test1.json").c_str());
+	{
+		JSONSource source("test1.json");
+		REQUIRE(offsetindex::Write(source, "test1.json", 0));
+	}
+
+	std::unique_ptr<JSONNodeLoader> loader;
+	JSON::JSONObject* root = offsetindex::Open("test1.json", loader);
+	REQUIRE(root);
+
+	// Single lookups do not expand the containers
+	JSON::JSONObject* menu = (JSON::JSONObject*)root->Find("menu");
+	JSON::JSONList* items = (JSON::JSONList*)((JSON::JSONObject*)menu->Find("popup"))->Find("menuitem");
+	JSON::JSONNode* value = ((JSON::JSONObject*)items->Find(2))->Find("onclick");
+	REQUIRE(((JSON::JSONLiteral<std::string>*)value)->GetValue() == "CloseDoc()");
+	REQUIRE(!menu->IsExpanded());
+
+	REQUIRE(menu->Size() == 3);
+	REQUIRE(items->Size() == 3);
+	REQUIRE(menu->IsExpanded());
+
+	delete root;
+}
+
+TEST_CASE("Load documents in the background", "[Documents]")
+{
+	DocumentRegistry documents;
+	REQUIRE(documents.Open("menu", "test1.json"));
+	REQUIRE(documents.Open("missing", "missing.json"));
+	REQUIRE(!documents.Open("menu", "test1.json"));
+
+	// The first document becomes current
+	JSONDocument* menu = documents.Current();
+	REQUIRE(menu->GetName() == "menu");
+	REQUIRE(menu->Wait(std::chrono::seconds(10)));
+	REQUIRE(menu->GetState() == DOCUMENT_STATE::DOCUMENT_STATE_READY);
+	REQUIRE(menu->GetInterface());
+
+	// Errors are kept instead of exiting
+	JSONDocument* missing = documents.Find("missing");
+	REQUIRE(missing->Wait(std::chrono::seconds(10)));
+	REQUIRE(missing->GetState() == DOCUMENT_STATE::DOCUMENT_STATE_FAILED);
+	REQUIRE(!missing->GetInterface());
+	REQUIRE(!missing->GetError().empty());
+
+	REQUIRE(documents.PollFinished().size() == 2);
+	REQUIRE(documents.PollFinished().empty());
+
+	REQUIRE(documents.Close("menu"));
+	REQUIRE(!documents.Current());
+}
+
+TEST_CASE("Query containers before they are parsed", "[Progressive]")
+{
+	// Every container is deferred
+	JSONSource source("test1.json");
+	std::unique_ptr<JSONNodeLoader> loader;
+	JSON::JSONObject* root = progressive::Parse(source, 0, loader);
+	REQUIRE(root->IsExpanded());
+	REQUIRE(root->Contains("menu"));
+
+	JSON::JSONObject* menu = (JSON::JSONObject*)root->Find("menu");
+	JSON::JSONList* items = (JSON::JSONList*)((JSON::JSONObject*)menu->Find("popup"))->Find("menuitem");
+	JSON::JSONNode* value = ((JSON::JSONObject*)items->Find(0))->Find("value");
+	REQUIRE(((JSON::JSONLiteral<std::string>*)value)->GetValue() == "New");
+	REQUIRE(items->Size() == 3);
+
+	loader->Cancel();
+	delete root;
+}
+
+TEST_CASE("Reparse only the changed container", "[Update]")
+{
+	std::ofstream("update.json") << "{\"a\": {\"x\": 1}, \"b\": {\"deep\": {\"k\": 5}}}";
+
+	JSONLoadOptions options;
+	options.exitOnError = false;
+	JSON json("update.json", options);
+	JSONInterface jsonInterface = json.CreateInterface();
+	jsonInterface.Select("b.deep");
+
+	size_t resolved = 0;
+	JSON::JSONNode* untouched = json.FindPath({ { false, "a" } }, resolved);
+
+	JSONPath changed;
+	REQUIRE(!json.Update(changed));
+
+	std::ofstream("update.json") << "{\"a\": {\"x\": 1}, \"b\": {\"deep\": {\"k\": 6, \"l\": 7}}}";
+	REQUIRE(json.Update(changed));
+	REQUIRE(JSON::PathToString(changed) == "b.deep");
+	REQUIRE(json.FindPath({ { false, "a" } }, resolved) == untouched);
+
+	// The selected object is found again by its path
+	REQUIRE(jsonInterface.Rebind(json, { { false, "b" }, { false, "deep" } }));
+	REQUIRE(JSON::PathToString(jsonInterface.GetPath()) == "b.deep");
+
+	JSON::JSONNode* k = json.FindPath({ { false, "b" }, { false, "deep" }, { false, "k" } }, resolved);
+	REQUIRE(((JSON::JSONLiteral<int>*)k)->GetValue() == 6);
+
+	// Errors keep the tree
+	std::ofstream("update.json") << "{\"a\": {\"x\": 1}, \"b\": {\"deep\": {\"k\": }}}";
+	REQUIRE_THROWS_AS(json.Update(changed), JSONLoadError);
+	REQUIRE(json.FindPath({ { false, "b" }, { false, "deep" }, { false, "k" } }, resolved) == k);
+
+	std::remove("update.json");
+}
+
+TEST_CASE("Edit the tree and revert the edits", "[Edit]")
+{
+	JSON json("test1.json");
+	JSONInterface jsonInterface = json.CreateInterface();
+	jsonInterface.Select("menu.popup");
+
+	JSONPath value, first, added;
+	REQUIRE(jsonInterface.ResolvePath("menuitem[1].value", value));
+	REQUIRE(jsonInterface.ResolvePath("menuitem[0]", first));
+	REQUIRE(jsonInterface.ResolvePath("added", added));
+	REQUIRE(JSON::PathToString(value) == "menu.popup.menuitem[1].value");
+
+	REQUIRE(json.Set(value, JSON::ParseValue("\"Opened\"")));
+	REQUIRE(json.Insert(first, JSON::ParseValue("{\"value\": [1, 2.5]}")));
+	REQUIRE(json.Set(added, JSON::ParseValue("true")));
+	REQUIRE(!json.Remove({ { false, "nothing" } }));
+	REQUIRE(!json.CanUpdate());
+	REQUIRE(json.GetVersion() == 3);
+
+	// The inserted element shifted the others
+	size_t resolved = 0;
+	JSON::JSONList* items = (JSON::JSONList*)json.FindPath({ { false, "menu" }, { false, "popup" }, { false, "menuitem" } }, resolved);
+	REQUIRE(items->Size() == 4);
+	JSON::JSONNode* node = json.FindPath({ { false, "menu" }, { false, "popup" }, { false, "menuitem" }, { true, "", 2 }, { false, "value" } }, resolved);
+	REQUIRE(((JSON::JSONLiteral<std::string>*)node)->GetValue() == "Opened");
+
+	REQUIRE(json.Remove(first));
+	REQUIRE(json.ChangesSince(2).size() == 2);
+
+	json.Revert(1);
+	REQUIRE(items->Size() == 3);
+	REQUIRE(!((JSON::JSONObject*)items->GetParent())->Contains("added"));
+
+	json.Revert(0);
+	node = json.FindPath(value, resolved);
+	REQUIRE(((JSON::JSONLiteral<std::string>*)node)->GetValue() == "Open");
+	REQUIRE(json.CanUpdate());
+
+	REQUIRE_THROWS_AS(JSON::ParseValue("{\"a\": "), JSONLoadError);
+}
+
+TEST_CASE("Go back and forth between versions", "[Edit]")
+{
+	std::ofstream("versions.json") << "{\"a\": 1, \"b\": [1, 2], \"c\": 3}";
+	JSON json("versions.json");
+
+	auto keys = [&json]()
+	{
+		std::string keys;
+		for (auto member : json.GetRoot()->Members()) keys += member.first;
+		return keys;
+	};
+
+	REQUIRE(json.Remove({ { false, "a" } }));
+	REQUIRE(json.Set({ { false, "b" }, { true, "", 0 } }, JSON::ParseValue("5")));
+	REQUIRE(json.Set({ { false, "d" } }, JSON::ParseValue("4")));
+	REQUIRE(keys() == "bcd");
+
+	// Removed members come back at their slot
+	json.GoTo(0);
+	REQUIRE(keys() == "abc");
+	REQUIRE(json.GetVersion() == 0);
+	REQUIRE(json.GetLatestVersion() == 3);
+	REQUIRE(json.ChangesSince(2).size() == 2);
+
+	// Undone edits are made again
+	json.GoTo(2);
+	REQUIRE(keys() == "bc");
+	size_t resolved = 0;
+	REQUIRE(((JSON::JSONLiteral<int>*)json.FindPath({ { false, "b" }, { true, "", 0 } }, resolved))->GetValue() == 5);
+	json.GoTo(3);
+	REQUIRE(keys() == "bcd");
+
+	// Another edit drops the undone ones
+	json.GoTo(1);
+	REQUIRE(json.Insert({ { false, "e" } }, JSON::ParseValue("null")));
+	REQUIRE(json.GetLatestVersion() == 2);
+	json.GoTo(3);
+	REQUIRE(json.GetVersion() == 2);
+	REQUIRE(keys() == "bce");
+
+	json.Revert(0);
+	REQUIRE(keys() == "abc");
+	REQUIRE(json.GetLatestVersion() == 0);
+
+	std::remove("versions.json");
+}
+
+TEST_CASE("Apply a JSON Patch as a whole or not at all", "[Patch]")
+{
+	std::ofstream("patch.json") << "{\"a\": {\"b\": [1, 2]}, \"c/d\": \"x\"}";
+	JSON json("patch.json");
+
+	JSONPath path;
+	std::string error;
+	REQUIRE(jsonpatch::ResolvePointer(json, "/a/b/-", path, error));
+	REQUIRE(JSON::PathToString(path) == "a.b[2]");
+	REQUIRE(!jsonpatch::ResolvePointer(json, "/a/b/01", path, error));
+
+	REQUIRE(jsonpatch::Apply(json, "[{\"op\": \"add\", \"path\": \"/a/b/-\", \"value\": 3},"
+		"{\"op\": \"move\", \"from\": \"/c~1d\", \"path\": \"/a/e\"},"
+		"{\"op\": \"copy\", \"from\": \"/a/b\", \"path\": \"/f\"},"
+		"{\"op\": \"test\", \"path\": \"/f\", \"value\": [1, 2.0, 3]}]", error));
+	REQUIRE(json.GetVersion() == 4);
+
+	size_t resolved = 0;
+	JSON::JSONNode* node = json.FindPath({ { false, "a" }, { false, "e" } }, resolved);
+	REQUIRE(((JSON::JSONLiteral<std::string>*)node)->GetValue() == "x");
+	REQUIRE(((JSON::JSONList*)json.FindPath({ { false, "f" } }, resolved))->Size() == 3);
+
+	// The failed test reverts the edits made before it
+	REQUIRE(!jsonpatch::Apply(json, "[{\"op\": \"remove\", \"path\": \"/f\"},"
+		"{\"op\": \"test\", \"path\": \"/a/e\", \"value\": \"y\"}]", error));
+	REQUIRE(error.find("Operation 2 (test)") == 0);
+	REQUIRE(json.GetVersion() == 4);
+	REQUIRE(json.FindPath({ { false, "f" } }, resolved));
+	REQUIRE(resolved == 1);
+
+	REQUIRE(!jsonpatch::Apply(json, "[{\"op\": \"replace\", \"path\": \"/a/b/9\", \"value\": 0}]", error));
+	REQUIRE_THROWS_AS(jsonpatch::Apply(json, "{\"op\": \"remove\"}", error), JSONLoadError);
+}
+
+TEST_CASE("Copy unedited values when writing the tree", "[Writer]")
+{
+	std::string text = "{\n  \"a\": [ 1,  2.50 ],\n  \"b\": {\"c\" : \"x\\ty\"},\n  \"d\": null\n}\n";
+	std::ofstream("writer.json") << text;
+
+	JSONLoadOptions options;
+	options.exitOnError = false;
+	JSON json("writer.json", options);
+
+	std::ostringstream out;
+	JSONWriteStats stats;
+	jsonwriter::Write(json, out, &stats);
+	REQUIRE(out.str() == text);
+	REQUIRE(stats.copiedBytes == text.size());
+
+	// Edited containers keep the whitespace around the other values
+	REQUIRE(json.Set({ { false, "b" }, { false, "c" } }, JSON::ParseValue("[true]")));
+	REQUIRE(json.Insert({ { false, "a" }, { true, "", 1 } }, JSON::ParseValue("\"new\"")));
+	REQUIRE(json.Remove({ { false, "d" } }));
+	out.str("");
+	jsonwriter::Write(json, out, &stats);
+	REQUIRE(out.str() == "{\n  \"a\": [ 1, \"new\",  2.50 ],\n  \"b\": {\"c\" : [true]}\n}\n");
+	REQUIRE(stats.encodedNodes == 6);
+
+	// Spans follow the file when it is reparsed
+	json.Revert(0);
+	text = "{\n\"a\": [ 1,  2.50 ],\n  \"b\": {\"c\" : \"longer\"},\n  \"d\":   null\n}";
+	std::ofstream("writer.json") << text;
+	JSONPath changed;
+	REQUIRE(json.Update(changed));
+	REQUIRE(JSON::PathToString(changed) == "b");
+	out.str("");
+	jsonwriter::Write(json, out, &stats);
+	REQUIRE(out.str().substr(out.str().find("\"b\"")) == text.substr(text.find("\"b\"")));
+
+	std::remove("writer.json");
+}
+
+TEST_CASE("Decode literals on first access", "[Literal]")
+{
+	std::ofstream("literals.json") << "{\"a\": [12, -3.5, 2e-1, 4E2], \"b\": \"plain\", \"c\": \"tab\\there\", \"d\": {\"e\": 1}}";
+
+	JSONLoadOptions options;
+	options.exitOnError = false;
+	JSON json("literals.json", options);
+
+	size_t resolved = 0;
+	JSON::JSONList* a = (JSON::JSONList*)json.FindPath({ { false, "a" } }, resolved);
+	REQUIRE(a->Find(0)->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT);
+	REQUIRE(a->Find(2)->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_DOUBLE);
+	REQUIRE(((JSON::JSONLiteral<double>*)a->Find(1))->GetValue() == -3.5);
+	REQUIRE(((JSON::JSONLiteral<int>*)a->Find(3))->GetValue() == 400);
+
+	JSON::JSONNode* c = json.FindPath({ { false, "c" } }, resolved);
+	REQUIRE(((JSON::JSONLiteral<std::string>*)c)->GetValue() == "tab\there");
+
+	// Values not read yet survive the source of the file being replaced
+	std::ofstream("literals.json") << "{\"a\": [12, -3.5, 2e-1, 4E2], \"b\": \"plain\", \"c\": \"tab\\there\", \"d\": {\"e\": 2}}";
+	JSONPath changed;
+	REQUIRE(json.Update(changed));
+	JSON::JSONNode* b = json.FindPath({ { false, "b" } }, resolved);
+	REQUIRE(((JSON::JSONLiteral<std::string>*)b)->GetValue() == "plain");
+	REQUIRE(((JSON::JSONLiteral<int>*)a->Find(0))->GetValue() == 12);
+
+	std::remove("literals.json");
+}
+
+TEST_CASE("Share the shape of objects with the same keys", "[Shape]")
+{
+	std::ofstream("shapes.json") << "{\"rows\": [{\"id\": 1, \"name\": \"a\"}, {\"id\": 2, \"name\": \"b\"}, {\"name\": \"c\", \"id\": 3}]}";
+
+	JSON json("shapes.json");
+	size_t resolved = 0;
+	JSON::JSONList* rows = (JSON::JSONList*)json.FindPath({ { false, "rows" } }, resolved);
+	JSON::JSONObject* first = (JSON::JSONObject*)rows->Find(0);
+	JSON::JSONObject* second = (JSON::JSONObject*)rows->Find(1);
+	JSON::JSONObject* third = (JSON::JSONObject*)rows->Find(2);
+
+	// Keys in another order make another shape
+	REQUIRE(first->GetShape() == second->GetShape());
+	REQUIRE(first->GetShape() != third->GetShape());
+	REQUIRE(first->GetShape()->IsShared());
+
+	// Members are kept in the order of the file
+	std::vector<std::string> keys;
+	for (const auto& member : third->Members()) keys.push_back(member.first);
+	REQUIRE((keys == std::vector<std::string>{ "name", "id" }));
+
+	// The cache is used for objects of the same shape, and refilled for the others
+	JSON::JSONMemberCache cache;
+	REQUIRE(((JSON::JSONLiteral<int>*)first->FindLoaded("id", cache))->GetValue() == 1);
+	REQUIRE(((JSON::JSONLiteral<int>*)second->FindLoaded("id", cache))->GetValue() == 2);
+	REQUIRE(((JSON::JSONLiteral<int>*)third->FindLoaded("id", cache))->GetValue() == 3);
+	REQUIRE(((JSON::JSONLiteral<int>*)first->FindLoaded("id", cache))->GetValue() == 1);
+
+	// Removing a member moves the object to the shape of the remaining keys
+	REQUIRE(json.Remove({ { false, "rows" }, { true, "", 0 }, { false, "id" } }));
+	REQUIRE(first->Size() == 1);
+	REQUIRE(!first->FindLoaded("id", cache));
+	REQUIRE(first->Find("name"));
+	REQUIRE(second->GetShape()->Size() == 2);
+
+	// Objects with many keys have a shape of their own
+	JSON::JSONObject wide(nullptr);
+	for (uint32_t i = 0; i <= JSON::JSONShape::MaxSize; i++) REQUIRE(wide.Insert("k" + std::to_string(i), nullptr));
+	REQUIRE(!wide.Insert("k0", nullptr));
+	REQUIRE(!wide.GetShape()->IsShared());
+	REQUIRE(wide.Size() == JSON::JSONShape::MaxSize + 1);
+
+	std::remove("shapes.json");
+}
+
+TEST_CASE("Walk trees of any depth without recursion", "[Tree]")
+{
+	std::ofstream("tree.json") << "{\"a\": {\"b\": [1, {\"c\": 2}], \"d\": 3}, \"e\": [[4]]}";
+
+	JSON json("tree.json");
+	size_t resolved = 0;
+	JSON::JSONNode* root = json.FindPath({}, resolved);
+
+	// Keys or indices of the nodes in the order visited, with "/" before the containers visited after their children
+	auto walk = [root](JSON::JSON_TREE_ORDER order, unsigned int maxDepth, const std::string& skipped)
+	{
+		std::string visited;
+		for (JSON::JSONTreeIterator it(root, order, maxDepth); !it.AtEnd(); ++it)
+		{
+			if (!visited.empty()) visited += ' ';
+			if (it.IsExit()) visited += '/';
+			visited += it.Depth() == 0 ? "~" : it.Key() ? *it.Key() : std::to_string(it.Index());
+			if (it.Key() && *it.Key() == skipped && !it.IsExit()) it.SkipChildren();
+		}
+		return visited;
+	};
+	REQUIRE(walk(JSON::JSON_TREE_ORDER::JSON_TREE_ORDER_PRE, UINT32_MAX, "") == "~ a b 0 1 c d e 0 0");
+	REQUIRE(walk(JSON::JSON_TREE_ORDER::JSON_TREE_ORDER_POST, UINT32_MAX, "") == "0 c /1 /b d /a 0 /0 /e /~");
+	REQUIRE(walk(JSON::JSON_TREE_ORDER::JSON_TREE_ORDER_BOTH, UINT32_MAX, "") == "~ a b 0 1 c /1 /b d /a e 0 0 /0 /e /~");
+
+	// Containers past the depth limit, or skipped, are visited without their children
+	REQUIRE(walk(JSON::JSON_TREE_ORDER::JSON_TREE_ORDER_PRE, 1, "") == "~ a b d e 0");
+	REQUIRE(walk(JSON::JSON_TREE_ORDER::JSON_TREE_ORDER_BOTH, UINT32_MAX, "a") == "~ a /a e 0 0 /0 /e /~");
+
+	// Deeper trees than the stack would allow are walked and deleted
+	JSON::JSONList* deep = new JSON::JSONList(nullptr);
+	JSON::JSONList* innermost = deep;
+	for (int i = 0; i < 200000; i++)
+	{
+		JSON::JSONList* list = new JSON::JSONList(innermost);
+		innermost->Append(list);
+		innermost = list;
+	}
+	unsigned int maxDepth = 0;
+	for (JSON::JSONTreeIterator it(deep); !it.AtEnd(); ++it) maxDepth = std::max(maxDepth, it.Depth());
+	REQUIRE(maxDepth == 200000);
+	delete deep;
+
+	// Files nested deeper than the parser goes are an error
+	JSONLoadOptions options;
+	options.exitOnError = false;
+	std::string nested = std::string(MaxNestingDepth - 1, '[') + std::string(MaxNestingDepth - 1, ']');
+	std::ofstream("tree.json") << "{\"a\": " << nested << "}";
+	REQUIRE_NOTHROW(JSON("tree.json", options));
+	std::ofstream("tree.json") << "{\"a\": [" << nested << "]}";
+	REQUIRE_THROWS_AS(JSON("tree.json", options), JSONLoadError);
+	REQUIRE(jsonvalidator::Validate("{\"a\": [" + nested + "], \"b\": [1}").errors == 2);
+
+	std::remove("tree.json");
+}
+
+TEST_CASE("Parse under the strict and lenient policies", "[Policy]")
+{
+	JSONLoadOptions options;
+	options.exitOnError = false;
+	size_t resolved = 0;
+
+	// Strict parsing follows RFC 8259, including '\r' as whitespace and the full escape set
+	std::ofstream("policy.json") << "{\"a\": \"x\\/y\",\r\n \"b\": [0, -1.5e2]}";
+	options.policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT;
+	{
+		JSON json("policy.json", options);
+		REQUIRE(((JSON::JSONLiteral<std::string>*)json.FindPath({ { false, "a" } }, resolved))->GetValue() == "x/y");
+	}
+
+	std::ofstream("policy.json") << "{\"a\": 01}";
+	REQUIRE_THROWS_AS(JSON("policy.json", options), JSONLoadError);
+	std::ofstream("policy.json") << "{\"a\": \"x\ty\"}";
+	REQUIRE_THROWS_AS(JSON("policy.json", options), JSONLoadError);
+	std::ofstream("policy.json") << "{\"a\": \"x\\qy\"}";
+	REQUIRE_THROWS_AS(JSON("policy.json", options), JSONLoadError);
+
+	// Lenient parsing keeps the last of repeated members, and unknown escaped characters
+	std::ofstream("policy.json") << "{\"a\": 1, \"b\": \"x\\qy\", \"a\": {\"c\": 2}}";
+	options.policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_LENIENT;
+	{
+		JSON json("policy.json", options);
+		REQUIRE(json.FindPath({ { false, "a" }, { false, "c" } }, resolved));
+		REQUIRE(((JSON::JSONLiteral<std::string>*)json.FindPath({ { false, "b" } }, resolved))->GetValue() == "xqy");
+	}
+
+	options.policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT;
+	REQUIRE_THROWS_AS(JSON("policy.json", options), JSONLoadError);
+
+	std::remove("policy.json");
+}
+
+TEST_CASE("Validate without building a tree", "[Validator]")
+{
+	JSONValidationReport report = jsonvalidator::Validate("{\"a\": [1, 2.5, {\"b\": null}],\n \"c\": \"x\"}");
+	REQUIRE(report.IsValid());
+	REQUIRE(report.values == 7);
+	REQUIRE(report.maxDepth == 3);
+
+	// Every error is reported, along with its line and column
+	report = jsonvalidator::Validate("{\"a\": [1,, 2],\n \"b\": tru,\n \"a\": 3,\n \"c\" 4}");
+	REQUIRE(report.errors == 4);
+	REQUIRE(report.messages.size() == 4);
+	REQUIRE(report.messages[0].line == 1);
+	REQUIRE(report.messages[0].col == 10);
+	REQUIRE(report.messages[1].line == 2);
+	REQUIRE(report.messages[1].col == 7);
+	REQUIRE(report.messages[2].text == "Identifier is not unique.");
+	REQUIRE(report.messages[3].text == "Expected ':'.");
+
+	// The rules are those of the policy, as for the parser
+	REQUIRE(jsonvalidator::Validate("{\"a\": 01}").IsValid());
+	REQUIRE(!jsonvalidator::Validate("{\"a\": 01}", JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT).IsValid());
+	REQUIRE(jsonvalidator::Validate("{\"a\": 1, \"a\": 2}", JSON_PARSE_POLICY::JSON_PARSE_POLICY_LENIENT).IsValid());
+	REQUIRE(jsonvalidator::Validate("{\"a\": \"\\q\"}").warnings == 1);
+
+	// Numbers the validator accepts load, however long their parts are
+	const std::string numbers = "{\"a\": 52.35006465358306, \"b\": 12345678901, \"c\": -2147483648, \"d\": 1e12}";
+	REQUIRE(jsonvalidator::Validate(numbers).IsValid());
+	std::ofstream("numbers.json") << numbers;
+	JSONLoadOptions options;
+	options.exitOnError = false;
+	JSON json("numbers.json", options);
+	size_t resolved = 0;
+	REQUIRE(((JSON::JSONLiteral<double>*)json.FindPath({ { false, "a" } }, resolved))->GetValue() == 52.35006465358306);
+	REQUIRE(((JSON::JSONLiteral<double>*)json.FindPath({ { false, "b" } }, resolved))->GetValue() == 12345678901.0);
+	REQUIRE(((JSON::JSONLiteral<int>*)json.FindPath({ { false, "c" } }, resolved))->GetValue() == -2147483648LL);
+	REQUIRE(((JSON::JSONLiteral<double>*)json.FindPath({ { false, "d" } }, resolved))->GetValue() == 1e12);
+	std::remove("numbers.json");
+
+	// Messages are limited, but errors are all counted
+	report = jsonvalidator::Validate("{\"a\": [x, x, x, x]}", JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT, 2);
+	REQUIRE(report.errors == 4);
+	REQUIRE(report.messages.size() == 2);
+
+	REQUIRE(jsonvalidator::ValidateFile("test1.json").IsValid());
+	REQUIRE(!jsonvalidator::ValidateFile("no_such_file.json").readable);
+}
+
+TEST_CASE("Read the escape sequences and UTF-8 of RFC 8259", "[Strings]")
+{
+	JSONLoadOptions options;
+	options.exitOnError = false;
+	size_t resolved = 0;
+
+	std::ofstream("strings.json") << "{\"caf\\u00e9\": \"\\u20ac \xe2\x82\xac \\ud83d\\ude00\", \"b\": \"\\/\\b\\f\\r\\n\\t\\\\\\\"\"}";
+	for (JSON_PARSE_POLICY policy : { JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT, JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT })
+	{
+		options.policy = policy;
+		JSON json("strings.json", options);
+		REQUIRE(((JSON::JSONLiteral<std::string>*)json.FindPath({ { false, "caf\xc3\xa9" } }, resolved))->GetValue()
+			== "\xe2\x82\xac \xe2\x82\xac \xf0\x9f\x98\x80");
+		REQUIRE(((JSON::JSONLiteral<std::string>*)json.FindPath({ { false, "b" } }, resolved))->GetValue() == "/\b\f\r\n\t\\\"");
+	}
+	REQUIRE(jsonvalidator::Validate("{\"caf\\u00e9\": \"\\ud83d\\ude00\"}", JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT).IsValid());
+
+	// A surrogate without its pair is read as U+FFFD, and is an error under the strict policy
+	std::ofstream("strings.json") << "{\"a\": \"x\\ud83dy\"}";
+	options.policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_LENIENT;
+	{
+		JSON json("strings.json", options);
+		REQUIRE(((JSON::JSONLiteral<std::string>*)json.FindPath({ { false, "a" } }, resolved))->GetValue() == "x\xef\xbf\xbdy");
+	}
+	options.policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT;
+	REQUIRE_THROWS_AS(JSON("strings.json", options), JSONLoadError);
+
+	// Invalid UTF-8 is an error under the strict policy only
+	std::ofstream("strings.json") << "{\"a\": \"x\xc3(\", \"b\": \"\xed\xa0\x80\"}";
+	REQUIRE_THROWS_AS(JSON("strings.json", options), JSONLoadError);
+	REQUIRE(jsonvalidator::Validate("{\"a\": \"x\xc3(\", \"b\": \"\xed\xa0\x80\"}", JSON_PARSE_POLICY::JSON_PARSE_POLICY_STRICT).errors == 2);
+	options.policy = JSON_PARSE_POLICY::JSON_PARSE_POLICY_DEFAULT;
+	REQUIRE_NOTHROW(JSON("strings.json", options));
+	REQUIRE(jsonvalidator::Validate("{\"a\": \"x\xc3(\"}").warnings == 1);
+
+	std::remove("strings.json");
+}
+
+TEST_CASE("Build only the projected paths", "[Projection]")
+{
+	std::ofstream("projection.json") << "{\"meta\": {\"version\": 2, \"notes\": [\"x\", {\"y\": \"}\"}]},\n"
+		"\"records\": [{\"id\": 1, \"name\": \"a\"}, {\"name\": \"b\", \"id\": 2}, 7],\n \"skipped\": {\"a\": [1, 2]}}";
+
+	JSONLoadOptions options;
+	options.exitOnError = false;
+	options.projection = { "meta.version", "records[*].id" };
+	size_t resolved = 0;
+	{
+		JSON json("projection.json", options);
+		JSON::JSONNode* version = json.FindPath({ { false, "meta" }, { false, "version" } }, resolved);
+		REQUIRE(version->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_INT);
+		REQUIRE(((JSON::JSONLiteral<int>*)version)->GetValue() == 2);
+		REQUIRE(((JSON::JSONLiteral<int>*)json.FindPath({ { false, "records" }, { true, "", 1 }, { false, "id" } }, resolved))->GetValue() == 2);
+
+		// Other members are left out, and elements that are not containers are null
+		REQUIRE(((JSON::JSONObject*)json.FindPath({ { false, "meta" } }, resolved))->Size() == 1);
+		REQUIRE(((JSON::JSONObject*)json.FindPath({ { false, "records" }, { true, "", 0 } }, resolved))->Size() == 1);
+		REQUIRE(json.FindPath({ { false, "records" }, { true, "", 2 } }, resolved)->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LITERAL_NULL);
+		json.FindPath({ { false, "skipped" } }, resolved);
+		REQUIRE(resolved == 0);
+	}
+
+	// Paths ending at a container keep all of it, and lists are only read up to the last projected index
+	options.projection = { "meta", "records[0]" };
+	{
+		JSON json("projection.json", options);
+		REQUIRE(json.FindPath({ { false, "meta" }, { false, "notes" }, { true, "", 1 }, { false, "y" } }, resolved));
+		REQUIRE(((JSON::JSONList*)json.FindPath({ { false, "records" } }, resolved))->Size() == 1);
+	}
+
+	// Skipped values are only scanned for their end
+	std::ofstream("projection.json") << "{\"a\": 1, \"b\": [nul, {\"c\": tru}]}";
+	options.projection = { "a" };
+	REQUIRE_NOTHROW(JSON("projection.json", options));
+	options.projection = { "b" };
+	REQUIRE_THROWS_AS(JSON("projection.json", options), JSONLoadError);
+	std::ofstream("projection.json") << "{\"a\": 1, \"b\": [1, 2}";
+	options.projection = { "a" };
+	REQUIRE_THROWS_AS(JSON("projection.json", options), JSONLoadError);
+
+	options.projection = { "a..b" };
+	REQUIRE_THROWS_AS(JSON("projection.json", options), JSONLoadError);
+
+	std::remove("projection.json");
+}
+
+struct BoundEndpoint
+{
+	std::string host;
+	uint16_t port = 80;
+};
+JSON_BINDING(BoundEndpoint, JSON_FIELD(host), JSON_FIELD(port))
+
+struct BoundConfig
+{
+	std::string name;
+	double ratio = 0;
+	bool enabled = false;
+	std::vector<BoundEndpoint> endpoints;
+	std::map<std::string, int> limits;
+	std::optional<std::string> comment;
+	std::vector<bool> flags;
+};
+JSON_BINDING(BoundConfig, JSON_FIELD(name), JSON_FIELD(ratio), JSON_FIELD(enabled), JSON_FIELD(endpoints),
+	JSON_FIELD(limits), JSON_FIELD(comment), JSON_FIELD_NAMED("feature flags", flags))
+
+TEST_CASE("Read documents into bound structs", "[Binding]")
+{
+	std::ofstream("binding.json") << "{\"name\": \"caf\\u00e9\", \"unknown\": {\"a\": [1, \"]\"]}, \"ratio\": 0.5,\n"
+		"\"endpoints\": [{\"port\": 8080, \"host\": \"a\"}, {\"host\": \"b\"}], \"enabled\": true,\n"
+		"\"limits\": {\"x\": 1, \"y\\n\": -2}, \"comment\": null, \"feature flags\": [true, false]}";
+
+	BoundConfig config;
+	config.comment = "replaced by null";
+	jsonbinding::ReadFile("binding.json", config);
+	REQUIRE(config.name == "caf\xc3\xa9");
+	REQUIRE(config.ratio == 0.5);
+	REQUIRE(config.enabled);
+	REQUIRE(config.endpoints.size() == 2);
+	REQUIRE(config.endpoints[0].host == "a");
+	REQUIRE(config.endpoints[0].port == 8080);
+	REQUIRE(config.endpoints[1].port == 80);
+	REQUIRE((config.limits == std::map<std::string, int>{ { "x", 1 }, { "y\n", -2 } }));
+	REQUIRE(!config.comment);
+	REQUIRE((config.flags == std::vector<bool>{ true, false }));
+
+	// Values of another type than their field are errors, with the line and the path of the value
+	auto error = [](const std::string& text)
+	{
+		BoundConfig config;
+		try
+		{
+			jsonbinding::Read(text, config);
+		}
+		catch (const JSONLoadError& e)
+		{
+			return std::string(e.what());
+		}
+		return std::string();
+	};
+	REQUIRE(error("{\"endpoints\": [{\"host\": \"a\"},\n {\"port\": \"80\"}]}")
+		== "[ERROR] value:2 - Expected an integer, found a string at \"endpoints[1].port\".");
+	REQUIRE(error("{\"endpoints\": [{\"port\": 70000}]}") == "[ERROR] value:1 - Number is out of range of the field at \"endpoints[0].port\".");
+	REQUIRE(error("{\"limits\": {\"x\": 1.5}}")
+		== "[ERROR] value:1 - Expected an integer, found a number with a fraction or an exponent at \"limits.x\".");
+	REQUIRE(error("{\"name\": [\"a\"]}") == "[ERROR] value:1 - Expected a string, found a list at \"name\".");
+	REQUIRE(error("[]") == "[ERROR] value:1 - Expected an object, found a list.");
+	REQUIRE(error("{\"ratio\": 1} x") == "[ERROR] value:1 - Invalid characters after the value.");
+	REQUIRE(error("{\"ratio\": 01}") == "[ERROR] value:1 - Invalid number at \"ratio\".");
+	REQUIRE_THROWS_AS(jsonbinding::ReadFile("missing.json", config), JSONLoadError);
+
+	std::remove("binding.json");
+}
+
+// Paths of JSON_PATH(..) are checked while compiling
+static_assert(pathliteral::IsValid("a.b[3].c") && pathliteral::IsValid("[0][12]") && pathliteral::IsValid(""));
+static_assert(!pathliteral::IsValid("a..b") && !pathliteral::IsValid(".a") && !pathliteral::IsValid("a[01]")
+	&& !pathliteral::IsValid("a[]") && !pathliteral::IsValid("a[x]") && !pathliteral::IsValid("a."));
+static_assert(pathliteral::CountSteps("a.b[3].c") == 4 && pathliteral::Split<4>("a.b[3].c")[2].index == 3);
+
+TEST_CASE("Follow paths fixed at compile time", "[PathLiteral]")
+{
+	std::ofstream("literal.json") << "{\"server\": {\"host\": \"local\", \"ports\": [80, 443, 8080]},"
+		"\"rows\": [{\"id\": 1, \"name\": \"a\"}, {\"id\": 2, \"name\": \"b\"}, {\"name\": \"c\", \"id\": 3}]}";
+	JSON json("literal.json");
+
+	JSON::JSONLiteral<int>* port = JSON_PATH("server.ports[2]").As<JSON::JSONLiteral<int>>(json);
+	REQUIRE(port);
+	REQUIRE(port->GetValue() == 8080);
+
+	std::string host;
+	REQUIRE(JSON_PATH("server.host").Get(json, host));
+	REQUIRE(host == "local");
+
+	// The type of the node is checked against the one asked for
+	int number = 0;
+	REQUIRE(!JSON_PATH("server.host").Get(json, number));
+	REQUIRE(!JSON_PATH("server").As<JSON::JSONList>(json));
+	REQUIRE(JSON_PATH("server").As<JSON::JSONObject>(json));
+	REQUIRE(JSON_PATH("").Find(json) == json.GetRoot());
+
+	// Missing steps, and steps into a container of the other kind
+	REQUIRE(!JSON_PATH("server.ports[3]").Find(json));
+	REQUIRE(!JSON_PATH("server.missing").Find(json));
+	REQUIRE(!JSON_PATH("server[0]").Find(json));
+	REQUIRE(!JSON_PATH("server.ports.x").Find(json));
+
+	// One use of the macro over objects of the same shape and of another one
+	JSON::JSONNode* rows = JSON_PATH("rows").Find(json);
+	std::vector<int> ids;
+	for (JSON::JSONNode* row : ((JSON::JSONList*)rows)->Elements())
+	{
+		REQUIRE(JSON_PATH("id").Get(row, number));
+		ids.push_back(number);
+	}
+	REQUIRE((ids == std::vector<int>{ 1, 2, 3 }));
+
+	std::remove("literal.json");
+}
+
+TEST_CASE("Look up paths through the path index", "[PathIndex]")
+{
+	std::ofstream("paths.json") << "{\"a\": {\"b\": [10, {\"c\": 3}]}, \"a.b\": 1}";
+
+	JSON json("paths.json");
+	REQUIRE(!json.GetPathIndex());
+	json.EnablePathIndex(true);
+	const JSONPathIndex& index = *json.GetPathIndex();
+
+	JSONPathHash path;
+	JSON::JSONNode* node = nullptr;
+	REQUIRE(JSONPathIndex::HashQuery("a.b[1].c", path));
+	REQUIRE(index.Find(path, node));
+	REQUIRE(((JSON::JSONLiteral<int>*)node)->GetValue() == 3);
+
+	// A node whose second hash is not that of the path is not returned, as for a collision of the first ones
+	JSONPathHash collision = path;
+	collision.check++;
+	REQUIRE(!index.Find(collision, node));
+
+	path = JSONPathHash();
+	REQUIRE(JSONPathIndex::HashQuery("a.b[1].d", path));
+	REQUIRE(!index.Find(path, node));
+
+	// Relative to a container, the path continues its hash
+	size_t resolved = 0;
+	JSON::JSONNode* list = json.FindPath({ { false, "a" }, { false, "b" } }, resolved);
+	REQUIRE(index.HashOf(list, path));
+	REQUIRE(JSONPathIndex::HashQuery("[0]", path));
+	REQUIRE(index.Find(path, node));
+	REQUIRE(((JSON::JSONLiteral<int>*)node)->GetValue() == 10);
+
+	path = JSONPathHash();
+	REQUIRE(JSONPathIndex::HashQuery("[0]", path));
+	REQUIRE(!index.Find(path, node));
+
+	// Other queries are left to the tree walk
+	REQUIRE(!JSONPathIndex::HashQuery("a.b[01]", path));
+	REQUIRE(!JSONPathIndex::HashQuery("a.b[a.x]", path));
+	REQUIRE(!JSONPathIndex::HashQuery("a..b", path));
+
+	// "a.b" is the path of the list, not of the member with a dot
+	path = JSONPathHash();
+	REQUIRE(JSONPathIndex::HashQuery("a.b", path));
+	REQUIRE(index.Find(path, node));
+	REQUIRE(node->GetType() == JSON::JSON_NODE_TYPE::JSON_NODE_TYPE_LIST);
+
+	// Edits keep the index, and the elements after an inserted one are found at their new paths
+	size_t size = index.Size();
+	REQUIRE(json.Insert({ { false, "a" }, { false, "b" }, { true, "", 0 } }, JSON::ParseValue("{\"c\": 7}")));
+	REQUIRE(json.GetPathIndex() == &index);
+	REQUIRE(index.Size() == size + 2);
+
+	auto find = [&index](const std::string& query)
+	{
+		JSONPathHash path;
+		JSON::JSONNode* node = nullptr;
+		return JSONPathIndex::HashQuery(query, path) && index.Find(path, node) ? node : nullptr;
+	};
+	REQUIRE(((JSON::JSONLiteral<int>*)find("a.b[0].c"))->GetValue() == 7);
+	REQUIRE(((JSON::JSONLiteral<int>*)find("a.b[1]"))->GetValue() == 10);
+	REQUIRE(((JSON::JSONLiteral<int>*)find("a.b[2].c"))->GetValue() == 3);
+
+	REQUIRE(json.Remove({ { false, "a" } }));
+	REQUIRE(!find("a.b"));
+	REQUIRE(index.Size() == 1);
+
+	// Undone edits are indexed back in the same way
+	json.GoTo(0);
+	REQUIRE(json.GetPathIndex() == &index);
+	REQUIRE(index.Size() == size);
+	REQUIRE(((JSON::JSONLiteral<int>*)find("a.b[1].c"))->GetValue() == 3);
+	REQUIRE(!find("a.b[2]"));
+
+	// Once built, the same index is returned to every reader
+	std::thread reader([&json, &index]() { REQUIRE(json.GetPathIndex() == &index); });
+	reader.join();
+
+	std::remove("paths.json");
+}
+
+TEST_CASE("Match wildcard and recursive descent patterns", "[Pattern]")
+{
+	{
+		std::ofstream file("pattern.json");
+		file << "{\"shop\": {\"items\": [";
+		for (int i = 0; i < 1000; i++) file << (i ? ", " : "") << "{\"price\": " << i << ", \"tags\": {\"price\": -1}}";
+		file << "]}}";
+	}
+
+	JSON json("pattern.json");
+	size_t resolved = 0;
+	JSON::JSONNode* root = json.FindPath({}, resolved);
+
+	auto noIndex = [](const std::string&, size_t&) { return false; };
+
+	JSONPathPattern pattern;
+	REQUIRE(pattern.Parse("shop.items[*].price", noIndex));
+	REQUIRE(pattern.Steps().size() == 4);
+	REQUIRE(pattern.Steps()[2].type == PATTERN_STEP::PATTERN_STEP_ANY);
+
+	// Parts are visited in the order of the tree, also when split between threads
+	WorkerPool pool(4);
+	std::vector<std::vector<int>> parts(JSONPathPattern::MaxParts);
+	size_t used = pattern.ForEach(root, [&parts](size_t part, JSON::JSONNode* node)
+	{
+		parts[part].push_back(((JSON::JSONLiteral<int>*)node)->GetValue());
+	}, &pool);
+	REQUIRE(used > 1);
+
+	std::vector<int> prices;
+	for (const std::vector<int>& part : parts) prices.insert(prices.end(), part.begin(), part.end());
+	REQUIRE(prices.size() == 1000);
+	for (int i = 0; i < 1000; i++) REQUIRE(prices[i] == i);
+
+	// Recursive descent finds the nested members too
+	REQUIRE(pattern.Parse("..price", noIndex));
+	size_t count = 0;
+	pattern.ForEach(root, [&count](size_t, JSON::JSONNode*) { count++; });
+	REQUIRE(count == 2000);
+
+	REQUIRE(JSONPathPattern::IsPattern("a..b"));
+	REQUIRE(JSONPathPattern::IsPattern("max(a[*].b)"));
+	REQUIRE(!JSONPathPattern::IsPattern("a.b*2"));
+	REQUIRE(!pattern.Parse("a..", noIndex));
+
+	std::remove("pattern.json");
+}
+
+TEST_CASE("Filter list elements by a predicate", "[Filter]")
+{
+	std::ofstream("filter.json") << "{\"items\": [{\"status\": \"active\", \"price\": 5}, {\"status\": \"active\", \"price\": 15},"
+		" {\"status\": \"sold\", \"price\": 20}, {\"price\": 30}, {\"status\": \"active\", \"price\": 12.5}]}";
+
+	JSON json("filter.json");
+	size_t resolved = 0;
+	JSON::JSONList* items = (JSON::JSONList*)json.FindPath({ { false, "items" } }, resolved);
+
+	JSONFilter filter;
+	std::vector<uint8_t> matches;
+
+	REQUIRE(filter.Parse("@.status == \"active\" && @.price > 10"));
+	filter.Evaluate(items->Elements().data(), items->Size(), matches);
+	REQUIRE(matches == std::vector<uint8_t>({ 0, 1, 0, 0, 1 }));
+
+	// Missing fields compare as false, also for "!="
+	REQUIRE(filter.Parse("@.status != \"sold\""));
+	filter.Evaluate(items->Elements().data(), items->Size(), matches);
+	REQUIRE(matches == std::vector<uint8_t>({ 1, 1, 0, 0, 1 }));
+
+	REQUIRE(filter.Parse("!@.status || (@.price <= 5)"));
+	filter.Evaluate(items->Elements().data(), items->Size(), matches);
+	REQUIRE(matches == std::vector<uint8_t>({ 1, 0, 0, 1, 0 }));
+
+	REQUIRE(!filter.Parse("@.price >"));
+	REQUIRE(!filter.Parse("@.price > 1 &&"));
+	REQUIRE(!filter.Parse("\"active\""));
+
+	// Filters are steps of patterns
+	JSONPathPattern pattern;
+	REQUIRE(pattern.Parse("items[?(@.price >= 15)].price", [](const std::string&, size_t&) { return false; }));
+	size_t count = 0;
+	pattern.ForEach(json.FindPath({}, resolved), [&count](size_t, JSON::JSONNode*) { count++; });
+	REQUIRE(count == 3);
+
+	std::remove("filter.json");
+}
+
+TEST_CASE("Evaluate a batch of queries in parallel", "[Batch]")
+{
+	JSONLoadOptions options;
+	options.progressive = true;
+	options.progressiveThreshold = 0;
+	JSON json("test1.json", options);
+	JSONInterface jsonInterface = json.CreateInterface();
+	jsonInterface.Select("menu.popup");
+
+	std::vector<std::string> queries;
+	for (int i = 0; i < 300; i++)
+	{
+		queries.push_back("menuitem[" + std::to_string(i % 4) + "].value");
+		queries.push_back("size(menuitem) * " + std::to_string(i));
+	}
+
+	BatchQueryExecutor executor(4);
+	std::vector<std::string> results = executor.Run(jsonInterface, queries);
+	REQUIRE(results.size() == queries.size());
+
+	// Results are in order, including the messages of failed queries
+	REQUIRE(results[0] == "\"New\"\n");
+	REQUIRE(results[3] == "3\n");
+	REQUIRE(results[6] == "[ERROR] Tried to access an out-of-bound index.\n");
+	REQUIRE(results[599] == "897\n");
+}
+
+#if defined(__linux__)
+TEST_CASE("Answer pipelined requests over a socket", "[Server]")
+{
+	DocumentRegistry documents;
+	documents.Open("menu", "test1.json");
+	REQUIRE(documents.Current()->Wait(std::chrono::seconds(10)));
+
+	QueryServer server(documents, 4);
+	std::string error;
+	REQUIRE(server.Listen("server_test.sock", error));
+	std::thread loop(&QueryServer::Run, &server);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	std::strcpy(address.sun_path, "server_test.sock");
+	REQUIRE(connect(fd, (sockaddr*)&address, sizeof(address)) == 0);
+
+	// Every request is sent before reading any of the responses
+	std::vector<std::string> queries = { "menu.popup.menuitem[1].value", "size(menu.popup.menuitem) * 3", "menu.nope", "@other x" };
+	std::string frames;
+	for (const std::string& query : queries)
+	{
+		uint32_t size = (uint32_t)query.size();
+		frames += { (char)(size >> 24), (char)(size >> 16), (char)(size >> 8), (char)size };
+		frames += query;
+	}
+	REQUIRE(write(fd, frames.data(), frames.size()) == (ssize_t)frames.size());
+
+	auto readExactly = [fd](size_t size)
+	{
+		std::string data(size, '\0');
+		for (size_t pos = 0; pos < size; )
+		{
+			ssize_t length = read(fd, &data[pos], size - pos);
+			if (length <= 0) break;
+			pos += length;
+		}
+		return data;
+	};
+
+	std::vector<std::string> responses;
+	for (size_t i = 0; i < queries.size(); i++)
+	{
+		std::string header = readExactly(4);
+		uint32_t size = ((uint32_t)(unsigned char)header[0] << 24) | ((uint32_t)(unsigned char)header[1] << 16)
+			| ((uint32_t)(unsigned char)header[2] << 8) | (unsigned char)header[3];
+		responses.push_back(readExactly(size));
+	}
+	close(fd);
+
+	server.Stop();
+	loop.join();
+
+	REQUIRE(responses[0] == "\"Open\"\n");
+	REQUIRE(responses[1] == "9\n");
+	REQUIRE(responses[2] == "[ERROR] Cannot find member \"nope\" of the object.\n");
+	REQUIRE(responses[3] == "[ERROR] No document named \"other\".\n");
+
+	QueryServerStats stats = server.GetStats();
+	REQUIRE(stats.connections == 1);
+	REQUIRE(stats.requests == 4);
+	REQUIRE(stats.errors == 2);
+}
+
+TEST_CASE("Close connections sending requests over the size limit", "[Server]")
+{
+	DocumentRegistry documents;
+	documents.Open("menu", "test1.json");
+	REQUIRE(documents.Current()->Wait(std::chrono::seconds(10)));
+
+	QueryServer server(documents, 2);
+	std::string error;
+	REQUIRE(server.Listen("server_limit.sock", error));
+	std::thread loop(&QueryServer::Run, &server);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	std::strcpy(address.sun_path, "server_limit.sock");
+	REQUIRE(connect(fd, (sockaddr*)&address, sizeof(address)) == 0);
+
+	// The frame announces more than allowed, and the peer keeps sending
+	uint32_t size = QueryServer::MaxRequestSize + 1;
+	std::string data = { (char)(size >> 24), (char)(size >> 16), (char)(size >> 8), (char)size };
+	data.resize(64 * 1024, 'x');
+
+	size_t sent = 0;
+	bool closed = false;
+	while (sent < 16 * (size_t)QueryServer::MaxRequestSize)
+	{
+		ssize_t length = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+		if (length <= 0)
+		{
+			closed = true;
+			break;
+		}
+		sent += length;
+	}
+	close(fd);
+
+	server.Stop();
+	loop.join();
+
+	REQUIRE(closed);
+	REQUIRE(server.GetStats().bytesReceived <= (size_t)QueryServer::MaxRequestSize + 4);
+}
+#endif